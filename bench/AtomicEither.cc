@@ -0,0 +1,139 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/AtomicEither.hh"
+#include "funky/Either.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A status that one thread updates now and then and three threads read
+// constantly (AtomicEither/8B, /16B and /32B, by how big the packed Either
+// is). Each sample times state.iterations() loads, shared between the
+// readers, so results are in nanoseconds per load. The baseline is an
+// Either behind a std::mutex.
+//
+// As with Queue/, these are only meaningful with at least four idle cores.
+
+namespace {
+
+  using funky::Either;
+
+  enum class ErrorCode : std::uint8_t { Timeout = 1 };
+
+  template <std::size_t N>
+  struct Status {
+    std::uint32_t words[N];
+  };
+
+  template <class R>
+  struct LockedImpl {
+    static char const *name() { return "mutex"; }
+    static bool const baseline = true;
+    typedef Either<ErrorCode, R> Value;
+
+    explicit LockedImpl(Value const &v) : mutex_(), value_(v) {}
+
+    Value load() {
+      std::lock_guard<std::mutex> lock{mutex_};
+      return value_;
+    }
+
+    void store(Value const &v) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      value_ = v;
+    }
+
+  private:
+    std::mutex mutex_;
+    Value value_;
+  };
+
+  template <class R>
+  struct AtomicImpl {
+    static char const *name() { return "AtomicEither"; }
+    static bool const baseline = false;
+    typedef Either<ErrorCode, R> Value;
+
+    explicit AtomicImpl(Value const &v) : value_(v) {}
+
+    Value load() { return value_.load(); }
+    void store(Value const &v) { value_.store(v); }
+
+  private:
+    funky::AtomicEither<ErrorCode, R> value_;
+  };
+
+  int const Readers = 3;
+
+  template <template <class> class Impl, class R>
+  void readHeavy(bench::State &state) {
+    typedef typename Impl<R>::Value Value;
+    Impl<R> status{Value{ErrorCode::Timeout}};
+    std::size_t const n = state.iterations();
+    std::atomic<bool> go{false}, done{false};
+
+    std::thread writer([&] {
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      std::uint32_t i = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        R r;
+        for (std::uint32_t &w : r.words) {
+          w = i;
+        }
+        status.store(++i % 8 == 0 ? Value{ErrorCode::Timeout} : Value{r});
+        // a pause between updates, which also lets readers run when there
+        // are fewer cores than threads.
+        std::this_thread::yield();
+      }
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < Readers; ++r) {
+      readers.emplace_back([&status, &go, n, r] {
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        std::size_t sum = 0;
+        for (std::size_t i = n * r / Readers; i < n * (r + 1) / Readers; ++i) {
+          Value const v = status.load();
+          sum += v.isRight() ? v.right().words[0] : 1;
+        }
+        bench::doNotOptimize(sum);
+      });
+    }
+
+    state.running(); // start the clock
+    go.store(true, std::memory_order_release);
+    for (std::thread &t : readers) {
+      t.join();
+    }
+    done.store(true, std::memory_order_relaxed);
+    writer.join();
+    while (state.running()) {
+    }
+  }
+
+  template <class R>
+  void addFamily(std::string const &family) {
+    bench::add(family, LockedImpl<R>::name(), &readHeavy<LockedImpl, R>, LockedImpl<R>::baseline);
+    bench::add(family, AtomicImpl<R>::name(), &readHeavy<AtomicImpl, R>, AtomicImpl<R>::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addFamily<Status<1>>("AtomicEither/8B");
+      addFamily<Status<3>>("AtomicEither/16B");
+      addFamily<Status<6>>("AtomicEither/32B");
+    }
+  } registerAtomicEitherBenchmarks;
+
+}
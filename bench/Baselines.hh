@@ -0,0 +1,111 @@
+#ifndef FUNKY_BENCH_BASELINES_HH_INCLUDED
+#define FUNKY_BENCH_BASELINES_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include <new>
+#include <utility>
+
+namespace bench {
+
+  enum LeftTag { AsLeft };
+  enum RightTag { AsRight };
+
+  /// The hand-written tagged union that Either should be competitive with.
+  /// No asserts, no generic machinery; just a union and a bool.
+  template <class L, class R>
+  class TaggedUnion {
+  public:
+    TaggedUnion(LeftTag, L const &l) : u_(), isLeft_(true) { new (&u_.l) L(l); }
+    TaggedUnion(RightTag, R const &r) : u_(), isLeft_(false) { new (&u_.r) R(r); }
+
+    TaggedUnion(TaggedUnion const &o) : u_(), isLeft_(o.isLeft_) {
+      if (isLeft_) new (&u_.l) L(o.u_.l);
+      else new (&u_.r) R(o.u_.r);
+    }
+
+    TaggedUnion(TaggedUnion &&o) : u_(), isLeft_(o.isLeft_) {
+      if (isLeft_) new (&u_.l) L(std::move(o.u_.l));
+      else new (&u_.r) R(std::move(o.u_.r));
+    }
+
+    ~TaggedUnion() { destroy(); }
+
+    TaggedUnion &operator=(TaggedUnion const &o) {
+      if (isLeft_ && o.isLeft_) {
+        u_.l = o.u_.l;
+      } else if (!isLeft_ && !o.isLeft_) {
+        u_.r = o.u_.r;
+      } else {
+        destroy();
+        isLeft_ = o.isLeft_;
+        if (isLeft_) new (&u_.l) L(o.u_.l);
+        else new (&u_.r) R(o.u_.r);
+      }
+      return *this;
+    }
+
+    TaggedUnion &operator=(TaggedUnion &&o) {
+      if (isLeft_ && o.isLeft_) {
+        u_.l = std::move(o.u_.l);
+      } else if (!isLeft_ && !o.isLeft_) {
+        u_.r = std::move(o.u_.r);
+      } else {
+        destroy();
+        isLeft_ = o.isLeft_;
+        if (isLeft_) new (&u_.l) L(std::move(o.u_.l));
+        else new (&u_.r) R(std::move(o.u_.r));
+      }
+      return *this;
+    }
+
+    template <class... Args>
+    void emplaceRight(Args&&... args) {
+      destroy();
+      new (&u_.r) R(std::forward<Args>(args)...);
+      isLeft_ = false;
+    }
+
+    bool isLeft() const { return isLeft_; }
+    L const &left() const { return u_.l; }
+    R const &right() const { return u_.r; }
+    L &left() { return u_.l; }
+    R &right() { return u_.r; }
+
+    bool operator==(TaggedUnion const &o) const {
+      return isLeft_ == o.isLeft_ && (isLeft_ ? u_.l == o.u_.l : u_.r == o.u_.r);
+    }
+
+  private:
+    void destroy() {
+      if (isLeft_) u_.l.~L();
+      else u_.r.~R();
+    }
+
+    union U {
+      U() {}
+      ~U() {}
+      L l;
+      R r;
+    } u_;
+    bool isLeft_;
+  };
+
+  template <class L, class R>
+  void swap(TaggedUnion<L, R> &a, TaggedUnion<L, R> &b) {
+    using std::swap;
+    if (a.isLeft() && b.isLeft()) {
+      swap(a.left(), b.left());
+    } else if (!a.isLeft() && !b.isLeft()) {
+      swap(a.right(), b.right());
+    } else {
+      TaggedUnion<L, R> tmp{std::move(a)};
+      a = std::move(b);
+      b = std::move(tmp);
+    }
+  }
+
+}
+
+#endif
@@ -0,0 +1,286 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+  namespace {
+
+    struct Entry {
+      std::string family;
+      std::string impl;
+      BenchFn fn;
+      bool baseline;
+    };
+
+    struct Result {
+      double medianNs;
+      double p99Ns;
+      double minNs;
+      double medianCycles;
+    };
+
+    struct Options {
+      Options()
+        : warmup(3), reps(31), minSampleNs(200e3), list(false), filters()
+        , csvPath(), comparePath() {}
+
+      std::size_t warmup;
+      std::size_t reps;
+      double minSampleNs;
+      bool list;
+      std::vector<std::string> filters;
+      std::string csvPath;      // write results here as csv
+      std::string comparePath;  // report deltas against results from an earlier --csv
+    };
+
+    // medians from an earlier run, keyed by "family/impl".
+    typedef std::map<std::string, double> Reference;
+
+    std::vector<Entry> &registry() {
+      static std::vector<Entry> entries;
+      return entries;
+    }
+
+    bool matches(Options const &opts, Entry const &e) {
+      if (opts.filters.empty()) {
+        return true;
+      }
+      std::string const name = e.family + "/" + e.impl;
+      for (std::string const &f : opts.filters) {
+        if (name.find(f) != std::string::npos) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // pick the value at quantile q of an already sorted vector.
+    double quantile(std::vector<double> const &sorted, double q) {
+      std::size_t idx = static_cast<std::size_t>(std::ceil(q * sorted.size()));
+      idx = idx == 0 ? 0 : idx - 1;
+      return sorted[std::min(idx, sorted.size() - 1)];
+    }
+
+    Result measure(Entry const &e, Options const &opts) {
+      // calibrate: grow the iteration count until one sample takes minSampleNs.
+      std::size_t n = 1;
+      for (;;) {
+        State s{n};
+        e.fn(s);
+        double const took = s.elapsedNs();
+        if (took >= opts.minSampleNs || n >= (std::size_t(1) << 40)) {
+          break;
+        }
+        double grow = took <= 0 ? 10.0 : (opts.minSampleNs * 1.2) / took;
+        grow = std::max(2.0, std::min(10.0, grow));
+        n = static_cast<std::size_t>(n * grow);
+      }
+
+      for (std::size_t i = 0; i < opts.warmup; ++i) {
+        State s{n};
+        e.fn(s);
+      }
+
+      std::vector<double> ns, cycles;
+      ns.reserve(opts.reps);
+      cycles.reserve(opts.reps);
+      for (std::size_t i = 0; i < opts.reps; ++i) {
+        State s{n};
+        e.fn(s);
+        ns.push_back(s.elapsedNs() / n);
+        cycles.push_back(static_cast<double>(s.elapsedCycles()) / n);
+      }
+      std::sort(ns.begin(), ns.end());
+      std::sort(cycles.begin(), cycles.end());
+
+      Result r;
+      r.medianNs = quantile(ns, 0.5);
+      r.p99Ns = quantile(ns, 0.99);
+      r.minNs = ns.front();
+      r.medianCycles = quantile(cycles, 0.5);
+      return r;
+    }
+
+    bool parseSize(char const *arg, char const *prefix, std::size_t &out) {
+      std::size_t const len = std::strlen(prefix);
+      if (std::strncmp(arg, prefix, len) != 0) {
+        return false;
+      }
+      out = static_cast<std::size_t>(std::strtoull(arg + len, nullptr, 10));
+      return true;
+    }
+
+    bool parseString(char const *arg, char const *prefix, std::string &out) {
+      std::size_t const len = std::strlen(prefix);
+      if (std::strncmp(arg, prefix, len) != 0) {
+        return false;
+      }
+      out = arg + len;
+      return true;
+    }
+
+    bool loadReference(std::string const &path, Reference &ref) {
+      std::ifstream in{path.c_str()};
+      if (!in) {
+        return false;
+      }
+      std::string line;
+      std::getline(in, line); // header
+      while (std::getline(in, line)) {
+        std::istringstream fields{line};
+        std::string family, impl, median;
+        if (std::getline(fields, family, ',') && std::getline(fields, impl, ',') &&
+            std::getline(fields, median, ',')) {
+          // results from before families were shown with '/' still match.
+          for (char &c : family) {
+            if (c == '_') c = '/';
+          }
+          ref[family + "/" + impl] = std::strtod(median.c_str(), nullptr);
+        }
+      }
+      return true;
+    }
+
+    void usage(char const *argv0) {
+      std::printf("usage: %s [--warmup=N] [--reps=N] [--min-sample-us=N] [--list]\n"
+                  "          [--csv=FILE] [--compare=FILE] [filter...]\n"
+                  "  filters are substrings matched against family/impl\n"
+                  "  --csv writes results to FILE, --compare reports the change in\n"
+                  "  median against a FILE written by an earlier --csv run\n", argv0);
+    }
+
+  }
+
+  void add(std::string const &family, std::string const &impl, BenchFn fn, bool baseline) {
+    Entry e = { family, impl, fn, baseline };
+    registry().push_back(e);
+  }
+
+}
+
+int main(int argc, char **argv) {
+  using namespace bench;
+
+  Options opts;
+
+  for (int i = 1; i < argc; ++i) {
+    std::size_t v = 0;
+    if (parseSize(argv[i], "--warmup=", v)) {
+      opts.warmup = v;
+    } else if (parseSize(argv[i], "--reps=", v)) {
+      opts.reps = std::max<std::size_t>(v, 1);
+    } else if (parseSize(argv[i], "--min-sample-us=", v)) {
+      opts.minSampleNs = v * 1e3;
+    } else if (parseString(argv[i], "--csv=", opts.csvPath)) {
+    } else if (parseString(argv[i], "--compare=", opts.comparePath)) {
+    } else if (std::strcmp(argv[i], "--list") == 0) {
+      opts.list = true;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    } else {
+      opts.filters.push_back(argv[i]);
+    }
+  }
+
+  std::vector<Entry> const &entries = registry();
+
+  // collect families in the order they were first registered.
+  std::vector<std::string> families;
+  for (Entry const &e : entries) {
+    if (std::find(families.begin(), families.end(), e.family) == families.end()) {
+      families.push_back(e.family);
+    }
+  }
+
+  if (opts.list) {
+    for (Entry const &e : entries) {
+      if (matches(opts, e)) {
+        std::printf("%s/%s%s\n", e.family.c_str(), e.impl.c_str(), e.baseline ? " (baseline)" : "");
+      }
+    }
+    return 0;
+  }
+
+  Reference ref;
+  bool const comparing = !opts.comparePath.empty();
+  if (comparing && !loadReference(opts.comparePath, ref)) {
+    std::fprintf(stderr, "couldn't read %s\n", opts.comparePath.c_str());
+    return 1;
+  }
+
+  FILE *csv = nullptr;
+  if (!opts.csvPath.empty()) {
+    csv = std::fopen(opts.csvPath.c_str(), "w");
+    if (!csv) {
+      std::fprintf(stderr, "couldn't write %s\n", opts.csvPath.c_str());
+      return 1;
+    }
+    std::fprintf(csv, "family,impl,median_ns,p99_ns,min_ns,cycles\n");
+  }
+
+  std::printf("%-32s %-18s %11s %11s %11s %9s %9s%s\n",
+              "family", "impl", "median ns", "p99 ns", "min ns", "cycles", "vs base",
+              comparing ? "  vs ref" : "");
+
+  for (std::string const &family : families) {
+    // run the baseline first so everything else can be reported against it.
+    std::vector<Entry> members;
+    for (Entry const &e : entries) {
+      if (e.family == family && matches(opts, e)) {
+        members.push_back(e);
+      }
+    }
+    std::stable_partition(members.begin(), members.end(),
+                          [](Entry const &e) { return e.baseline; });
+
+    double baseNs = 0;
+    bool printedAny = false;
+    for (Entry const &e : members) {
+      Result const r = measure(e, opts);
+      if (e.baseline) {
+        baseNs = r.medianNs;
+      }
+      char ratio[32] = "-";
+      if (baseNs > 0) {
+        std::snprintf(ratio, sizeof(ratio), "%.2fx", r.medianNs / baseNs);
+      }
+      char delta[32] = "";
+      if (comparing) {
+        Reference::const_iterator it = ref.find(e.family + "/" + e.impl);
+        if (it != ref.end() && it->second > 0) {
+          std::snprintf(delta, sizeof(delta), "  %+6.1f%%", (r.medianNs / it->second - 1.0) * 100.0);
+        } else {
+          std::snprintf(delta, sizeof(delta), "  %7s", "-");
+        }
+      }
+      std::printf("%-32s %-18s %11.2f %11.2f %11.2f %9.1f %9s%s\n",
+                  printedAny ? "" : family.c_str(), e.impl.c_str(),
+                  r.medianNs, r.p99Ns, r.minNs, r.medianCycles, ratio, delta);
+      std::fflush(stdout);
+      if (csv) {
+        std::fprintf(csv, "%s,%s,%.4f,%.4f,%.4f,%.2f\n", e.family.c_str(), e.impl.c_str(),
+                     r.medianNs, r.p99Ns, r.minNs, r.medianCycles);
+      }
+      printedAny = true;
+    }
+  }
+  if (csv) {
+    std::fclose(csv);
+  }
+  return 0;
+}
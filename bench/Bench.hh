@@ -0,0 +1,153 @@
+#ifndef FUNKY_BENCH_BENCH_HH_INCLUDED
+#define FUNKY_BENCH_BENCH_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// A tiny, self-contained microbenchmark harness used by `make bench`.
+///
+/// Benchmarks are grouped into families (e.g. "Copy/Trivial"), and each
+/// family may contain several implementations of the same operation. One of
+/// them can be marked as the baseline, and every other implementation in the
+/// family is reported relative to it.
+///
+/// A benchmark body looks like:
+///
+///     BENCH(Copy_Trivial, Either) { // family "Copy/Trivial"
+///       Either<int, double> e{1.0};
+///       while (state.running()) {
+///         Either<int, double> c{e};
+///         bench::doNotOptimize(c);
+///       }
+///     }
+///
+/// Anything before the first call to `state.running()` is setup and is not
+/// timed, nor is anything after the loop exits.
+
+namespace bench {
+
+  /// Force `value` to be materialized, and treat all memory as clobbered so
+  /// that loads from sources can't be hoisted out of the timing loop.
+  template <class T>
+  inline void doNotOptimize(T const &value) {
+    __asm__ __volatile__("" : : "r,m"(value) : "memory");
+  }
+
+  /// Make the optimizer assume `p` escapes and is read and written.
+  inline void escape(void const *p) {
+    __asm__ __volatile__("" : : "g"(p) : "memory");
+  }
+
+  /// Treat all memory as clobbered.
+  inline void clobberMemory() {
+    __asm__ __volatile__("" : : : "memory");
+  }
+
+  /// Read the finest cheap counter we have. On x86 this is the TSC (which
+  /// counts reference cycles, not core cycles), on aarch64 the virtual timer,
+  /// and otherwise a nanosecond clock.
+  inline std::uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  /// Passed to every benchmark body. Drives the timing loop.
+  class State {
+  public:
+    explicit State(std::size_t iterations)
+      : iterations_(iterations), left_(0), started_(false)
+      , startTime_(), stopTime_(), startCycles_(0), stopCycles_(0) {}
+
+    /// Returns true while there are iterations left to run. The clock starts
+    /// on the first call and stops on the call that returns false.
+    bool running() {
+      if (__builtin_expect(left_ != 0, 1)) {
+        --left_;
+        return true;
+      }
+      return startOrStop();
+    }
+
+    std::size_t iterations() const { return iterations_; }
+
+    /// Elapsed time and counter ticks of the timed region.
+    double elapsedNs() const {
+      return std::chrono::duration<double, std::nano>(stopTime_ - startTime_).count();
+    }
+    std::uint64_t elapsedCycles() const { return stopCycles_ - startCycles_; }
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    bool startOrStop() {
+      if (!started_) {
+        started_ = true;
+        left_ = iterations_;
+        startTime_ = Clock::now();
+        startCycles_ = readCycles();
+        return running();
+      }
+      stopCycles_ = readCycles();
+      stopTime_ = Clock::now();
+      return false;
+    }
+
+    std::size_t iterations_;
+    std::size_t left_;
+    bool started_;
+    Clock::time_point startTime_, stopTime_;
+    std::uint64_t startCycles_, stopCycles_;
+  };
+
+  typedef void (*BenchFn)(State &);
+
+  /// Register a benchmark. `family` groups implementations of the same
+  /// operation, `impl` names this implementation.
+  void add(std::string const &family, std::string const &impl, BenchFn fn,
+           bool baseline = false);
+
+  /// Helper to register benchmarks from static initializers. Underscores in
+  /// the family are shown as '/', so BENCH(Copy_Trivial, ...) joins the
+  /// "Copy/Trivial" family.
+  struct Registrar {
+    Registrar(char const *family, char const *impl, BenchFn fn, bool baseline = false) {
+      std::string f{family};
+      for (char &c : f) {
+        if (c == '_') c = '/';
+      }
+      add(f, impl, fn, baseline);
+    }
+  };
+
+}
+
+#define FUNKY_BENCH_IMPL(family, impl, baseline) \
+  static void funkyBench_##family##_##impl(::bench::State &); \
+  static ::bench::Registrar funkyBenchRegistrar_##family##_##impl( \
+    #family, #impl, &funkyBench_##family##_##impl, baseline); \
+  static void funkyBench_##family##_##impl(::bench::State &state)
+
+/// Define a benchmark body. `state` is in scope.
+#define BENCH(family, impl) FUNKY_BENCH_IMPL(family, impl, false)
+
+/// As BENCH, but other implementations in the family are reported relative to this one.
+#define BENCH_BASELINE(family, impl) FUNKY_BENCH_IMPL(family, impl, true)
+
+#endif
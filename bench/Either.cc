@@ -0,0 +1,457 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "Baselines.hh"
+#include "funky/Either.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <optional>
+#include <variant>
+#endif
+
+// Every Either operation, across trivial, small-string and heap-owning
+// payloads, compared against a hand-written tagged union (the baseline) and,
+// in C++17 builds, std::variant and std::optional. Lookup/ compares ways of
+// returning a found value from a table, ConstructFrom/ and EmplaceFrom/
+// ways of putting a function's large result in an Either, and RightOr/ ways
+// of taking the Right out of a returned Either or falling back to a default.
+//
+// std::optional<R> can't hold a Left, so "left" is modeled as nullopt. It's a
+// lower bound on what any representation of "maybe failed" can cost.
+
+namespace {
+
+  std::size_t weigh(int i) { return static_cast<std::size_t>(i); }
+  std::size_t weigh(double d) { return static_cast<std::size_t>(d); }
+  std::size_t weigh(std::string const &s) { return s.size(); }
+  std::size_t weigh(std::vector<int> const &v) { return v.size(); }
+
+  // Payloads. Left is always an error code, Right varies.
+
+  struct Trivial {
+    typedef int L;
+    typedef double R;
+    static char const *name() { return "Trivial"; }
+    static L left() { return 7; }
+    static R right() { return 3.5; }
+  };
+
+  struct SmallString {
+    typedef int L;
+    typedef std::string R;
+    static char const *name() { return "SmallString"; }
+    static L left() { return 7; }
+    static R right() { return "short"; } // fits in any SSO buffer
+  };
+
+  struct HeapOwning {
+    typedef int L;
+    typedef std::vector<int> R;
+    static char const *name() { return "HeapOwning"; }
+    static L left() { return 7; }
+    static R right() { return R(32, 1); }
+  };
+
+  // Implementations. Each one adapts a type to the handful of operations the
+  // benchmarks below need.
+
+  template <class L, class R>
+  struct EitherImpl {
+    typedef funky::Either<L, R> Type;
+    static char const *name() { return "Either"; }
+    static bool const baseline = false;
+    static Type makeLeft(L const &l) { return Type{l}; }
+    static Type makeRight(R const &r) { return Type{r}; }
+    static void emplaceRight(Type &e, R const &r) { e.emplaceRight(r); }
+    static std::size_t dispatch(Type const &e) {
+      return e.either([](L const &l) { return weigh(l); },
+                      [](R const &r) { return weigh(r); });
+    }
+  };
+
+  template <class L, class R>
+  struct TaggedImpl {
+    typedef bench::TaggedUnion<L, R> Type;
+    static char const *name() { return "Tagged"; }
+    static bool const baseline = true;
+    static Type makeLeft(L const &l) { return Type{bench::AsLeft, l}; }
+    static Type makeRight(R const &r) { return Type{bench::AsRight, r}; }
+    static void emplaceRight(Type &e, R const &r) { e.emplaceRight(r); }
+    static std::size_t dispatch(Type const &e) {
+      return e.isLeft() ? weigh(e.left()) : weigh(e.right());
+    }
+  };
+
+#if __cplusplus >= 201703L
+  template <class L, class R>
+  struct VariantImpl {
+    typedef std::variant<L, R> Type;
+    static char const *name() { return "variant"; }
+    static bool const baseline = false;
+    static Type makeLeft(L const &l) { return Type{std::in_place_index<0>, l}; }
+    static Type makeRight(R const &r) { return Type{std::in_place_index<1>, r}; }
+    static void emplaceRight(Type &e, R const &r) { e.template emplace<1>(r); }
+    static std::size_t dispatch(Type const &e) {
+      return std::visit([](auto const &x) { return weigh(x); }, e);
+    }
+  };
+
+  template <class L, class R>
+  struct OptionalImpl {
+    typedef std::optional<R> Type;
+    static char const *name() { return "optional"; }
+    static bool const baseline = false;
+    static Type makeLeft(L const &) { return Type{}; }
+    static Type makeRight(R const &r) { return Type{r}; }
+    static void emplaceRight(Type &e, R const &r) { e.emplace(r); }
+    static std::size_t dispatch(Type const &e) { return e ? weigh(*e) : 0; }
+  };
+#endif
+
+  template <class I, class P>
+  void constructLeft(bench::State &state) {
+    typename P::L const l = P::left();
+    bench::escape(&l);
+    while (state.running()) {
+      typename I::Type e = I::makeLeft(l);
+      bench::doNotOptimize(e);
+    }
+  }
+
+  template <class I, class P>
+  void constructRight(bench::State &state) {
+    typename P::R const r = P::right();
+    bench::escape(&r);
+    while (state.running()) {
+      typename I::Type e = I::makeRight(r);
+      bench::doNotOptimize(e);
+    }
+  }
+
+  template <class I, class P>
+  void copy(bench::State &state) {
+    typename I::Type const src = I::makeRight(P::right());
+    bench::escape(&src);
+    while (state.running()) {
+      typename I::Type c{src};
+      bench::doNotOptimize(c);
+    }
+  }
+
+  // move-construct out and move-assign back, so the source stays populated.
+  template <class I, class P>
+  void moveRoundTrip(bench::State &state) {
+    typename I::Type a = I::makeRight(P::right());
+    bench::escape(&a);
+    while (state.running()) {
+      typename I::Type b{std::move(a)};
+      a = std::move(b);
+      bench::doNotOptimize(a);
+    }
+  }
+
+  template <class I, class P>
+  void assignSame(bench::State &state) {
+    typename I::Type a = I::makeRight(P::right());
+    typename I::Type const b = I::makeRight(P::right());
+    bench::escape(&a);
+    bench::escape(&b);
+    while (state.running()) {
+      a = b;
+      bench::doNotOptimize(a);
+    }
+  }
+
+  // two assignments per iteration, each of which changes the held alternative.
+  template <class I, class P>
+  void assignCross(bench::State &state) {
+    typename I::Type a = I::makeRight(P::right());
+    typename I::Type const l = I::makeLeft(P::left());
+    typename I::Type const r = I::makeRight(P::right());
+    bench::escape(&a);
+    bench::escape(&l);
+    bench::escape(&r);
+    while (state.running()) {
+      a = l;
+      bench::doNotOptimize(a);
+      a = r;
+      bench::doNotOptimize(a);
+    }
+  }
+
+  template <class I, class P>
+  void emplaceRight(bench::State &state) {
+    typename I::Type a = I::makeRight(P::right());
+    typename P::R const r = P::right();
+    bench::escape(&a);
+    bench::escape(&r);
+    while (state.running()) {
+      I::emplaceRight(a, r);
+      bench::doNotOptimize(a);
+    }
+  }
+
+  // dispatch over a pseudo-random mix of lefts and rights (~25% left), so the
+  // branch isn't trivially predictable.
+  template <class I, class P>
+  void dispatch(bench::State &state) {
+    std::size_t const N = 1024;
+    std::vector<typename I::Type> values;
+    values.reserve(N);
+    unsigned seed = 12345;
+    for (std::size_t i = 0; i < N; ++i) {
+      seed = seed * 1103515245u + 12345u;
+      values.push_back((seed >> 16) % 4 == 0 ? I::makeLeft(P::left()) : I::makeRight(P::right()));
+    }
+    bench::escape(values.data());
+    std::size_t i = 0, sum = 0;
+    while (state.running()) {
+      sum += I::dispatch(values[i++ & (N - 1)]);
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I, class P>
+  void compare(bench::State &state) {
+    typename I::Type const a = I::makeRight(P::right());
+    typename I::Type const b = I::makeRight(P::right());
+    bench::escape(&a);
+    bench::escape(&b);
+    while (state.running()) {
+      bool eq = a == b;
+      bench::doNotOptimize(eq);
+    }
+  }
+
+  template <class I, class P>
+  void swapCross(bench::State &state) {
+    typename I::Type a = I::makeLeft(P::left());
+    typename I::Type b = I::makeRight(P::right());
+    bench::escape(&a);
+    bench::escape(&b);
+    while (state.running()) {
+      using std::swap;
+      swap(a, b);
+      bench::doNotOptimize(a);
+    }
+  }
+
+  template <template <class, class> class Impl, class P>
+  void addSuite() {
+    typedef Impl<typename P::L, typename P::R> I;
+    std::string const p = std::string("/") + P::name();
+    bench::add("ConstructLeft" + p, I::name(), &constructLeft<I, P>, I::baseline);
+    bench::add("ConstructRight" + p, I::name(), &constructRight<I, P>, I::baseline);
+    bench::add("Copy" + p, I::name(), &copy<I, P>, I::baseline);
+    bench::add("MoveRoundTrip" + p, I::name(), &moveRoundTrip<I, P>, I::baseline);
+    bench::add("AssignSame" + p, I::name(), &assignSame<I, P>, I::baseline);
+    bench::add("AssignCross" + p, I::name(), &assignCross<I, P>, I::baseline);
+    bench::add("EmplaceRight" + p, I::name(), &emplaceRight<I, P>, I::baseline);
+    bench::add("Dispatch" + p, I::name(), &dispatch<I, P>, I::baseline);
+    bench::add("Compare" + p, I::name(), &compare<I, P>, I::baseline);
+    bench::add("Swap" + p, I::name(), &swapCross<I, P>, I::baseline);
+  }
+
+  // Lookup/LargeStruct: find a 512-byte record in a std::map, returning it
+  // by copy (the baseline), as an Either of a reference, or wrapped in a
+  // std::reference_wrapper. The caller reads one field.
+
+  struct Record {
+    int id;
+    int fields[127];
+  };
+
+  typedef std::map<int, Record> Table;
+
+  struct LookupByCopy {
+    static char const *name() { return "Either_copy"; }
+    static bool const baseline = true;
+    typedef funky::Either<int, Record> Type;
+    __attribute__((noinline)) static Type find(Table const &t, int key) {
+      Table::const_iterator it = t.find(key);
+      if (it == t.end()) return 404;
+      return it->second;
+    }
+    static int id(Type const &e) { return e.right().id; }
+  };
+
+  struct LookupByReference {
+    static char const *name() { return "Either_reference"; }
+    static bool const baseline = false;
+    typedef funky::Either<int, Record const &> Type;
+    __attribute__((noinline)) static Type find(Table const &t, int key) {
+      Table::const_iterator it = t.find(key);
+      if (it == t.end()) return 404;
+      return it->second;
+    }
+    static int id(Type const &e) { return e.right().id; }
+  };
+
+  struct LookupByReferenceWrapper {
+    static char const *name() { return "reference_wrapper"; }
+    static bool const baseline = false;
+    typedef funky::Either<int, std::reference_wrapper<Record const>> Type;
+    __attribute__((noinline)) static Type find(Table const &t, int key) {
+      Table::const_iterator it = t.find(key);
+      if (it == t.end()) return 404;
+      return std::cref(it->second);
+    }
+    static int id(Type const &e) { return e.right().get().id; }
+  };
+
+  template <class I>
+  void lookup(bench::State &state) {
+    Table table;
+    for (int i = 0; i < 64; ++i) {
+      Record r = Record();
+      r.id = i;
+      table[i] = r;
+    }
+    bench::escape(&table);
+    int key = 0;
+    long sum = 0;
+    while (state.running()) {
+      typename I::Type e = I::find(table, key++ & 63);
+      if (e.isRight()) {
+        sum += I::id(e);
+      }
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I>
+  void addLookup() {
+    bench::add("Lookup/LargeStruct", I::name(), &lookup<I>, I::baseline);
+  }
+
+  // ConstructFrom/4KB and EmplaceFrom/4KB: make a 4 KB payload with a
+  // function and put it in an Either, either by moving the result in (the
+  // baseline), or with fromInvoke() and emplaceRightFrom(), which construct
+  // it in place (emplaceRightFrom through a noexcept lambda, since before
+  // C++17 a function's noexcept isn't part of its type).
+
+  struct Page {
+    unsigned char bytes[4096];
+  };
+
+  __attribute__((noinline)) Page makePage(unsigned char fill) noexcept {
+    Page p;
+    std::memset(p.bytes, fill, sizeof(p.bytes));
+    return p;
+  }
+
+  typedef funky::Either<int, Page> PageResult;
+
+  void constructMovingIn(bench::State &state) {
+    unsigned char fill = 0;
+    while (state.running()) {
+      PageResult e{makePage(++fill)};
+      bench::doNotOptimize(e.right().bytes[100]);
+      bench::clobberMemory();
+    }
+  }
+
+  void constructFromInvoke(bench::State &state) {
+    unsigned char fill = 0;
+    while (state.running()) {
+      PageResult e = PageResult::fromInvoke(funky::EmplaceRight, makePage, ++fill);
+      bench::doNotOptimize(e.right().bytes[100]);
+      bench::clobberMemory();
+    }
+  }
+
+  void emplaceMovingIn(bench::State &state) {
+    PageResult e{7};
+    bench::escape(&e);
+    unsigned char fill = 0;
+    while (state.running()) {
+      e.emplaceRight(makePage(++fill));
+      bench::clobberMemory();
+    }
+  }
+
+  void emplaceFromInvoke(bench::State &state) {
+    PageResult e{7};
+    bench::escape(&e);
+    unsigned char fill = 0;
+    while (state.running()) {
+      e.emplaceRightFrom([](unsigned char f) noexcept { return makePage(f); }, ++fill);
+      bench::clobberMemory();
+    }
+  }
+
+  // RightOr/HeapOwning: take the vector out of a returned Either, or compute
+  // a default for the ~25% that are Lefts. With `e.isRight() ? e.right() :
+  // fallback()` (the baseline), which copies the Right, or with
+  // std::move(e).rightOrElse(fallback), which moves it.
+
+  typedef funky::Either<int, std::vector<int>> VectorResult;
+
+  __attribute__((noinline)) VectorResult fetch(unsigned i) {
+    if ((i & 3) == 0) return 404;
+    return std::vector<int>(32, static_cast<int>(i));
+  }
+
+  __attribute__((noinline)) std::vector<int> fallback() {
+    return std::vector<int>(4, 0);
+  }
+
+  void rightOrTernary(bench::State &state) {
+    unsigned i = 0;
+    std::size_t sum = 0;
+    while (state.running()) {
+      VectorResult e = fetch(i++);
+      std::vector<int> v = e.isRight() ? e.right() : fallback();
+      sum += v.size();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  void rightOrElseMoving(bench::State &state) {
+    unsigned i = 0;
+    std::size_t sum = 0;
+    while (state.running()) {
+      std::vector<int> v = fetch(i++).rightOrElse(fallback);
+      sum += v.size();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <template <class, class> class Impl>
+  void addImpl() {
+    addSuite<Impl, Trivial>();
+    addSuite<Impl, SmallString>();
+    addSuite<Impl, HeapOwning>();
+  }
+
+  struct Register {
+    Register() {
+      addImpl<EitherImpl>();
+      addImpl<TaggedImpl>();
+      addLookup<LookupByCopy>();
+      addLookup<LookupByReference>();
+      addLookup<LookupByReferenceWrapper>();
+      bench::add("ConstructFrom/4KB", "moveIn", &constructMovingIn, true);
+      bench::add("ConstructFrom/4KB", "fromInvoke", &constructFromInvoke, false);
+      bench::add("EmplaceFrom/4KB", "emplaceRight", &emplaceMovingIn, true);
+      bench::add("EmplaceFrom/4KB", "emplaceRightFrom", &emplaceFromInvoke, false);
+      bench::add("RightOr/HeapOwning", "ternary", &rightOrTernary, true);
+      bench::add("RightOr/HeapOwning", "rightOrElse", &rightOrElseMoving, false);
+#if __cplusplus >= 201703L
+      addImpl<VariantImpl>();
+      addImpl<OptionalImpl>();
+#endif
+    }
+  } registerEitherBenchmarks;
+
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/EitherCoroutine.hh"
+
+// co_await on Either against the hand-written early return it replaces, for a
+// three step pipeline that either succeeds or fails at the second step. Only
+// built with C++20 coroutines, e.g. `make bench Std=c++20 Out=build/c++20`.
+
+#if FUNKY_HAS_COROUTINES
+
+namespace {
+
+  using funky::Either;
+
+  typedef Either<int, long> Step;
+
+  // out of line, so the pipeline can't be folded away.
+  __attribute__((noinline)) Step parse(long v) {
+    if (v < 0) return -1;
+    return v + 1;
+  }
+
+  __attribute__((noinline)) Step check(long v) {
+    if (v % 2 == 0) return -2;
+    return v * 3;
+  }
+
+  __attribute__((noinline)) Step scale(long v) {
+    return v << 1;
+  }
+
+  Step handWritten(long v) {
+    Step a = parse(v);
+    if (a.isLeft()) return a.left();
+    Step b = check(a.right());
+    if (b.isLeft()) return b.left();
+    Step c = scale(b.right());
+    if (c.isLeft()) return c.left();
+    return c.right() + 1;
+  }
+
+  Step coroutine(long v) {
+    long const a = co_await parse(v);
+    long const b = co_await check(a);
+    long const c = co_await scale(b);
+    co_return c + 1;
+  }
+
+  Step coroutineInArena(funky::CoroutineArena &, long v) {
+    long const a = co_await parse(v);
+    long const b = co_await check(a);
+    long const c = co_await scale(b);
+    co_return c + 1;
+  }
+
+  // inputs that succeed (even) or fail at check() (odd).
+  template <Step (*Fn)(long)>
+  void run(bench::State &state, long first) {
+    long v = first;
+    bench::escape(&v);
+    long sum = 0;
+    while (state.running()) {
+      Step const s = Fn(v);
+      sum += s.isLeft() ? s.left() : s.right();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  void runInArena(bench::State &state, long first) {
+    alignas(std::max_align_t) unsigned char buffer[1024];
+    funky::CoroutineArena arena{buffer};
+    long v = first;
+    bench::escape(&v);
+    long sum = 0;
+    while (state.running()) {
+      Step const s = coroutineInArena(arena, v);
+      sum += s.isLeft() ? s.left() : s.right();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  BENCH_BASELINE(EarlyReturn_Right, HandWritten) { run<handWritten>(state, 2); }
+  BENCH(EarlyReturn_Right, Coroutine) { run<coroutine>(state, 2); }
+  BENCH(EarlyReturn_Right, Coroutine_arena) { runInArena(state, 2); }
+
+  BENCH_BASELINE(EarlyReturn_Left, HandWritten) { run<handWritten>(state, 1); }
+  BENCH(EarlyReturn_Left, Coroutine) { run<coroutine>(state, 1); }
+  BENCH(EarlyReturn_Left, Coroutine_arena) { runInArena(state, 1); }
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/EitherFuture.hh"
+#include "funky/Queue.hh"
+
+#include <atomic>
+#include <exception>
+#include <future>
+#include <thread>
+#include <utility>
+
+// Round trips through EitherPromise/EitherFuture against std::promise and
+// std::future, with errors sent as a Left or as an exception respectively.
+//
+// Future/CrossThread hands each promise to a worker thread that fulfills it
+// while this thread waits, so it includes the wakeup. It needs two idle cores
+// to mean much.
+
+namespace {
+
+  struct Error {
+    int code;
+  };
+
+  struct Failure : std::exception {
+    explicit Failure(int code) : code(code) {}
+    int code;
+  };
+
+  struct StdImpl {
+    static char const *name() { return "std::future"; }
+    static bool const baseline = true;
+
+    typedef std::promise<long> Promise;
+    typedef std::future<long> Future;
+
+    static Future future(Promise &p) { return p.get_future(); }
+    static void succeed(Promise &p, long v) { p.set_value(v); }
+    static void fail(Promise &p, int code) { p.set_exception(std::make_exception_ptr(Failure{code})); }
+
+    static long get(Future &f) {
+      try {
+        return f.get();
+      } catch (Failure const &e) {
+        return -e.code;
+      }
+    }
+  };
+
+  struct EitherImpl {
+    static char const *name() { return "EitherFuture"; }
+    static bool const baseline = false;
+
+    typedef funky::EitherPromise<Error, long> Promise;
+    typedef funky::EitherFuture<Error, long> Future;
+
+    static Future future(Promise &p) { return p.getFuture(); }
+    static void succeed(Promise &p, long v) { p.emplaceRight(v); }
+    static void fail(Promise &p, int code) { p.emplaceLeft(Error{code}); }
+
+    static long get(Future &f) {
+      funky::Either<Error, long> const e = f.get();
+      return e.isLeft() ? -e.left().code : e.right();
+    }
+  };
+
+  template <class I>
+  void sameThread(bench::State &state) {
+    long v = 1;
+    while (state.running()) {
+      typename I::Promise p;
+      typename I::Future f = I::future(p);
+      I::succeed(p, v);
+      v = I::get(f);
+    }
+    bench::doNotOptimize(v);
+  }
+
+  template <class I>
+  void sameThreadError(bench::State &state) {
+    long v = 1;
+    while (state.running()) {
+      typename I::Promise p;
+      typename I::Future f = I::future(p);
+      I::fail(p, static_cast<int>(v));
+      v = -I::get(f);
+    }
+    bench::doNotOptimize(v);
+  }
+
+  template <class I>
+  void crossThread(bench::State &state) {
+    funky::SpscQueue<typename I::Promise> toWorker{64};
+    std::atomic<bool> done{false};
+    std::thread worker{[&] {
+      long v = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        if (!toWorker.tryConsume([&v](typename I::Promise &&p) { I::succeed(p, ++v); })) {
+          std::this_thread::yield();
+        }
+      }
+    }};
+
+    long sum = 0;
+    while (state.running()) {
+      typename I::Promise p;
+      typename I::Future f = I::future(p);
+      toWorker.tryPush(std::move(p));
+      sum += I::get(f);
+    }
+    done.store(true, std::memory_order_relaxed);
+    worker.join();
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I>
+  void addImpl() {
+    bench::add("Future/SameThread", I::name(), &sameThread<I>, I::baseline);
+    bench::add("Future/SameThreadError", I::name(), &sameThreadError<I>, I::baseline);
+    bench::add("Future/CrossThread", I::name(), &crossThread<I>, I::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addImpl<StdImpl>();
+      addImpl<EitherImpl>();
+    }
+  } registerFutureBenchmarks;
+
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#define FUNKY_EITHER_TELEMETRY
+#include "Bench.hh"
+#include "funky/Either.hh"
+
+// The cost of Left telemetry. These register into the same families as the
+// plain Either benchmarks in Either.cc, so they're reported side by side.
+//
+// The Left is a struct local to this file rather than an int: Eithers built
+// with and without telemetry must be distinct types.
+
+namespace {
+
+  struct Code {
+    int value;
+  };
+
+  typedef funky::Either<Code, double> Counted;
+
+  BENCH(ConstructLeft_Trivial, Either_telemetry) {
+    Code const l{7};
+    bench::escape(&l);
+    while (state.running()) {
+      Counted e{l};
+      bench::doNotOptimize(e);
+    }
+  }
+
+  BENCH(ConstructRight_Trivial, Either_telemetry) {
+    double const r = 3.5;
+    bench::escape(&r);
+    while (state.running()) {
+      Counted e{r};
+      bench::doNotOptimize(e);
+    }
+  }
+
+}
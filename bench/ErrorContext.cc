@@ -0,0 +1,121 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Either.hh"
+#include "funky/ErrorContext.hh"
+#include "funky/ErrorMessage.hh"
+
+#include <memory>
+#include <utility>
+
+// An error that starts six calls down and has a message added by each layer
+// on its way up, after which the caller reads the root message and handles
+// the next request (ErrorContext/Propagate6). Each layer wraps the error in
+// a new one owning its cause through a std::unique_ptr (the baseline), or
+// adds a node to an ErrorContext chain in the thread's ErrorArena, which is
+// rewound once per request.
+
+namespace {
+
+  using funky::Either;
+  using funky::ErrorArena;
+  using funky::ErrorContext;
+  using funky::ErrorMessage;
+
+  struct WrappedError {
+    WrappedError(ErrorMessage m, std::unique_ptr<WrappedError> c)
+      : message(m), cause(std::move(c)) {}
+
+    ErrorMessage message;
+    std::unique_ptr<WrappedError> cause;
+  };
+
+  struct UniquePtrImpl {
+    static char const *name() { return "unique_ptr"; }
+    static bool const baseline = true;
+    typedef WrappedError Error;
+    typedef Either<Error, int> Result;
+
+    __attribute__((noinline)) static Result open(int v) {
+      if (v >= 0) return Error{ErrorMessage{"connection refused"}, nullptr};
+      return v;
+    }
+
+    static Result wrap(Result r) {
+      if (r.isLeft()) {
+        std::unique_ptr<WrappedError> cause{new WrappedError(std::move(r.left()))};
+        return Error{ErrorMessage{"in a layer"}, std::move(cause)};
+      }
+      return r;
+    }
+
+    static ErrorMessage const &root(Error const &e) {
+      Error const *p = &e;
+      while (p->cause) {
+        p = p->cause.get();
+      }
+      return p->message;
+    }
+
+    // nothing to clean up between requests, the chain frees itself.
+    struct Request {
+      Request() {}
+    };
+  };
+
+  struct ArenaImpl {
+    static char const *name() { return "ErrorContext"; }
+    static bool const baseline = false;
+    typedef ErrorContext Error;
+    typedef Either<Error, int> Result;
+
+    __attribute__((noinline)) static Result open(int v) {
+      if (v >= 0) return ErrorContext{"connection refused"};
+      return v;
+    }
+
+    static Result wrap(Result r) { return withContext(std::move(r), "in a layer"); }
+
+    static ErrorMessage const &root(Error const &e) { return e.rootMessage(); }
+
+    typedef ErrorArena::Scope Request;
+  };
+
+  // Layer N calls layer N - 1 and wraps its error; layer 0 opens.
+  template <class I, int N>
+  struct Layer {
+    __attribute__((noinline)) static typename I::Result call(int v) {
+      return I::wrap(Layer<I, N - 1>::call(v));
+    }
+  };
+
+  template <class I>
+  struct Layer<I, 0> {
+    static typename I::Result call(int v) { return I::open(v); }
+  };
+
+  template <class I>
+  void run(bench::State &state) {
+    int v = 1;
+    bench::escape(&v);
+    std::size_t sum = 0;
+    while (state.running()) {
+      typename I::Request request;
+      typename I::Result r = Layer<I, 6>::call(v);
+      if (r.isLeft()) {
+        sum += I::root(r.left()).size();
+      }
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  struct Register {
+    Register() {
+      bench::add("ErrorContext/Propagate6", UniquePtrImpl::name(), &run<UniquePtrImpl>, UniquePtrImpl::baseline);
+      bench::add("ErrorContext/Propagate6", ArenaImpl::name(), &run<ArenaImpl>, ArenaImpl::baseline);
+    }
+  } registerErrorContextBenchmarks;
+
+}
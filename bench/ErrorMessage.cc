@@ -0,0 +1,109 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Either.hh"
+#include "funky/ErrorMessage.hh"
+
+#include <string>
+
+// Failing calls that return an Either with the error message as its Left,
+// which the caller checks and moves into a log record. ErrorMessage
+// against std::string (the baseline), for:
+//
+// - Error/ShortLiteral: a literal short enough for std::string's inline
+//   buffer.
+// - Error/LongLiteral: a literal too long for it, so std::string allocates.
+// - Error/Formatted: a message with a number in it, built with
+//   std::to_string and operator+ for std::string, and format() for
+//   ErrorMessage.
+
+namespace {
+
+  using funky::Either;
+  using funky::ErrorMessage;
+
+  template <class Message>
+  struct Record {
+    Record() : code(0), message() {}
+    int code;
+    Message message;
+  };
+
+  struct StringImpl {
+    static char const *name() { return "std::string"; }
+    static bool const baseline = true;
+    typedef std::string Message;
+
+    __attribute__((noinline)) static Either<Message, int> shortLiteral(int v) {
+      if (v >= 0) return Message{"bad input"};
+      return v;
+    }
+
+    __attribute__((noinline)) static Either<Message, int> longLiteral(int v) {
+      if (v >= 0) return Message{"the input was not a valid port number"};
+      return v;
+    }
+
+    __attribute__((noinline)) static Either<Message, int> formatted(int v) {
+      if (v >= 0) return "port " + std::to_string(v) + " out of range";
+      return v;
+    }
+  };
+
+  struct ErrorMessageImpl {
+    static char const *name() { return "ErrorMessage"; }
+    static bool const baseline = false;
+    typedef ErrorMessage Message;
+
+    __attribute__((noinline)) static Either<Message, int> shortLiteral(int v) {
+      if (v >= 0) return Message{"bad input"};
+      return v;
+    }
+
+    __attribute__((noinline)) static Either<Message, int> longLiteral(int v) {
+      if (v >= 0) return Message::fromStatic("the input was not a valid port number");
+      return v;
+    }
+
+    __attribute__((noinline)) static Either<Message, int> formatted(int v) {
+      if (v >= 0) return ErrorMessage::format("port %d out of range", v);
+      return v;
+    }
+  };
+
+  template <class I, Either<typename I::Message, int> (*Fn)(int)>
+  void run(bench::State &state) {
+    int v = 70000;
+    bench::escape(&v);
+    Record<typename I::Message> log[16];
+    std::size_t n = 0, sum = 0;
+    while (state.running()) {
+      Either<typename I::Message, int> e = Fn(v);
+      if (e.isLeft()) {
+        Record<typename I::Message> &r = log[n++ % 16];
+        r.code = 1;
+        r.message = std::move(e).left();
+        sum += r.message.size();
+      }
+    }
+    bench::escape(log);
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I>
+  void addImpl() {
+    bench::add("Error/ShortLiteral", I::name(), &run<I, &I::shortLiteral>, I::baseline);
+    bench::add("Error/LongLiteral", I::name(), &run<I, &I::longLiteral>, I::baseline);
+    bench::add("Error/Formatted", I::name(), &run<I, &I::formatted>, I::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addImpl<StringImpl>();
+      addImpl<ErrorMessageImpl>();
+    }
+  } registerErrorMessageBenchmarks;
+
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Either.hh"
+#include "funky/ErrorMessage.hh"
+#include "funky/InternedError.hh"
+
+#include <string>
+
+// A call that always fails with one of four canonical errors, in turn,
+// whose caller retries on "timed out" and counts the rest
+// (InternedError/Classify). The error is a std::string (the baseline), an
+// ErrorMessage made from a literal, or an InternedError, for which making
+// the error is storing a pointer and classifying it is comparing one.
+
+namespace {
+
+  using funky::Either;
+  using funky::ErrorMessage;
+  using funky::InternedError;
+
+  struct StringImpl {
+    static char const *name() { return "std::string"; }
+    static bool const baseline = true;
+    typedef std::string Error;
+
+    __attribute__((noinline)) static Either<Error, int> call(unsigned i) {
+      switch (i & 3) {
+        case 0: return Error{"not found"};
+        case 1: return Error{"permission denied"};
+        case 2: return Error{"timed out"};
+        default: return Error{"unavailable"};
+      }
+    }
+
+    static bool isTimeout(Error const &e) { return e == "timed out"; }
+  };
+
+  struct ErrorMessageImpl {
+    static char const *name() { return "ErrorMessage"; }
+    static bool const baseline = false;
+    typedef ErrorMessage Error;
+
+    __attribute__((noinline)) static Either<Error, int> call(unsigned i) {
+      switch (i & 3) {
+        case 0: return Error{"not found"};
+        case 1: return Error{"permission denied"};
+        case 2: return Error{"timed out"};
+        default: return Error{"unavailable"};
+      }
+    }
+
+    static bool isTimeout(Error const &e) { return e == "timed out"; }
+  };
+
+  struct InternedImpl {
+    static char const *name() { return "InternedError"; }
+    static bool const baseline = false;
+    typedef InternedError Error;
+
+    __attribute__((noinline)) static Either<Error, int> call(unsigned i) {
+      switch (i & 3) {
+        case 0: return InternedError::notFound();
+        case 1: return InternedError::permissionDenied();
+        case 2: return InternedError::timedOut();
+        default: return InternedError::unavailable();
+      }
+    }
+
+    static bool isTimeout(Error const &e) { return e == InternedError::timedOut(); }
+  };
+
+  template <class I>
+  void classify(bench::State &state) {
+    unsigned i = 0;
+    std::size_t retries = 0, failures = 0;
+    while (state.running()) {
+      Either<typename I::Error, int> e = I::call(i++);
+      if (e.isLeft()) {
+        if (I::isTimeout(e.left())) {
+          ++retries;
+        } else {
+          ++failures;
+        }
+      }
+    }
+    bench::doNotOptimize(retries);
+    bench::doNotOptimize(failures);
+  }
+
+  template <class I>
+  void addImpl() {
+    bench::add("InternedError/Classify", I::name(), &classify<I>, I::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addImpl<StringImpl>();
+      addImpl<ErrorMessageImpl>();
+      addImpl<InternedImpl>();
+    }
+  } registerInternedErrorBenchmarks;
+
+}
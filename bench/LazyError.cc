@@ -0,0 +1,102 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Either.hh"
+#include "funky/ErrorMessage.hh"
+#include "funky/LazyError.hh"
+
+#include <cstdio>
+#include <string>
+
+// A validation call that always fails with a formatted message, where the
+// caller only reads the message of one failure in a hundred
+// (LazyError/Read1Percent) or of every one (LazyError/Read100Percent).
+// The message is formatted eagerly into a std::string (the baseline) or an
+// ErrorMessage, or captured by a LazyError and rendered when it's read.
+
+namespace {
+
+  using funky::Either;
+  using funky::ErrorMessage;
+  using funky::LazyError;
+
+  struct StringImpl {
+    static char const *name() { return "Eager_std::string"; }
+    static bool const baseline = true;
+    typedef std::string Error;
+
+    __attribute__((noinline)) static Either<Error, int> check(int field, long v) {
+      if (v > 100) {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "field %d: %ld is more than %d", field, v, 100);
+        return Error{buffer};
+      }
+      return field;
+    }
+
+    static std::size_t read(Error const &e) { return e.size(); }
+  };
+
+  struct ErrorMessageImpl {
+    static char const *name() { return "Eager_ErrorMessage"; }
+    static bool const baseline = false;
+    typedef ErrorMessage Error;
+
+    __attribute__((noinline)) static Either<Error, int> check(int field, long v) {
+      if (v > 100) return ErrorMessage::format("field %d: %ld is more than %d", field, v, 100);
+      return field;
+    }
+
+    static std::size_t read(Error const &e) { return e.size(); }
+  };
+
+  struct LazyImpl {
+    static char const *name() { return "LazyError"; }
+    static bool const baseline = false;
+    typedef LazyError Error;
+
+    __attribute__((noinline)) static Either<Error, int> check(int field, long v) {
+      if (v > 100) return LazyError{"field %d: %ld is more than %d", field, v, 100};
+      return field;
+    }
+
+    static std::size_t read(Error const &e) { return e.message().size(); }
+  };
+
+  template <class I, unsigned ReadEvery>
+  void run(bench::State &state) {
+    long v = 12345;
+    bench::escape(&v);
+    unsigned i = 0;
+    std::size_t failures = 0, sum = 0;
+    while (state.running()) {
+      Either<typename I::Error, int> e = I::check(7, v);
+      if (e.isLeft()) {
+        ++failures;
+        if (++i == ReadEvery) {
+          i = 0;
+          sum += I::read(e.left());
+        }
+      }
+    }
+    bench::doNotOptimize(failures);
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I>
+  void addImpl() {
+    bench::add("LazyError/Read1Percent", I::name(), &run<I, 100>, I::baseline);
+    bench::add("LazyError/Read100Percent", I::name(), &run<I, 1>, I::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addImpl<StringImpl>();
+      addImpl<ErrorMessageImpl>();
+      addImpl<LazyImpl>();
+    }
+  } registerLazyErrorBenchmarks;
+
+}
@@ -0,0 +1,225 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Parser.hh"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
+
+// The combinators against a hand-written parser for the same CSV-like
+// grammar, `id,name,score\n` with an unsigned id, a name of anything but ','
+// and '\n', and a signed score. Both report errors as a ParseError.
+//
+// - Csv/Row parses one record per operation, cycling through 1000 of them.
+// - Csv/File folds all 1000 into totals per operation.
+
+namespace {
+
+  using funky::ParseError;
+  using funky::ParseInput;
+  using funky::ParseResult;
+
+  struct Row {
+    unsigned id;
+    ParseInput name;
+    long score;
+  };
+
+  struct Totals {
+    std::uint64_t ids;
+    std::uint64_t nameBytes;
+    long score;
+  };
+
+  void add(Totals &t, Row const &r) {
+    t.ids += r.id;
+    t.nameBytes += r.name.size;
+    t.score += r.score;
+  }
+
+  std::string const &records() {
+    static std::string const text = [] {
+      static char const *const names[] = {"ada", "grace", "edsger", "barbara", "", "ken", "dennis", "frances"};
+      std::string s;
+      for (unsigned i = 0; i < 1000; ++i) {
+        s += std::to_string(i * 7919 % 100000);
+        s += ',';
+        s += names[i % 8];
+        s += ',';
+        s += std::to_string(static_cast<long>(i * 31) - 9000);
+        s += '\n';
+      }
+      return s;
+    }();
+    return text;
+  }
+
+  // ------------------------------------------------------------------------
+  // hand-written
+
+  struct HandWritten {
+    static char const *name() { return "HandWritten"; }
+    static bool const baseline = true;
+
+    static ParseResult<Row> row(ParseInput in) {
+      char const *p = in.data, *const end = in.data + in.size;
+      if (p == end || static_cast<unsigned>(*p - '0') > 9) {
+        return ParseError{p, "digit"};
+      }
+      unsigned id = 0;
+      while (p != end && static_cast<unsigned>(*p - '0') <= 9) {
+        if (__builtin_mul_overflow(id, 10u, &id) || __builtin_add_overflow(id, static_cast<unsigned>(*p - '0'), &id)) {
+          return ParseError{in.data, "integer in range"};
+        }
+        ++p;
+      }
+      if (p == end || *p != ',') {
+        return ParseError{p, "','"};
+      }
+      char const *const name = ++p;
+      while (p != end && *p != ',' && *p != '\n') {
+        ++p;
+      }
+      ParseInput const nameView{name, static_cast<std::size_t>(p - name)};
+      if (p == end || *p != ',') {
+        return ParseError{p, "','"};
+      }
+      char const *const number = ++p;
+      bool const negative = p != end && *p == '-';
+      if (negative) {
+        ++p;
+      }
+      if (p == end || static_cast<unsigned>(*p - '0') > 9) {
+        return ParseError{p, "digit"};
+      }
+      unsigned long v = 0;
+      while (p != end && static_cast<unsigned>(*p - '0') <= 9) {
+        if (__builtin_mul_overflow(v, 10ul, &v) || __builtin_add_overflow(v, static_cast<unsigned long>(*p - '0'), &v)) {
+          return ParseError{number, "integer in range"};
+        }
+        ++p;
+      }
+      if (v > static_cast<unsigned long>(std::numeric_limits<long>::max()) + (negative ? 1 : 0)) {
+        return ParseError{number, "integer in range"};
+      }
+      long const score = negative ? static_cast<long>(0ul - v) : static_cast<long>(v);
+      if (p == end || *p != '\n') {
+        return ParseError{p, "'\\n'"};
+      }
+      ++p;
+      return ParseResult<Row>{funky::EmplaceRight, Row{id, nameView, score}, ParseInput{p, static_cast<std::size_t>(end - p)}};
+    }
+
+    static funky::Either<ParseError, Totals> file(ParseInput in) {
+      Totals t{0, 0, 0};
+      while (!in.empty()) {
+        ParseResult<Row> r = row(in);
+        if (r.isLeft()) {
+          return r.left();
+        }
+        add(t, r.right().first);
+        in = r.right().second;
+      }
+      return t;
+    }
+  };
+
+  // ------------------------------------------------------------------------
+  // combinators
+
+  struct NotSeparator {
+    bool operator()(char c) const { return c != ',' && c != '\n'; }
+  };
+
+  struct MakeRow {
+    Row operator()(std::tuple<unsigned, ParseInput, long> &&t) const {
+      return Row{std::get<0>(t), std::get<1>(t), std::get<2>(t)};
+    }
+  };
+
+  struct AddRow {
+    void operator()(Totals &t, Row const &r) const { add(t, r); }
+  };
+
+  struct Combinators {
+    static char const *name() { return "Combinators"; }
+    static bool const baseline = false;
+
+    static decltype(funky::fmap(
+      funky::keepFirst(funky::sequence(funky::integer<unsigned>(),
+                                       funky::keepSecond(funky::character(','), funky::takeWhile(NotSeparator{})),
+                                       funky::keepSecond(funky::character(','), funky::integer<long>())),
+                       funky::character('\n')),
+      MakeRow{})) grammar() {
+      using namespace funky;
+      return fmap(keepFirst(sequence(integer<unsigned>(),
+                                     keepSecond(character(','), takeWhile(NotSeparator{})),
+                                     keepSecond(character(','), integer<long>())),
+                            character('\n')),
+                  MakeRow{});
+    }
+
+    static ParseResult<Row> row(ParseInput in) {
+      return grammar()(in);
+    }
+
+    static funky::Either<ParseError, Totals> file(ParseInput in) {
+      using namespace funky;
+      ParseResult<Totals> r = keepFirst(many(grammar(), Totals{0, 0, 0}, AddRow{}), endOfInput())(in);
+      if (r.isLeft()) {
+        return r.left();
+      }
+      return r.right().first;
+    }
+  };
+
+  template <class I>
+  void rows(bench::State &state) {
+    std::string const &text = records();
+    ParseInput const all{text.data(), text.size()};
+    ParseInput in = all;
+    bench::escape(&in);
+    Totals t{0, 0, 0};
+    while (state.running()) {
+      ParseResult<Row> r = I::row(in);
+      if (r.isLeft()) {
+        break;
+      }
+      add(t, r.right().first);
+      in = r.right().second.empty() ? all : r.right().second;
+    }
+    bench::doNotOptimize(t);
+  }
+
+  template <class I>
+  void file(bench::State &state) {
+    std::string const &text = records();
+    ParseInput in{text.data(), text.size()};
+    bench::escape(&in);
+    std::uint64_t sum = 0;
+    while (state.running()) {
+      funky::Either<ParseError, Totals> t = I::file(in);
+      sum += t.isLeft() ? 0 : t.right().ids;
+      bench::clobberMemory();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I>
+  void addImpl() {
+    bench::add("Csv/Row", I::name(), &rows<I>, I::baseline);
+    bench::add("Csv/File", I::name(), &file<I>, I::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addImpl<HandWritten>();
+      addImpl<Combinators>();
+    }
+  } registerParserBenchmarks;
+
+}
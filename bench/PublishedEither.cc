@@ -0,0 +1,180 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Either.hh"
+#include "funky/PublishedEither.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A 1KB routing table that one thread changes an entry of now and then,
+// while one, two or four threads look routes up in it
+// (PublishedEither/1w1r, /1w2r and /1w4r). Readers take a copy of the
+// table, as they would to use it without holding anything. Each sample
+// times state.iterations() lookups, shared between the readers, so results
+// are in nanoseconds per lookup. The baseline is an Either behind a
+// std::mutex.
+//
+// As with Queue/, these are only meaningful with more idle cores than
+// threads.
+
+namespace {
+
+  using funky::Either;
+
+  enum class RouteError : std::uint8_t { Loading = 1 };
+
+  struct RoutingTable {
+    std::uint32_t nextHop[256];
+  };
+
+  typedef Either<RouteError, RoutingTable> Routes;
+
+  struct LockedImpl {
+    static char const *name() { return "mutex"; }
+    static bool const baseline = true;
+
+    explicit LockedImpl(Routes const &v) : mutex_(), value_(v) {}
+
+    Routes load() {
+      std::lock_guard<std::mutex> lock{mutex_};
+      return value_;
+    }
+
+    template <class Fn>
+    void update(Fn &&fn) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      fn(value_);
+    }
+
+  private:
+    std::mutex mutex_;
+    Routes value_;
+  };
+
+  struct PublishedImpl {
+    static char const *name() { return "PublishedEither"; }
+    static bool const baseline = false;
+
+    explicit PublishedImpl(Routes const &v) : value_(v) {}
+
+    Routes load() { return value_.load(); }
+
+    template <class Fn>
+    void update(Fn &&fn) {
+      value_.update(fn);
+    }
+
+  private:
+    funky::PublishedEither<RouteError, RoutingTable> value_;
+  };
+
+  template <class Impl, int Readers>
+  void readHeavy(bench::State &state) {
+    Impl routes{Routes{RoutingTable()}};
+    std::size_t const n = state.iterations();
+    std::atomic<bool> go{false}, done{false};
+
+    std::thread writer([&] {
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      std::uint32_t i = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        ++i;
+        routes.update([i](Routes &r) { r.right().nextHop[i % 256] = i; });
+        // a pause between updates, which also lets readers run when there
+        // are fewer cores than threads.
+        std::this_thread::yield();
+      }
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < Readers; ++r) {
+      readers.emplace_back([&routes, &go, n, r] {
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        std::size_t sum = 0;
+        for (std::size_t i = n * r / Readers; i < n * (r + 1) / Readers; ++i) {
+          Routes const table = routes.load();
+          sum += table.isRight() ? table.right().nextHop[i % 256] : 1;
+        }
+        bench::doNotOptimize(sum);
+      });
+    }
+
+    state.running(); // start the clock
+    go.store(true, std::memory_order_release);
+    for (std::thread &t : readers) {
+      t.join();
+    }
+    done.store(true, std::memory_order_relaxed);
+    writer.join();
+    while (state.running()) {
+    }
+  }
+
+  // A single reader and no writer, for payloads of 16 bytes to 4KB
+  // (PublishedEither/Load/16 to /Load/4096): load() against copying the
+  // Either itself (the baseline), which is the one copy a seqlock over the
+  // Either would make. What load() costs beyond that is its copies out of
+  // the published words and then into the Either.
+
+  template <std::size_t Bytes>
+  struct Payload {
+    unsigned char bytes[Bytes];
+  };
+
+  template <std::size_t Bytes>
+  void copyLoad(bench::State &state) {
+    Either<RouteError, Payload<Bytes>> const e{Payload<Bytes>()};
+    while (state.running()) {
+      bench::escape(&e);
+      Either<RouteError, Payload<Bytes>> const copy{e};
+      bench::doNotOptimize(copy);
+    }
+  }
+
+  template <std::size_t Bytes>
+  void publishedLoad(bench::State &state) {
+    funky::PublishedEither<RouteError, Payload<Bytes>> const e{Either<RouteError, Payload<Bytes>>{Payload<Bytes>()}};
+    while (state.running()) {
+      Either<RouteError, Payload<Bytes>> const copy = e.load();
+      bench::doNotOptimize(copy);
+    }
+  }
+
+  template <std::size_t Bytes>
+  void addLoad() {
+    std::string const family = "PublishedEither/Load/" + std::to_string(Bytes);
+    bench::add(family, "copy", &copyLoad<Bytes>, true);
+    bench::add(family, "PublishedEither", &publishedLoad<Bytes>);
+  }
+
+  template <int Readers>
+  void addFamily(std::string const &family) {
+    bench::add(family, LockedImpl::name(), &readHeavy<LockedImpl, Readers>, LockedImpl::baseline);
+    bench::add(family, PublishedImpl::name(), &readHeavy<PublishedImpl, Readers>, PublishedImpl::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addFamily<1>("PublishedEither/1w1r");
+      addFamily<2>("PublishedEither/1w2r");
+      addFamily<4>("PublishedEither/1w4r");
+      addLoad<16>();
+      addLoad<64>();
+      addLoad<256>();
+      addLoad<1024>();
+      addLoad<4096>();
+    }
+  } registerPublishedEitherBenchmarks;
+
+}
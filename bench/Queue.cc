@@ -0,0 +1,233 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Either.hh"
+#include "funky/Queue.hh"
+
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Throughput of handing Eithers between threads, at several producer and
+// consumer counts. Each sample starts the threads, then times the transfer of
+// state.iterations() items through the queue, so results are in nanoseconds per
+// item. The baseline is a mutex-guarded std::deque, bounded to the same
+// capacity.
+//
+// These are only meaningful with at least producers + consumers cores; with
+// fewer, the numbers mostly measure the scheduler.
+
+namespace {
+
+  struct Error {
+    int code;
+  };
+
+  struct Batch {
+    long rows[5];
+  };
+
+  typedef funky::Either<Error, Batch> Item;
+
+  int const Stop = -1; // Left code that tells a consumer to exit
+  std::size_t const Capacity = 1024;
+  std::size_t const BatchSize = 16;
+
+  Item makeItem(std::size_t i) {
+    if (i % 16 == 0) {
+      return Item{Error{static_cast<int>(i)}};
+    }
+    Batch const b = { { long(i), long(i), long(i), long(i), long(i) } };
+    return Item{b};
+  }
+
+  class LockedDeque {
+  public:
+    explicit LockedDeque(std::size_t capacity) : mutex_(), items_(), capacity_(capacity) {}
+
+    bool tryPush(Item &&item) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (items_.size() >= capacity_) {
+        return false;
+      }
+      items_.push_back(std::move(item));
+      return true;
+    }
+
+    std::size_t tryPushBatch(Item *items, std::size_t n) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      std::size_t count = 0;
+      for (; count < n && items_.size() < capacity_; ++count) {
+        items_.push_back(std::move(items[count]));
+      }
+      return count;
+    }
+
+    template <class Fn>
+    bool tryConsume(Fn &&fn) {
+      std::unique_lock<std::mutex> lock{mutex_};
+      if (items_.empty()) {
+        return false;
+      }
+      Item item{std::move(items_.front())};
+      items_.pop_front();
+      lock.unlock();
+      fn(std::move(item));
+      return true;
+    }
+
+    template <class OutIt>
+    std::size_t tryPopBatch(OutIt out, std::size_t max) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      std::size_t count = 0;
+      for (; count < max && !items_.empty(); ++count) {
+        *out = std::move(items_.front());
+        ++out;
+        items_.pop_front();
+      }
+      return count;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::deque<Item> items_;
+    std::size_t capacity_;
+  };
+
+  std::size_t weigh(Item const &item) {
+    return item.isLeft() ? std::size_t(item.left().code) : std::size_t(item.right().rows[0]);
+  }
+
+  // returns false once it has seen the stop marker.
+  bool take(Item &&item, std::size_t &sum) {
+    if (item.isLeft() && item.left().code == Stop) {
+      return false;
+    }
+    sum += weigh(item);
+    return true;
+  }
+
+  template <class Q, bool Batched>
+  void produce(Q &q, std::size_t begin, std::size_t end) {
+    if (Batched) {
+      std::vector<Item> batch;
+      for (std::size_t i = begin; i < end; i += batch.size()) {
+        batch.clear();
+        for (std::size_t j = i; j < end && j - i < BatchSize; ++j) {
+          batch.push_back(makeItem(j));
+        }
+        std::size_t done = 0;
+        while ((done += q.tryPushBatch(batch.data() + done, batch.size() - done)) < batch.size()) {
+          std::this_thread::yield();
+        }
+      }
+    } else {
+      for (std::size_t i = begin; i < end; ++i) {
+        while (!q.tryPush(makeItem(i))) {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  template <class Q, bool Batched>
+  void consume(Q &q) {
+    std::size_t sum = 0;
+    bool more = true;
+    if (Batched) {
+      std::vector<Item> got;
+      got.reserve(BatchSize);
+      while (more) {
+        got.clear();
+        if (q.tryPopBatch(std::back_inserter(got), BatchSize) == 0) {
+          std::this_thread::yield();
+        }
+        int stops = 0;
+        for (Item &item : got) {
+          stops += !take(std::move(item), sum);
+        }
+        // a batch may take other consumers' stop markers too; hand them back.
+        for (int i = 1; i < stops; ++i) {
+          while (!q.tryPush(Item{Error{Stop}})) {
+            std::this_thread::yield();
+          }
+        }
+        more = stops == 0;
+      }
+    } else {
+      while (more) {
+        if (!q.tryConsume([&](Item &&item) { more = take(std::move(item), sum); })) {
+          std::this_thread::yield();
+        }
+      }
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <class Q, int Producers, int Consumers, bool Batched>
+  void transfer(bench::State &state) {
+    Q q{Capacity};
+    std::size_t const n = state.iterations();
+    std::atomic<bool> go{false};
+
+    std::vector<std::thread> producers, consumers;
+    for (int p = 0; p < Producers; ++p) {
+      producers.emplace_back([&q, &go, n, p] {
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        produce<Q, Batched>(q, n * p / Producers, n * (p + 1) / Producers);
+      });
+    }
+    for (int c = 0; c < Consumers; ++c) {
+      consumers.emplace_back([&q] { consume<Q, Batched>(q); });
+    }
+
+    state.running(); // start the clock
+    go.store(true, std::memory_order_release);
+    for (std::thread &t : producers) {
+      t.join();
+    }
+    for (int c = 0; c < Consumers; ++c) {
+      while (!q.tryPush(Item{Error{Stop}})) {
+        std::this_thread::yield();
+      }
+    }
+    for (std::thread &t : consumers) {
+      t.join();
+    }
+    while (state.running()) {
+    }
+  }
+
+  template <int Producers, int Consumers>
+  void addFamily(bool spsc) {
+    std::string const family = "Queue/" + std::to_string(Producers) + "p" + std::to_string(Consumers) + "c";
+    bench::add(family, "LockedDeque", &transfer<LockedDeque, Producers, Consumers, false>, true);
+    bench::add(family, "LockedDeque_batch", &transfer<LockedDeque, Producers, Consumers, true>);
+    if (spsc) {
+      bench::add(family, "Spsc", &transfer<funky::SpscQueue<Item>, Producers, Consumers, false>);
+      bench::add(family, "Spsc_batch", &transfer<funky::SpscQueue<Item>, Producers, Consumers, true>);
+    }
+    bench::add(family, "Mpmc", &transfer<funky::MpmcQueue<Item>, Producers, Consumers, false>);
+    bench::add(family, "Mpmc_batch", &transfer<funky::MpmcQueue<Item>, Producers, Consumers, true>);
+  }
+
+  struct Register {
+    Register() {
+      addFamily<1, 1>(true);
+      addFamily<1, 4>(false);
+      addFamily<4, 1>(false);
+      addFamily<2, 2>(false);
+      addFamily<4, 4>(false);
+    }
+  } registerQueueBenchmarks;
+
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Either.hh"
+#include "funky/SharedEither.hh"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A configuration snapshot of 64 settings handed to 100 consumers, each of
+// which keeps its own copy and reads one setting from it
+// (SharedEither/FanOut100). Each copy is a plain Either (the baseline), or a
+// LocalSharedEither or SharedEither sharing one block.
+
+namespace {
+
+  struct Snapshot {
+    Snapshot() : settings(), version(0) {}
+
+    std::vector<std::string> settings;
+    int version;
+  };
+
+  Snapshot makeSnapshot() {
+    Snapshot s;
+    for (int i = 0; i < 64; ++i) {
+      s.settings.push_back("setting." + std::to_string(i) + " = a value too long for SSO");
+    }
+    s.version = 3;
+    return s;
+  }
+
+  struct EitherImpl {
+    static char const *name() { return "Either"; }
+    static bool const baseline = true;
+    typedef funky::Either<int, Snapshot> Type;
+  };
+
+  struct LocalSharedImpl {
+    static char const *name() { return "LocalSharedEither"; }
+    static bool const baseline = false;
+    typedef funky::LocalSharedEither<int, Snapshot> Type;
+  };
+
+  struct SharedImpl {
+    static char const *name() { return "SharedEither"; }
+    static bool const baseline = false;
+    typedef funky::SharedEither<int, Snapshot> Type;
+  };
+
+  template <class I>
+  void fanOut(bench::State &state) {
+    typename I::Type const source{funky::EmplaceRight, makeSnapshot()};
+    std::vector<typename I::Type> consumers;
+    consumers.reserve(100);
+    std::size_t sum = 0;
+    while (state.running()) {
+      for (int i = 0; i < 100; ++i) {
+        consumers.push_back(source);
+      }
+      for (typename I::Type const &c : consumers) {
+        sum += c.right().settings[static_cast<std::size_t>(c.right().version)].size();
+      }
+      consumers.clear();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I>
+  void addFanOut() {
+    bench::add("SharedEither/FanOut100", I::name(), &fanOut<I>, I::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addFanOut<EitherImpl>();
+      addFanOut<LocalSharedImpl>();
+      addFanOut<SharedImpl>();
+    }
+  } registerSharedEitherBenchmarks;
+
+}
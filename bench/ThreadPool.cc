@@ -0,0 +1,211 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/ThreadPool.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The work-stealing ThreadPool against a pool with one mutex-guarded queue,
+// on tasks of about 100ns each. One operation is a batch of 256 tasks:
+//
+// - Pool/Flat/<N>t submits them all from outside the pool and waits for
+//   them with whenAll.
+// - Pool/Nested/<N>t submits 16 tasks that each submit 16 more and wait for
+//   them, the way a validation pass fans out over the fields of a record.
+//
+// Families are registered for 1 to 8 threads, and up to the number of cores
+// on bigger machines. On a machine with fewer idle cores than threads, they
+// mostly measure the scheduler.
+
+namespace {
+
+  using funky::Either;
+  using funky::EitherFuture;
+
+  struct Error {
+    int code;
+  };
+
+  typedef Either<Error, std::uint64_t> Result;
+
+  // about 100ns of dependent arithmetic.
+  Result work(std::uint64_t seed) {
+    std::uint64_t x = seed | 1;
+    for (int i = 0; i < 64; ++i) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+    }
+    if (x == 0) {
+      return Error{1};
+    }
+    return x;
+  }
+
+  /// A pool with one queue that every worker and submitter locks, with the
+  /// same submit and helping get as funky::ThreadPool.
+  class CentralPool {
+  public:
+    explicit CentralPool(unsigned threads) : mutex_(), ready_(), queue_(), stopping_(false), threads_() {
+      for (unsigned i = 0; i < threads; ++i) {
+        threads_.emplace_back([this] { workerLoop(); });
+      }
+    }
+
+    ~CentralPool() {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stopping_ = true;
+      }
+      ready_.notify_all();
+      for (std::thread &t : threads_) {
+        t.join();
+      }
+    }
+
+    CentralPool(CentralPool const &) = delete;
+    CentralPool &operator=(CentralPool const &) = delete;
+
+    // every task in these benchmarks returns a Result.
+    template <class Fn>
+    EitherFuture<Error, std::uint64_t> submit(Fn fn) {
+      typedef funky::EitherPromise<Error, std::uint64_t> Promise;
+      std::shared_ptr<Promise> p = std::make_shared<Promise>();
+      EitherFuture<Error, std::uint64_t> f = p->getFuture();
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        queue_.push_back([p, fn] { p->set(fn()); });
+      }
+      ready_.notify_one();
+      return f;
+    }
+
+    template <class T>
+    Either<Error, T> get(EitherFuture<Error, T> f) {
+      while (!f.isReady()) {
+        std::function<void()> task;
+        {
+          std::lock_guard<std::mutex> lock{mutex_};
+          if (!queue_.empty()) {
+            task = std::move(queue_.front());
+            queue_.pop_front();
+          }
+        }
+        if (task) {
+          task();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      return f.get();
+    }
+
+  private:
+    void workerLoop() {
+      for (;;) {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock{mutex_};
+          ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+          if (queue_.empty()) {
+            return;
+          }
+          task = std::move(queue_.front());
+          queue_.pop_front();
+        }
+        task();
+      }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_;
+    std::vector<std::thread> threads_;
+  };
+
+  template <class Pool, unsigned Threads>
+  void flat(bench::State &state) {
+    Pool pool{Threads};
+    std::uint64_t sum = 0, seed = 1;
+    while (state.running()) {
+      std::vector<EitherFuture<Error, std::uint64_t>> fs;
+      fs.reserve(256);
+      for (int i = 0; i < 256; ++i) {
+        std::uint64_t const s = seed++;
+        fs.push_back(pool.submit([s] { return work(s); }));
+      }
+      Either<Error, std::vector<std::uint64_t>> all = pool.get(funky::whenAll(std::move(fs)));
+      sum += all.right().back();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <class Pool, unsigned Threads>
+  void nested(bench::State &state) {
+    Pool pool{Threads};
+    std::uint64_t sum = 0, seed = 1;
+    while (state.running()) {
+      std::vector<EitherFuture<Error, std::uint64_t>> outer;
+      outer.reserve(16);
+      for (int i = 0; i < 16; ++i) {
+        std::uint64_t const base = (seed++) << 4;
+        outer.push_back(pool.submit([&pool, base]() -> Result {
+          std::vector<EitherFuture<Error, std::uint64_t>> inner;
+          inner.reserve(16);
+          for (std::uint64_t j = 0; j < 16; ++j) {
+            inner.push_back(pool.submit([base, j] { return work(base + j); }));
+          }
+          Either<Error, std::vector<std::uint64_t>> all = pool.get(funky::whenAll(std::move(inner)));
+          if (all.isLeft()) {
+            return all.left();
+          }
+          return all.right().back();
+        }));
+      }
+      Either<Error, std::vector<std::uint64_t>> all = pool.get(funky::whenAll(std::move(outer)));
+      sum += all.right().back();
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <unsigned Threads>
+  void addThreads() {
+    std::string const suffix = "/" + std::to_string(Threads) + "t";
+    bench::add("Pool/Flat" + suffix, "CentralQueue", &flat<CentralPool, Threads>, true);
+    bench::add("Pool/Flat" + suffix, "WorkStealing", &flat<funky::ThreadPool, Threads>);
+    bench::add("Pool/Nested" + suffix, "CentralQueue", &nested<CentralPool, Threads>, true);
+    bench::add("Pool/Nested" + suffix, "WorkStealing", &nested<funky::ThreadPool, Threads>);
+  }
+
+  template <unsigned Threads>
+  void addIfUseful(unsigned cores) {
+    if (Threads <= 8 || Threads <= cores) {
+      addThreads<Threads>();
+    }
+  }
+
+  struct Register {
+    Register() {
+      unsigned const cores = std::thread::hardware_concurrency();
+      addIfUseful<1>(cores);
+      addIfUseful<2>(cores);
+      addIfUseful<4>(cores);
+      addIfUseful<8>(cores);
+      addIfUseful<16>(cores);
+      addIfUseful<32>(cores);
+      addIfUseful<64>(cores);
+      addIfUseful<128>(cores);
+    }
+  } registerPoolBenchmarks;
+
+}
@@ -0,0 +1,177 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "Bench.hh"
+#include "funky/Validation.hh"
+
+#include <initializer_list>
+#include <vector>
+
+// Validating 20-field records, one record per operation:
+//
+// - StdVector (the baseline) collects errors the same way, but in an
+//   Either<std::vector<FieldError>, int> per field.
+// - Validation uses funky::Validation and combine().
+// - Either_firstError stops at the first error, which is what validators
+//   built on plain Either do; it reports less, so it's only a reference.
+//
+// Validate/MostPass has two bad fields in one record out of 16, and
+// Validate/SomeFail three in every record.
+
+namespace {
+
+  using funky::Either;
+
+  struct FieldError {
+    int field;
+    char const *what;
+  };
+
+  struct Record {
+    int f[20];
+  };
+
+  typedef int const Input[20];
+
+  __attribute__((noinline)) bool inRange(int v) { return v > 0 && v < 1000000; }
+
+  Record makeRecord(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j,
+                    int k, int l, int m, int n, int o, int p, int q, int r, int s, int t) {
+    return Record{{a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, q, r, s, t}};
+  }
+
+  // ------------------------------------------------------------------------
+  // std::vector
+
+  typedef Either<std::vector<FieldError>, int> VectorChecked;
+
+  VectorChecked vectorCheck(int field, int v) {
+    if (!inRange(v)) return std::vector<FieldError>{FieldError{field, "out of range"}};
+    return v;
+  }
+
+  template <class... Ts>
+  Either<std::vector<FieldError>, Record> vectorCombine(Either<std::vector<FieldError>, Ts>... vs) {
+    bool ok = true;
+    for (bool v : {vs.isRight()...}) {
+      ok = ok && v;
+    }
+    if (ok) {
+      return makeRecord(vs.right()...);
+    }
+    std::vector<FieldError> errors;
+    for (VectorChecked *v : {&vs...}) {
+      if (v->isLeft()) {
+        errors.insert(errors.end(), v->left().begin(), v->left().end());
+      }
+    }
+    return errors;
+  }
+
+  struct StdVector {
+    static char const *name() { return "StdVector"; }
+    static bool const baseline = true;
+
+    static int validate(Input &in) {
+      Either<std::vector<FieldError>, Record> r = vectorCombine(
+        vectorCheck(0, in[0]), vectorCheck(1, in[1]), vectorCheck(2, in[2]), vectorCheck(3, in[3]),
+        vectorCheck(4, in[4]), vectorCheck(5, in[5]), vectorCheck(6, in[6]), vectorCheck(7, in[7]),
+        vectorCheck(8, in[8]), vectorCheck(9, in[9]), vectorCheck(10, in[10]), vectorCheck(11, in[11]),
+        vectorCheck(12, in[12]), vectorCheck(13, in[13]), vectorCheck(14, in[14]), vectorCheck(15, in[15]),
+        vectorCheck(16, in[16]), vectorCheck(17, in[17]), vectorCheck(18, in[18]), vectorCheck(19, in[19]));
+      return r.isLeft() ? static_cast<int>(r.left().size()) : r.right().f[19];
+    }
+  };
+
+  // ------------------------------------------------------------------------
+  // Validation
+
+  typedef funky::Validation<FieldError, int> Checked;
+
+  Checked check(int field, int v) {
+    if (!inRange(v)) return Checked{funky::EmplaceLeft, FieldError{field, "out of range"}};
+    return v;
+  }
+
+  struct ValidationImpl {
+    static char const *name() { return "Validation"; }
+    static bool const baseline = false;
+
+    static int validate(Input &in) {
+      funky::Validation<FieldError, Record> r = funky::combine(makeRecord,
+        check(0, in[0]), check(1, in[1]), check(2, in[2]), check(3, in[3]),
+        check(4, in[4]), check(5, in[5]), check(6, in[6]), check(7, in[7]),
+        check(8, in[8]), check(9, in[9]), check(10, in[10]), check(11, in[11]),
+        check(12, in[12]), check(13, in[13]), check(14, in[14]), check(15, in[15]),
+        check(16, in[16]), check(17, in[17]), check(18, in[18]), check(19, in[19]));
+      return r.isInvalid() ? static_cast<int>(r.errors().size()) : r.value().f[19];
+    }
+  };
+
+  // ------------------------------------------------------------------------
+  // first error only
+
+  struct FirstError {
+    static char const *name() { return "Either_firstError"; }
+    static bool const baseline = false;
+
+    static int validate(Input &in) {
+      Record r;
+      for (int i = 0; i < 20; ++i) {
+        Either<FieldError, int> v = inRange(in[i]) ? Either<FieldError, int>{in[i]}
+                                                   : Either<FieldError, int>{FieldError{i, "out of range"}};
+        if (v.isLeft()) {
+          return 1;
+        }
+        r.f[i] = v.right();
+      }
+      return r.f[19];
+    }
+  };
+
+  std::vector<Record> records(int badEvery, int badFields) {
+    std::vector<Record> rs(64);
+    for (int i = 0; i < 64; ++i) {
+      for (int j = 0; j < 20; ++j) {
+        rs[i].f[j] = i * 20 + j + 1;
+      }
+      if (i % badEvery == 0) {
+        for (int k = 0; k < badFields; ++k) {
+          rs[i].f[(i + k * 7) % 20] = -1;
+        }
+      }
+    }
+    return rs;
+  }
+
+  template <class I>
+  void run(bench::State &state, int badEvery, int badFields) {
+    std::vector<Record> const rs = records(badEvery, badFields);
+    std::size_t i = 0;
+    long sum = 0;
+    while (state.running()) {
+      sum += I::validate(rs[i].f);
+      i = (i + 1) & 63;
+    }
+    bench::doNotOptimize(sum);
+  }
+
+  template <class I> void mostPass(bench::State &state) { run<I>(state, 16, 2); }
+  template <class I> void someFail(bench::State &state) { run<I>(state, 1, 3); }
+
+  template <class I>
+  void addImpl() {
+    bench::add("Validate/MostPass", I::name(), &mostPass<I>, I::baseline);
+    bench::add("Validate/SomeFail", I::name(), &someFail<I>, I::baseline);
+  }
+
+  struct Register {
+    Register() {
+      addImpl<StdVector>();
+      addImpl<ValidationImpl>();
+      addImpl<FirstError>();
+    }
+  } registerValidationBenchmarks;
+
+}
@@ -0,0 +1,92 @@
+#!/usr/bin/env bash
+# Copyright (c) 2013 Thom Chiovoloni.
+# This file is distributed under the terms of the Boost Software License.
+# See LICENSE.txt at the root of this distribution for details.
+#
+# usage: build-time.sh <cxx> <cxxflags> <outdir> [TUs]
+#
+# Build a synthetic project of many translation units that all use the
+# Eithers from EitherInstances.hh, once header-only and once against
+# libfunky's explicit instantiations, and compare compile time, link time and
+# object size. Each configuration is built at -O0 and -O2.
+
+cxx=$1
+flags=$2
+out=$3
+tus=${4:-100}
+here=$(dirname "$0")
+root="$here/.."
+
+mkdir -p "$out/src" || exit 1
+
+generate() {
+  local i=$1
+  cat <<TU
+#ifdef USE_LIBFUNKY
+#include "funky/EitherInstances.hh"
+#else
+#include "funky/Either.hh"
+#include <string>
+#endif
+using funky::Either;
+typedef Either<int, std::string> A;
+typedef Either<std::string, int> B;
+typedef Either<std::string, bool> C;
+long unit$i(int x, std::string const &s) {
+  A a{x}, a2{s};
+  B b{s}, b2{x};
+  C c{s}, c2{x > 0};
+  a = a2; a.set(x); a = std::move(a2);
+  b = b2; b.set(s); b = std::move(b2);
+  c = c2; c.set(s); c = std::move(c2);
+  swap(a, a2); swap(c, c2);
+  return (a == a2) + (b != b2) + (c == c2) + (a.isLeft() ? a.left() : long(a.right().size()));
+}
+TU
+}
+
+for ((i = 0; i < tus; ++i)); do
+  generate "$i" > "$out/src/unit$i.cc"
+done
+{
+  echo '#include <string>'
+  for ((i = 0; i < tus; ++i)); do echo "long unit$i(int, std::string const &);"; done
+  echo 'int main(int argc, char **) { long s = 0;'
+  for ((i = 0; i < tus; ++i)); do echo "  s += unit$i(argc, \"x\");"; done
+  echo '  return int(s & 1); }'
+} > "$out/src/main.cc"
+
+now() { date +%s%N; }
+
+# build <name> <opt> <extra flags> <extra link inputs>
+build() {
+  local name=$1 opt=$2 extra=$3 link=$4 dir="$out/$1$2" start compiled linked bytes i
+  mkdir -p "$dir" || exit 1
+  start=$(now)
+  for ((i = 0; i < tus; ++i)); do
+    $cxx $flags $opt $extra -I"$root/include" -c "$out/src/unit$i.cc" -o "$dir/unit$i.o" || exit 1
+  done
+  $cxx $flags $opt -c "$out/src/main.cc" -o "$dir/main.o" || exit 1
+  compiled=$(now)
+  $cxx $flags $opt -o "$dir/app" "$dir"/*.o $link || exit 1
+  linked=$(now)
+  bytes=$(cat "$dir"/unit*.o | wc -c)
+  awk -v name="$name $opt" -v c=$(( (compiled - start) / 1000000 )) \
+      -v l=$(( (linked - compiled) / 1000000 )) -v b="$bytes" 'BEGIN {
+    printf "%-16s %12d %10d %12d %14.1f\n", name, c, l, c + l, b / 1024
+  }'
+}
+
+printf "%-16s %12s %10s %12s %14s\n" "config" "compile ms" "link ms" "total ms" "objects KiB"
+# the library's settings, as the Makefile records them; the units are built
+# with the same ones, so they use its instantiations.
+mkdir -p "$out/include/funky" || exit 1
+$cxx $flags -I"$root/include" -E -P -x c++ "$root/src/LibraryConfig.in" | sed -n 's/^@/#/p' \
+  > "$out/include/funky/LibraryConfig.hh" || exit 1
+
+for opt in -O0 -O2; do
+  lib="$out/libfunky$opt.o"
+  $cxx $flags $opt -I"$root/include" -I"$out/include" -c "$root/src/EitherInstances.cc" -o "$lib" || exit 1
+  build header-only $opt "" ""
+  build libfunky $opt "-DUSE_LIBFUNKY -I$out/include" "$lib"
+done
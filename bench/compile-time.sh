@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+# Copyright (c) 2013 Thom Chiovoloni.
+# This file is distributed under the terms of the Boost Software License.
+# See LICENSE.txt at the root of this distribution for details.
+#
+# usage: compile-time.sh <cxx> <cxxflags> <outdir> [N...]
+#
+# Generate translation units with N distinct Either<L, R> instantiations,
+# each exercising the whole Either API, and time compiling them. Reports the
+# best of three wall clock times for the front end alone (-fsyntax-only) and
+# for a full -O2 compile, plus the cost per instantiation.
+
+cxx=$1
+flags=$2
+out=$3
+shift 3
+counts=${*:-50 100 200 400}
+
+mkdir -p "$out" || exit 1
+
+generate() {
+  local n=$1 i
+  echo '#include "funky/Either.hh"'
+  echo '#include <utility>'
+  echo 'using funky::Either;'
+  for ((i = 0; i < n; ++i)); do
+    cat <<TU
+struct T$i { int v; bool operator==(T$i const &o) const { return v == o.v; } };
+long use$i(T$i const &t, int r) {
+  typedef Either<T$i, int> E;
+  E a{t}, b{r}, c{a};
+  E d{funky::EmplaceLeft, t};
+  a = b; a = t; a = r; c = std::move(d);
+  a.set(b); a.set(t);
+  a.emplaceRight(r); b.emplaceLeft(t);
+  swap(a, b);
+  long s = a.either([](T$i const &x) { return long(x.v); }, [](int x) { return long(x); });
+  if (T$i const *p = a.getLeftPointer()) s += p->v;
+  if (a.is<int>()) s += a.get<int>();
+  return s + (a == c) + (b != c) + (b.isLeft() ? b.left().v : b.right());
+}
+TU
+  done
+}
+
+# best of three wall clock seconds for the given compile command.
+timeit() {
+  local best="" t i
+  for i in 1 2 3; do
+    local start end
+    start=$(date +%s%N)
+    "$@" || return 1
+    end=$(date +%s%N)
+    t=$(( (end - start) / 1000 ))
+    if [ -z "$best" ] || [ "$t" -lt "$best" ]; then best=$t; fi
+  done
+  echo "$best"
+}
+
+printf "%8s %14s %14s %18s %18s\n" "N" "frontend ms" "-O2 ms" "frontend us/inst" "-O2 us/inst"
+for n in $counts; do
+  src="$out/either-$n.cc"
+  generate "$n" > "$src"
+  fe=$(timeit $cxx $flags -fsyntax-only "$src") || exit 1
+  full=$(timeit $cxx $flags -O2 -c -o "$out/either-$n.o" "$src") || exit 1
+  awk -v n="$n" -v fe="$fe" -v full="$full" 'BEGIN {
+    printf "%8d %14.1f %14.1f %18.1f %18.1f\n", n, fe / 1000, full / 1000, fe / n, full / n
+  }'
+done
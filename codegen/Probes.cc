@@ -0,0 +1,61 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+// Probe functions for `make codegen-check`. Each one wraps a single Either
+// operation on trivial payloads; check.sh disassembles the object file and
+// holds every probe to the budget in expectations.txt.
+//
+// Probes are extern "C" so their symbols are predictable, and take their
+// arguments by pointer so nothing gets constant folded away.
+
+#include "funky/Either.hh"
+#include "funky/InternedError.hh"
+
+#include <new>
+
+typedef funky::Either<int, double> Trivial;
+typedef funky::Either<int, long> Integral;
+typedef funky::Either<funky::InternedError, int> Interned;
+
+extern "C" {
+
+  bool probeIsLeft(Trivial const *e) { return e->isLeft(); }
+
+  bool probeIsRight(Trivial const *e) { return e->isRight(); }
+
+  int probeLeft(Trivial const *e) { return e->left(); }
+
+  double probeRight(Trivial const *e) { return e->right(); }
+
+  int probeLeftOrZero(Trivial const *e) { return e->isLeft() ? e->left() : 0; }
+
+  int const *probeGetLeftPointer(Trivial const *e) { return e->getLeftPointer(); }
+
+  long probeEither(Integral const *e) {
+    return e->either([](int l) { return -static_cast<long>(l); },
+                     [](long r) { return r; });
+  }
+
+  double probeEitherMixed(Trivial const *e) {
+    return e->either([](int l) { return static_cast<double>(l); },
+                     [](double r) { return r * 2.0; });
+  }
+
+  bool probeEqual(Integral const *a, Integral const *b) { return *a == *b; }
+
+  void probeCopy(Trivial *dst, Trivial const *src) { new (dst) Trivial(*src); }
+
+  void probeAssign(Trivial *dst, Trivial const *src) { *dst = *src; }
+
+  void probeSetRight(Trivial *e, double d) { e->set(d); }
+
+  void probeEmplaceLeft(Trivial *e, int i) { e->emplaceLeft(i); }
+
+  void probeCanonicalError(Interned *e) { new (e) Interned(funky::InternedError::notFound()); }
+
+  bool probeInternedEqual(Interned const *e) {
+    return e->isLeft() && e->left() == funky::InternedError::timedOut();
+  }
+
+}
@@ -0,0 +1,79 @@
+# Copyright (c) 2013 Thom Chiovoloni.
+# This file is distributed under the terms of the Boost Software License.
+# See LICENSE.txt at the root of this distribution for details.
+#
+# Reads expectations.txt, then `objdump -dr --no-show-raw-insn` output, and
+# checks each probe's instruction count, conditional branch count, calls
+# and stack traffic. Alignment padding (nops) isn't counted.
+
+# expectations: <probe> key<=value... flag...
+FNR == NR {
+  if ($0 ~ /^[ \t]*(#|$)/) next
+  probe = $1
+  expected[probe] = 1
+  order[++nprobes] = probe
+  for (i = 2; i <= NF; ++i) {
+    if ($i ~ /^insns<=/) { maxInsns[probe] = substr($i, 8) + 0 }
+    else if ($i ~ /^branches<=/) { maxBranches[probe] = substr($i, 11) + 0 }
+    else if ($i == "nocall") { noCall[probe] = 1 }
+    else if ($i == "nospill") { noSpill[probe] = 1 }
+    else { printf "expectations.txt:%d: unknown property '%s'\n", FNR, $i; bad = 1 }
+  }
+  next
+}
+
+# function header: 0000000000000000 <probeIsLeft>:
+/^[0-9a-f]+ <.*>:$/ {
+  fn = $2
+  mnemonic = ""
+  sub(/^</, "", fn)
+  sub(/>:$/, "", fn)
+  seen[fn] = 1
+  next
+}
+
+fn == "" { next }
+
+# a jmp with a relocation against a function is a tail call.
+/R_X86_64_PLT32/ { if (mnemonic ~ /^jmp/) calls[fn]++; next }
+
+/^ +[0-9a-f]+:\t/ {
+  split($0, parts, "\t")
+  text = parts[2]
+  if (text ~ /nop/ || text ~ /^xchg +%ax,%ax/) next
+  insns[fn]++
+  mnemonic = text
+  sub(/[ \t].*$/, "", mnemonic)
+  if (mnemonic ~ /^call/) calls[fn]++
+  if (mnemonic ~ /^j/ && mnemonic !~ /^jmp/) branches[fn]++
+  if (mnemonic ~ /^(push|pop)/ || text ~ /%[er][sb]p/) spills[fn]++
+  next
+}
+
+END {
+  for (i = 1; i <= nprobes; ++i) {
+    p = order[i]
+    if (!(p in seen)) {
+      printf "%s %s: probe not found in disassembly\n", opt, p
+      bad = 1
+      continue
+    }
+    if ((p in maxInsns) && insns[p] > maxInsns[p]) {
+      printf "%s %s: %d instructions, budget is %d\n", opt, p, insns[p], maxInsns[p]
+      bad = 1
+    }
+    if ((p in maxBranches) && branches[p] > maxBranches[p]) {
+      printf "%s %s: %d conditional branches, budget is %d\n", opt, p, branches[p], maxBranches[p]
+      bad = 1
+    }
+    if ((p in noCall) && calls[p] > 0) {
+      printf "%s %s: makes %d call(s)\n", opt, p, calls[p]
+      bad = 1
+    }
+    if ((p in noSpill) && spills[p] > 0) {
+      printf "%s %s: touches the stack %d time(s)\n", opt, p, spills[p]
+      bad = 1
+    }
+  }
+  exit bad
+}
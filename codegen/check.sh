@@ -0,0 +1,40 @@
+#!/bin/sh
+# Copyright (c) 2013 Thom Chiovoloni.
+# This file is distributed under the terms of the Boost Software License.
+# See LICENSE.txt at the root of this distribution for details.
+#
+# usage: check.sh <cxx> <cxxflags> <outdir>
+#
+# Compile Probes.cc at -O2 and -O3, disassemble it, and check every probe
+# against expectations.txt. Exits non-zero if any expectation is violated.
+
+cxx=$1
+flags=$2
+out=$3
+here=$(dirname "$0")
+
+case "$(uname -m)" in
+  x86_64|amd64) ;;
+  *)
+    echo "codegen-check: skipped, expectations are written for x86-64"
+    exit 0
+    ;;
+esac
+
+mkdir -p "$out" || exit 1
+
+status=0
+for opt in O2 O3; do
+  obj="$out/Probes-$opt.o"
+  dis="$out/Probes-$opt.dis"
+  $cxx $flags -$opt -DNDEBUG -c "$here/Probes.cc" -o "$obj" || exit 1
+  objdump -dr --no-show-raw-insn "$obj" > "$dis" || exit 1
+  awk -v opt="-$opt" -f "$here/check.awk" "$here/expectations.txt" "$dis" || status=1
+done
+
+if [ $status -eq 0 ]; then
+  echo "codegen-check: all probes within budget"
+else
+  echo "codegen-check: FAILED (disassembly is in $out)"
+fi
+exit $status
@@ -0,0 +1,358 @@
+#ifndef FUNKY_ATOMIC_EITHER_HH_INCLUDED
+#define FUNKY_ATOMIC_EITHER_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Either.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/// Whether 16-byte AtomicEithers can use a 16-byte compare-and-swap
+/// (cmpxchg16b on x86-64, which gcc and clang use with -mcx16 or
+/// -march=x86-64-v2 and later). Without one they use a seqlock.
+#ifndef FUNKY_ATOMIC_EITHER_CAS16
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+#define FUNKY_ATOMIC_EITHER_CAS16 1
+#else
+#define FUNKY_ATOMIC_EITHER_CAS16 0
+#endif
+#endif
+
+namespace funky {
+
+  namespace detail {
+
+    inline void atomicEitherRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__)
+      __asm__ __volatile__("yield");
+#endif
+    }
+
+    template <class T>
+    struct AtomicEitherSide {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "AtomicEither needs trivially copyable sides");
+      static std::size_t const size = sizeof(T);
+
+      template <class E, class Tag>
+      static E unpack(Tag tag, unsigned char const *bytes) {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return E(tag, *reinterpret_cast<T const*>(&value));
+      }
+
+      static void pack(unsigned char *bytes, T const *value) { std::memcpy(bytes, value, sizeof(T)); }
+    };
+
+    template <>
+    struct AtomicEitherSide<void> {
+      static std::size_t const size = 0;
+
+      template <class E, class Tag>
+      static E unpack(Tag tag, unsigned char const *) { return E(tag); }
+
+      static void pack(unsigned char *, void const *) {}
+    };
+
+    /// An Either as bytes: the held side's value, then a byte saying which
+    /// side it is. pack() is given zeroed bytes and leaves the ones that
+    /// aren't part of the value alone, so equal values of trivially
+    /// copyable types without padding pack equally.
+    template <class LeftT, class RightT>
+    struct AtomicEitherCodec {
+      typedef Either<LeftT, RightT> Value;
+      typedef AtomicEitherSide<LeftT> Left;
+      typedef AtomicEitherSide<RightT> Right;
+
+      static std::size_t const tagOffset = Left::size > Right::size ? Left::size : Right::size;
+      static std::size_t const size = tagOffset + 1;
+
+      static void pack(unsigned char *bytes, Value const &v) {
+        bytes[tagOffset] = v.isLeft();
+        if (v.isLeft()) {
+          Left::pack(bytes, v.template getPointer<LeftT>());
+        } else {
+          Right::pack(bytes, v.template getPointer<RightT>());
+        }
+      }
+
+      static Value unpack(unsigned char const *bytes) {
+        return bytes[tagOffset] ? Left::template unpack<Value>(EmplaceLeft, bytes)
+                                : Right::template unpack<Value>(EmplaceRight, bytes);
+      }
+    };
+
+    /// The ways an AtomicEither keeps its bytes. Each has lockFree, and
+    /// load, store, exchange and compareExchange on arrays of `size` bytes,
+    /// with acquire and release ordering.
+    template <class Word>
+    class AtomicEitherWord {
+    public:
+      static bool const lockFree = true;
+      static std::size_t const size = sizeof(Word);
+
+      AtomicEitherWord() : word_(0) {}
+
+      void load(unsigned char *out) const { put(out, word_.load(std::memory_order_acquire)); }
+      void store(unsigned char const *in) { word_.store(get(in), std::memory_order_release); }
+      void exchange(unsigned char *out, unsigned char const *in) {
+        put(out, word_.exchange(get(in), std::memory_order_acq_rel));
+      }
+      bool compareExchange(unsigned char *expected, unsigned char const *desired) {
+        Word e = get(expected);
+        bool const swapped = word_.compare_exchange_strong(e, get(desired), std::memory_order_acq_rel,
+                                                           std::memory_order_acquire);
+        put(expected, e);
+        return swapped;
+      }
+
+    private:
+      static Word get(unsigned char const *in) { Word w; std::memcpy(&w, in, sizeof(w)); return w; }
+      static void put(unsigned char *out, Word w) { std::memcpy(out, &w, sizeof(w)); }
+
+      std::atomic<Word> word_;
+    };
+
+#if FUNKY_ATOMIC_EITHER_CAS16
+    __extension__ typedef unsigned __int128 AtomicEitherWord16;
+
+    /// 16 bytes with a 16-byte compare-and-swap, which is also how it loads,
+    /// since x86-64 has no other atomic 16-byte load. So a load writes the
+    /// cache line, and readers contend with each other as well as writers.
+    class AtomicEitherCas16 {
+    public:
+      static bool const lockFree = true;
+      static std::size_t const size = 16;
+
+      AtomicEitherCas16() : word_(0) {}
+
+      void load(unsigned char *out) const { put(out, __sync_val_compare_and_swap(&word_, 0, 0)); }
+      void store(unsigned char const *in) { unsigned char old[16]; exchange(old, in); }
+      void exchange(unsigned char *out, unsigned char const *in) {
+        Word const desired = get(in);
+        // a guess, which the first compare-and-swap corrects.
+        Word seen = 0;
+        for (;;) {
+          Word const prior = __sync_val_compare_and_swap(&word_, seen, desired);
+          if (prior == seen) break;
+          seen = prior;
+        }
+        put(out, seen);
+      }
+      bool compareExchange(unsigned char *expected, unsigned char const *desired) {
+        Word const e = get(expected);
+        Word const prior = __sync_val_compare_and_swap(&word_, e, get(desired));
+        put(expected, prior);
+        return prior == e;
+      }
+
+    private:
+      typedef AtomicEitherWord16 Word;
+
+      static Word get(unsigned char const *in) { Word w; std::memcpy(&w, in, sizeof(w)); return w; }
+      static void put(unsigned char *out, Word w) { std::memcpy(out, &w, sizeof(w)); }
+
+      // mutable, since a load is a compare-and-swap.
+      alignas(16) mutable Word word_;
+    };
+#endif
+
+    /// Any number of bytes behind a seqlock. The sequence number is odd
+    /// while a writer is changing the bytes, and writers take turns by
+    /// making it odd with a compare-and-swap. Readers copy the bytes and
+    /// retry if the sequence number was odd or changed meanwhile, so they
+    /// never write to shared memory; but they can be held up by writers.
+    ///
+    /// The bytes are atomic words, stored with release and loaded with
+    /// acquire, so that reading one a writer stored means the reader will
+    /// see that writer's sequence number.
+    template <std::size_t Words>
+    class AtomicEitherSeqLock {
+    public:
+      static bool const lockFree = false;
+      static std::size_t const size = Words * sizeof(std::uint64_t);
+
+      AtomicEitherSeqLock() : seq_(0), words_() {}
+
+      void load(unsigned char *out) const {
+        for (;;) {
+          std::uint64_t const before = seq_.load(std::memory_order_acquire);
+          if ((before & 1) == 0) {
+            copyOut(out, std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) return;
+          }
+          atomicEitherRelax();
+        }
+      }
+
+      void store(unsigned char const *in) {
+        std::uint64_t const s = lock();
+        write(in);
+        unlock(s + 2);
+      }
+
+      void exchange(unsigned char *out, unsigned char const *in) {
+        std::uint64_t const s = lock();
+        copyOut(out, std::memory_order_relaxed);
+        write(in);
+        unlock(s + 2);
+      }
+
+      bool compareExchange(unsigned char *expected, unsigned char const *desired) {
+        std::uint64_t const s = lock();
+        unsigned char current[size];
+        copyOut(current, std::memory_order_relaxed);
+        if (std::memcmp(current, expected, size) != 0) {
+          // nothing changed, so readers that raced with us can keep what
+          // they read.
+          unlock(s);
+          std::memcpy(expected, current, size);
+          return false;
+        }
+        write(desired);
+        unlock(s + 2);
+        return true;
+      }
+
+      /// Writing in steps, for PublishedEither: lock() waits for other
+      /// writers and makes the sequence number odd, returning what it was;
+      /// write() changes the bytes, and unlock() sets the sequence number
+      /// to the (even) `next`, which is lock()'s result plus 2 if anything
+      /// was written.
+      std::uint64_t lock() {
+        std::uint64_t s = seq_.load(std::memory_order_relaxed);
+        for (;;) {
+          if ((s & 1) == 0 && seq_.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                                                         std::memory_order_relaxed)) {
+            return s;
+          }
+          atomicEitherRelax();
+          s = seq_.load(std::memory_order_relaxed);
+        }
+      }
+
+      void write(unsigned char const *in) {
+        for (std::size_t i = 0; i < Words; ++i) {
+          std::uint64_t w;
+          std::memcpy(&w, in + i * sizeof(w), sizeof(w));
+          words_[i].store(w, std::memory_order_release);
+        }
+      }
+
+      void unlock(std::uint64_t next) { seq_.store(next, std::memory_order_release); }
+
+    private:
+      // relaxed is enough for writers, who hold the lock.
+      void copyOut(unsigned char *out, std::memory_order order) const {
+        for (std::size_t i = 0; i < Words; ++i) {
+          std::uint64_t const w = words_[i].load(order);
+          std::memcpy(out + i * sizeof(w), &w, sizeof(w));
+        }
+      }
+
+      std::atomic<std::uint64_t> seq_;
+      std::atomic<std::uint64_t> words_[Words];
+    };
+
+    /// The smallest of the above that holds `Size` bytes.
+    template <std::size_t Size>
+    struct AtomicEitherStorage {
+      typedef typename std::conditional<
+        Size <= 4, AtomicEitherWord<std::uint32_t>,
+        typename std::conditional<
+          Size <= 8, AtomicEitherWord<std::uint64_t>,
+#if FUNKY_ATOMIC_EITHER_CAS16
+          typename std::conditional<Size <= 16, AtomicEitherCas16,
+                                    AtomicEitherSeqLock<(Size + 7) / 8>>::type
+#else
+          AtomicEitherSeqLock<(Size + 7) / 8>
+#endif
+        >::type
+      >::type Type;
+    };
+
+  }
+
+  /// An Either<LeftT, RightT> that threads can load and store at once, like
+  /// std::atomic. Both sides must be trivially copyable (or void). When the
+  /// Either packs into 8 bytes (a side of up to 7 bytes, and a byte for the
+  /// tag), or 16 with FUNKY_ATOMIC_EITHER_CAS16, every operation is a single
+  /// atomic instruction; otherwise it's a seqlock, whose readers retry
+  /// rather than block.
+  ///
+  /// Loads are acquires and stores are releases, so a value published by
+  /// store() can be used to pass other data between threads.
+  template <class LeftT, class RightT>
+  class AtomicEither {
+    typedef detail::AtomicEitherCodec<LeftT, RightT> Codec;
+    typedef typename detail::AtomicEitherStorage<Codec::size>::Type Storage;
+
+  public:
+    typedef Either<LeftT, RightT> Value;
+
+    /// Whether load, store, exchange and compareExchange are single atomic
+    /// instructions.
+    static bool const isLockFree = Storage::lockFree;
+
+    explicit AtomicEither(Value const &initial) : storage_() { store(initial); }
+
+    AtomicEither(AtomicEither const &) = delete;
+    AtomicEither &operator=(AtomicEither const &) = delete;
+
+    Value load() const {
+      unsigned char bytes[Storage::size];
+      storage_.load(bytes);
+      return Codec::unpack(bytes);
+    }
+
+    void store(Value const &v) {
+      unsigned char bytes[Storage::size];
+      pack(bytes, v);
+      storage_.store(bytes);
+    }
+
+    /// Store `v` and return what it replaced.
+    Value exchange(Value const &v) {
+      unsigned char in[Storage::size], out[Storage::size];
+      pack(in, v);
+      storage_.exchange(out, in);
+      return Codec::unpack(out);
+    }
+
+    /// If we hold `expected`, replace it with `desired` and return true.
+    /// Otherwise set `expected` to what we hold and return false. Values
+    /// are compared by their bytes, like std::atomic, so for example 0.0
+    /// and -0.0 differ, and sides with padding can fail to compare equal.
+    bool compareExchange(Value &expected, Value const &desired) {
+      unsigned char e[Storage::size], d[Storage::size];
+      pack(e, expected);
+      pack(d, desired);
+      if (storage_.compareExchange(e, d)) {
+        return true;
+      }
+      expected = Codec::unpack(e);
+      return false;
+    }
+
+  private:
+    static void pack(unsigned char *bytes, Value const &v) {
+      std::memset(bytes, 0, Storage::size);
+      Codec::pack(bytes, v);
+    }
+
+    Storage storage_;
+  };
+
+  template <class LeftT, class RightT>
+  bool const AtomicEither<LeftT, RightT>::isLockFree;
+
+}
+
+#endif
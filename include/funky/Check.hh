@@ -0,0 +1,74 @@
+#ifndef FUNKY_CHECK_HH_INCLUDED
+#define FUNKY_CHECK_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include <cstdio>
+#include <cstdlib>
+
+/// How much funky checks at runtime, set by defining FUNKY_CHECK_LEVEL to one
+/// of:
+///
+/// - FUNKY_CHECK_NONE: nothing.
+/// - FUNKY_CHECK_CHEAP: preconditions a caller can break, like calling
+///   left() on a Right. Each is a compare and a branch that's never taken.
+/// - FUNKY_CHECK_FULL: those, and invariants that only a bug in funky
+///   could break, like an Either holding the side it was just given.
+///
+/// The default is full, or none when NDEBUG is defined, which is what the
+/// asserts these replace did. A failed check prints the condition and where
+/// it is, and aborts.
+///
+/// Like FUNKY_EITHER_TELEMETRY, every translation unit using a given Either
+/// must agree on the level, so set it project-wide.
+///
+/// The levels count from 1, since the preprocessor reads a misspelt one (an
+/// identifier it doesn't know) as 0, which then fails to compile.
+
+#define FUNKY_CHECK_NONE 1
+#define FUNKY_CHECK_CHEAP 2
+#define FUNKY_CHECK_FULL 3
+
+#ifndef FUNKY_CHECK_LEVEL
+#ifdef NDEBUG
+#define FUNKY_CHECK_LEVEL FUNKY_CHECK_NONE
+#else
+#define FUNKY_CHECK_LEVEL FUNKY_CHECK_FULL
+#endif
+#endif
+
+#if FUNKY_CHECK_LEVEL != FUNKY_CHECK_NONE && FUNKY_CHECK_LEVEL != FUNKY_CHECK_CHEAP && \
+    FUNKY_CHECK_LEVEL != FUNKY_CHECK_FULL
+#error "FUNKY_CHECK_LEVEL must be FUNKY_CHECK_NONE, FUNKY_CHECK_CHEAP or FUNKY_CHECK_FULL"
+#endif
+
+namespace funky {
+namespace detail {
+
+  [[noreturn]] __attribute__((noinline, cold))
+  inline void checkFailed(char const *condition, char const *file, unsigned line) {
+    std::fprintf(stderr, "%s:%u: funky check failed: %s\n", file, line, condition);
+    std::abort();
+  }
+
+}
+}
+
+/// Check a precondition, at the cheap level and above.
+#if FUNKY_CHECK_LEVEL >= FUNKY_CHECK_CHEAP
+#define FUNKY_CHECK(cond) \
+  (__builtin_expect(!!(cond), 1) ? (void)0 : ::funky::detail::checkFailed(#cond, __FILE__, __LINE__))
+#else
+// unevaluated, so what's only used by checks isn't reported as unused.
+#define FUNKY_CHECK(cond) ((void)sizeof(!(cond)))
+#endif
+
+/// Check an invariant, at the full level.
+#if FUNKY_CHECK_LEVEL >= FUNKY_CHECK_FULL
+#define FUNKY_CHECK_INVARIANT(cond) FUNKY_CHECK(cond)
+#else
+#define FUNKY_CHECK_INVARIANT(cond) ((void)sizeof(!(cond)))
+#endif
+
+#endif
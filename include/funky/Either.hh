@@ -4,9 +4,12 @@
 // This file is distributed under the terms of the Boost Software License.
 // See LICENSE.txt at the root of this distribution for details.
 
+#include "funky/Check.hh"
+
+#include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
-#include <cassert>
 
 namespace funky {
 
@@ -15,12 +18,19 @@ namespace funky {
   /// Either<Left, Right>, inspired by Haskell's `Either`.
   /// Used to represent when values can be one type or another.
   /// A common use case is for when a value can succeed or fail with a message, e.g.
-  /// `Either<Foo, std::string>`.
+  /// `Either<ErrorMessage, Foo>` (see ErrorMessage.hh, which avoids the
+  /// allocations a `std::string` would make).
+  ///
+  /// Either side may be an lvalue reference, e.g. `Either<Error, Row const &>`
+  /// for a lookup into a table. It's stored as a pointer, and assigning
+  /// another reference rebinds it rather than assigning through it.
+  ///
+  /// Either side may also be void, e.g. `Either<Error, void>` for an
+  /// operation that succeeds with no value, which takes no storage beyond the
+  /// other side's. Make its Right with `success()` (or `EmplaceRight`).
   ///
   /// Caveats:
-  /// Left and Right must be distinct types and neither may be a reference type.
-  /// If you need to use a reference type, wrapping in a std::reference_wrapper \
-  /// is probably your best bet.
+  /// Left and Right must be distinct types, even without their references.
 
   /// pass these to the Either constructor to construct a Left/Right either via
   /// emplacement.
@@ -28,75 +38,334 @@ namespace funky {
   enum EmplaceRightTag { EmplaceRight };
   enum EmplaceLeftTag { EmplaceLeft };
 
+}
+
+// Opt-in Left telemetry (see EitherTelemetry.hh). When enabled, the Left
+// constructors and set()s take an extra defaulted parameter capturing the
+// call site. What can't take one (operator= and the variadic emplaces,
+// including the EmplaceLeft constructor) records its own line. EmplaceLeft
+// stays an exact match: converting it to a site-capturing type would lose
+// to an arithmetic side's constructor, which takes the enum as a number.
+#ifdef FUNKY_EITHER_TELEMETRY
+#include "funky/EitherTelemetry.hh"
+
+#define FUNKY_EITHER_SITE_PARAM , ::funky::telemetry::Site funkySite = ::funky::telemetry::Site()
+#define FUNKY_EITHER_RECORD_LEFT() ::funky::telemetry::recordLeft(funkySite.file, funkySite.line)
+#define FUNKY_EITHER_RECORD_LEFT_HERE() ::funky::telemetry::recordLeft(__FILE__, __LINE__)
+#else
+#define FUNKY_EITHER_SITE_PARAM
+#define FUNKY_EITHER_RECORD_LEFT() ((void)0)
+#define FUNKY_EITHER_RECORD_LEFT_HERE() ((void)0)
+#endif
+
+namespace funky {
+
+  namespace detail {
+
+    /// Stands in for the parameter of the constructors and setters that take
+    /// a void side, so they can't be called.
+    class EitherNoValue {
+      EitherNoValue();
+    };
+
+    /// Copying and moving what an Either stores for one of its sides.
+    template <class Stored>
+    struct EitherStored {
+      static void copy(void *d, void const *s) { new (d) Stored(*static_cast<Stored const*>(s)); }
+      static void move(void *d, void *s) { new (d) Stored(std::move(*static_cast<Stored*>(s))); }
+      static void copyAssign(void *d, void const *s) { *static_cast<Stored*>(d) = *static_cast<Stored const*>(s); }
+      static void moveAssign(void *d, void *s) { *static_cast<Stored*>(d) = std::move(*static_cast<Stored*>(s)); }
+    };
+
+    /// How an Either stores one of its sides: a T in place, a T & as a
+    /// pointer to its referent, or nothing for void. Ref and Pointer are what
+    /// the accessors return; for a reference, constness is shallow, like a
+    /// pointer's.
+    template <class T>
+    struct EitherSlot : EitherStored<T> {
+      typedef T Stored;
+      typedef T const &ConstParam;
+      typedef T &&RvalueParam;
+      typedef T &Ref;
+      typedef T const &ConstRef;
+      typedef T &&RvalueRef;
+      typedef T *Pointer;
+      typedef T const *ConstPointer;
+
+      static Pointer get(void *s) { return static_cast<T*>(s); }
+      static ConstPointer get(void const *s) { return static_cast<T const*>(s); }
+
+      static Ref ref(void *s) { return *get(s); }
+      static ConstRef ref(void const *s) { return *get(s); }
+      static RvalueRef rvalue(void *s) { return std::move(*get(s)); }
+
+      template <class Fn>
+      static auto apply(Fn &fn, void *s) -> decltype(fn(std::declval<T &>())) { return fn(*get(s)); }
+      template <class Fn>
+      static auto apply(Fn &fn, void const *s) -> decltype(fn(std::declval<T const &>())) { return fn(*get(s)); }
+
+      template <class... Args>
+      static void construct(void *s, Args&&... args) {
+        new (s) T(std::forward<Args>(args)...);
+      }
+
+      // the result initializes the T directly, with no temporary, since
+      // C++17 (and in practice before it, though T has to be movable).
+      template <class Fn, class... Args>
+      static void constructFrom(void *s, Fn &&fn, Args&&... args) {
+        new (s) T(std::forward<Fn>(fn)(std::forward<Args>(args)...));
+      }
+
+      /// Whether constructFrom() can't throw: the call and the conversion of
+      /// its result to a T.
+      template <class Fn, class... Args>
+      using ConstructFromIsNoexcept =
+        std::integral_constant<bool, noexcept(T(std::declval<Fn>()(std::declval<Args>()...)))>;
+
+      template <class A>
+      static void assign(void *s, A &&a) { *get(s) = std::forward<A>(a); }
+
+      static bool equal(void const *a, void const *b) { return *get(a) == *get(b); }
+
+      static void destroy(void *s) { get(s)->~T(); }
+    };
+
+    /// Whether rightOr() and friends can return a U&& fallback as a T (and
+    /// whether fromInvoke() and the emplace*From()s can store one). A
+    /// reference T has to bind to it directly, so it must be an lvalue of T's
+    /// type (or derived from it): anything else would be a temporary, gone by
+    /// the time the caller reads it.
+    template <class T, class U>
+    struct FallbackBinds
+      : std::integral_constant<bool,
+          !std::is_reference<T>::value ||
+          (std::is_lvalue_reference<U>::value &&
+           std::is_convertible<typename std::remove_reference<U>::type *,
+                               typename std::remove_reference<T>::type *>::value)> {};
+
+    template <class T>
+    struct EitherSlot<T &> : EitherStored<T *> {
+      typedef T *Stored;
+      typedef T &ConstParam;
+      typedef T &&RvalueParam;
+      typedef T &Ref;
+      typedef T &ConstRef;
+      typedef T &RvalueRef;
+      typedef T *Pointer;
+      typedef T *ConstPointer;
+
+      static Pointer get(void const *s) { return *static_cast<T* const*>(s); }
+
+      static Ref ref(void const *s) { return *get(s); }
+      static Ref rvalue(void const *s) { return *get(s); }
+
+      template <class Fn>
+      static auto apply(Fn &fn, void const *s) -> decltype(fn(std::declval<T &>())) { return fn(*get(s)); }
+
+      static void construct(void *s, T &r) { new (s) Stored(std::addressof(r)); }
+      // a T const & would bind a temporary, which is gone once the emplace
+      // returns.
+      static void construct(void *s, T &&r) = delete;
+
+      /// Whether fn(args...) returns something a T & can refer to.
+      template <class Fn, class... Args>
+      using ConstructFromBinds = FallbackBinds<T &, decltype(std::declval<Fn>()(std::declval<Args>()...))>;
+
+      template <class Fn, class... Args>
+      static void constructFrom(void *s, Fn &&fn, Args&&... args) {
+        static_assert(ConstructFromBinds<Fn&&, Args&&...>::value,
+                      "an Either can't refer to a temporary; fn must return an lvalue reference");
+        construct(s, std::forward<Fn>(fn)(std::forward<Args>(args)...));
+      }
+
+      template <class Fn, class... Args>
+      using ConstructFromIsNoexcept =
+        std::integral_constant<bool, noexcept(std::declval<Fn>()(std::declval<Args>()...))>;
+
+      static void assign(void *s, T &r) { *static_cast<Stored*>(s) = std::addressof(r); }
+
+      static bool equal(void const *a, void const *b) { return *get(a) == *get(b); }
+
+      static void destroy(void *) {}
+    };
+
+    struct EitherVoid {};
+
+    /// Selects Either's constructors that call a function for their value.
+    struct EitherInvokeTag {};
+
+    template <>
+    struct EitherSlot<void> : EitherStored<EitherVoid> {
+      typedef EitherVoid Stored;
+      typedef EitherNoValue const &ConstParam;
+      typedef EitherNoValue &&RvalueParam;
+      typedef void Ref;
+      typedef void ConstRef;
+      typedef void RvalueRef;
+      typedef void *Pointer;
+      typedef void const *ConstPointer;
+
+      static Pointer get(void *s) { return s; }
+      static ConstPointer get(void const *s) { return s; }
+
+      static void ref(void const *) {}
+      static void rvalue(void const *) {}
+
+      template <class Fn>
+      static auto apply(Fn &fn, void const *) -> decltype(fn()) { return fn(); }
+
+      static void construct(void *s) { new (s) Stored(); }
+
+      template <class Fn, class... Args>
+      static void constructFrom(void *s, Fn &&fn, Args&&... args) {
+        std::forward<Fn>(fn)(std::forward<Args>(args)...);
+        construct(s);
+      }
+
+      template <class Fn, class... Args>
+      using ConstructFromIsNoexcept =
+        std::integral_constant<bool, noexcept(std::declval<Fn>()(std::declval<Args>()...))>;
+
+      static void assign(void *, EitherNoValue const &) {}
+
+      static bool equal(void const *, void const *) { return true; }
+
+      static void destroy(void *) {}
+    };
+
+    // Swap two Lefts or two Rights in place. Eithers of references are
+    // swapped by rebinding instead, and void sides have nothing to swap, so
+    // swap() moves those through a temporary without calling this.
+    template <class T>
+    struct SwapByMoving
+      : std::integral_constant<bool, std::is_reference<T>::value || std::is_void<T>::value> {};
+
+    template <class T, class E>
+    void swapInPlace(E &a, E &b, std::false_type) {
+      using std::swap;
+      swap(a.template get<T>(), b.template get<T>());
+    }
+
+    template <class T, class E>
+    void swapInPlace(E &, E &, std::true_type) {}
+
+  }
+
   template <class LeftT, class RightT>
   class Either {
 
     static_assert(!std::is_same<LeftT, RightT>::value,
                   "Either<T, T> is disallowed");
 
-    static_assert(!std::is_reference<LeftT>::value &&
-                  !std::is_reference<RightT>::value,
-                  "Either may not be used with reference types "
-                  "(you may want to use std::reference_wrapper)");
+    static_assert(!std::is_same<typename std::remove_reference<LeftT>::type,
+                                typename std::remove_reference<RightT>::type>::value,
+                  "Either<T &, T> is disallowed");
 
-    template <class T>
-    struct isLeftOrRight : public std::integral_constant<bool
-    , std::is_same<T, LeftT>::value || std::is_same<T, RightT>::value
-    > {};
+    static_assert(!std::is_rvalue_reference<LeftT>::value &&
+                  !std::is_rvalue_reference<RightT>::value,
+                  "Either may not be used with rvalue references");
 
+    typedef detail::EitherSlot<LeftT> LeftSlot;
+    typedef detail::EitherSlot<RightT> RightSlot;
 
+    // The parameters of the constructors and setters. For a reference, the
+    // rvalue versions take an rvalue of the referent, which is rejected
+    // rather than kept as a dangling pointer. For void, they can't be called.
+    typedef typename LeftSlot::ConstParam LeftParam;
+    typedef typename RightSlot::ConstParam RightParam;
+    typedef typename LeftSlot::RvalueParam LeftRvalue;
+    typedef typename RightSlot::RvalueParam RightRvalue;
 
   public:
 
     /// Move construct from another either.
     Either(Either const &e) {
       if (e.isLeft()) {
-        construct<LeftT>(e.left());
+        LeftSlot::copy(&storage_, &e.storage_);
       } else {
-        construct<RightT>(e.right());
+        RightSlot::copy(&storage_, &e.storage_);
       }
-      assert(e.isLeft() == isLeft());
+      isLeft_ = e.isLeft_;
     }
 
-    /// Move construct from another either.
-    Either(Either &&e) {
+    /// Move construct from another either. noexcept when both sides are, so
+    /// containers (and queues) of Eithers move rather than copy them.
+    Either(Either &&e) noexcept(std::is_nothrow_move_constructible<typename LeftSlot::Stored>::value &&
+                                std::is_nothrow_move_constructible<typename RightSlot::Stored>::value) {
       if (e.isLeft()) {
-        construct<LeftT>(std::move(e.left()));
+        LeftSlot::move(&storage_, &e.storage_);
       } else {
-        construct<RightT>(std::move(e.right()));
+        RightSlot::move(&storage_, &e.storage_);
       }
-      assert(e.isLeft() == isLeft());
+      isLeft_ = e.isLeft_;
     }
 
     template <class... Args>
     Either(EmplaceLeftTag, Args&&... args) {
       construct<LeftT>(std::forward<Args>(args)...);
-      assert(isLeft());
+      FUNKY_EITHER_RECORD_LEFT_HERE();
+      FUNKY_CHECK_INVARIANT(isLeft());
     }
 
     template <class... Args>
     Either(EmplaceRightTag, Args&&... args) {
       construct<RightT>(std::forward<Args>(args)...);
-      assert(isRight());
+      FUNKY_CHECK_INVARIANT(isRight());
     }
 
+    /// The Right of an Either<E, void>.
+    template <class R = RightT>
+    static Either success() {
+      static_assert(std::is_void<R>::value, "success() is only for Either<E, void>");
+      return Either(EmplaceRight);
+    }
 
+    /// An Either holding fn(args...), which initializes the Left or Right
+    /// in place rather than being moved in, so it works for types that
+    /// can't be moved (from C++17 on; before that, the move is usually
+    /// elided but has to be possible).
+    template <class Fn, class... Args>
+    static Either fromInvoke(EmplaceLeftTag, Fn &&fn, Args&&... args) {
+      FUNKY_EITHER_RECORD_LEFT_HERE();
+      return Either(detail::EitherInvokeTag(), EmplaceLeft, std::forward<Fn>(fn), std::forward<Args>(args)...);
+    }
+
+    template <class Fn, class... Args>
+    static Either fromInvoke(EmplaceRightTag, Fn &&fn, Args&&... args) {
+      return Either(detail::EitherInvokeTag(), EmplaceRight, std::forward<Fn>(fn), std::forward<Args>(args)...);
+    }
 
     /// Construct an Either from a leftT or rightT.
-    Either(LeftT const &l) { construct<LeftT>(l); assert(isLeft()); }
-    Either(RightT const &r) { construct<RightT>(r); assert(isRight()); }
+    Either(LeftParam l FUNKY_EITHER_SITE_PARAM) {
+      construct<LeftT>(l);
+      FUNKY_EITHER_RECORD_LEFT();
+      FUNKY_CHECK_INVARIANT(isLeft());
+    }
+    Either(RightParam r) { construct<RightT>(r); FUNKY_CHECK_INVARIANT(isRight()); }
 
     /// Construct an Either by moving a leftT or rightT.
-    Either(LeftT &&l) { construct<LeftT>(std::move(l)); assert(isLeft()); }
-    Either(RightT &&r) { construct<RightT>(std::move(r)); assert(isRight()); }
+    Either(LeftRvalue l FUNKY_EITHER_SITE_PARAM) {
+      static_assert(!std::is_reference<LeftT>::value, "an Either can't refer to a temporary");
+      construct<LeftT>(std::move(l));
+      FUNKY_EITHER_RECORD_LEFT();
+      FUNKY_CHECK_INVARIANT(isLeft());
+    }
+    Either(RightRvalue r) {
+      static_assert(!std::is_reference<RightT>::value, "an Either can't refer to a temporary");
+      construct<RightT>(std::move(r));
+      FUNKY_CHECK_INVARIANT(isRight());
+    }
 
     ~Either() { destroy(); }
 
-    template <class Arg>
-    Either &operator=(Arg &&arg) {
-      set(std::forward<Arg>(arg));
-      return *this;
-    }
+    /// Assign a LeftT or RightT. These (and the set overloads below) are
+    /// deliberately not templates: a TU with many distinct Eithers pays for
+    /// overload resolution over four plain functions instead of instantiating
+    /// enable_if'd templates at every call.
+    Either &operator=(LeftParam l) { set(l); return *this; }
+    Either &operator=(RightParam r) { set(r); return *this; }
+    Either &operator=(LeftRvalue l) { set(std::move(l)); return *this; }
+    Either &operator=(RightRvalue r) { set(std::move(r)); return *this; }
 
     Either &operator=(Either const &other) {
       set(other);
@@ -111,53 +380,103 @@ namespace funky {
     /// Assign another Either to this.
     void set(Either const &e) {
       if (e.isRight()) {
-        set(e.right());
+        if (isRight()) {
+          RightSlot::copyAssign(&storage_, &e.storage_);
+        } else {
+          destroy();
+          RightSlot::copy(&storage_, &e.storage_);
+          isLeft_ = false;
+        }
       } else {
-        set(e.left());
+        if (isLeft()) {
+          LeftSlot::copyAssign(&storage_, &e.storage_);
+        } else {
+          destroy();
+          LeftSlot::copy(&storage_, &e.storage_);
+          isLeft_ = true;
+        }
       }
-      assert(e.isLeft() == isLeft());
+      FUNKY_CHECK_INVARIANT(e.isLeft() == isLeft());
     }
 
     /// Move assign another Either to this.
     void set(Either &&e) {
       if (e.isRight()) {
-        set(std::move(e.right()));
+        if (isRight()) {
+          RightSlot::moveAssign(&storage_, &e.storage_);
+        } else {
+          destroy();
+          RightSlot::move(&storage_, &e.storage_);
+          isLeft_ = false;
+        }
       } else {
-        set(e.left());
+        if (isLeft()) {
+          LeftSlot::moveAssign(&storage_, &e.storage_);
+        } else {
+          destroy();
+          LeftSlot::move(&storage_, &e.storage_);
+          isLeft_ = true;
+        }
       }
+      FUNKY_CHECK_INVARIANT(e.isLeft() == isLeft());
     }
 
-    /// assign a LeftT const& or RightT const&
-    template <class T>
-    typename std::enable_if<isLeftOrRight<T>::value, void>::type set(T const &v) {
-      if (is<T>()) {
-        get<T>() = v;
+    /// assign a LeftT const& or RightT const&. A reference is rebound.
+    void set(LeftParam l FUNKY_EITHER_SITE_PARAM) {
+      if (isLeft()) {
+        LeftSlot::assign(&storage_, l);
       } else {
         destroy();
-        construct<T>(v);
+        construct<LeftT>(l);
       }
-      assert(is<T>());
+      FUNKY_EITHER_RECORD_LEFT();
+      FUNKY_CHECK_INVARIANT(isLeft());
+    }
+
+    void set(RightParam r) {
+      if (isRight()) {
+        RightSlot::assign(&storage_, r);
+      } else {
+        destroy();
+        construct<RightT>(r);
+      }
+      FUNKY_CHECK_INVARIANT(isRight());
     }
 
     /// move-assign a LeftT&& or RightT&&
-    template <class T>
-    typename std::enable_if<isLeftOrRight<T>::value, void>::type set(T &&v) {
-      if (is<T>()) {
-        get<T>() = std::move(v);
+    void set(LeftRvalue l FUNKY_EITHER_SITE_PARAM) {
+      static_assert(!std::is_reference<LeftT>::value, "an Either can't refer to a temporary");
+      if (isLeft()) {
+        LeftSlot::assign(&storage_, std::move(l));
+      } else {
+        destroy();
+        construct<LeftT>(std::move(l));
+      }
+      FUNKY_EITHER_RECORD_LEFT();
+      FUNKY_CHECK_INVARIANT(isLeft());
+    }
+
+    void set(RightRvalue r) {
+      static_assert(!std::is_reference<RightT>::value, "an Either can't refer to a temporary");
+      if (isRight()) {
+        RightSlot::assign(&storage_, std::move(r));
       } else {
         destroy();
-        construct<T>(std::move(v));
+        construct<RightT>(std::move(r));
       }
-      assert(is<T>());
+      FUNKY_CHECK_INVARIANT(isRight());
     }
 
     /// Construct T in place.
     template <class T, class... Args>
     void emplace(Args&&... args) {
-      static_assert(isLeftOrRight<T>::value, "Either<L, R>::emplace<T> where T != L && T != R");
+      static_assert(isLeftOrRight<T>(), "Either<L, R>::emplace<T> where T != L && T != R");
       destroy();
       construct<T>(std::forward<Args>(args)...);
-      assert(is<T>());
+      if (std::is_same<T, LeftT>::value) {
+        FUNKY_EITHER_RECORD_LEFT_HERE();
+      }
+      FUNKY_CHECK_INVARIANT(is<T>());
     }
 
     /// Construct LeftT in place.
@@ -165,7 +484,8 @@ namespace funky {
     void emplaceLeft(Args&&... args) {
       destroy();
       construct<LeftT>(std::forward<Args>(args)...);
-      assert(isLeft());
+      FUNKY_EITHER_RECORD_LEFT_HERE();
+      FUNKY_CHECK_INVARIANT(isLeft());
     }
 
     /// Equivalent to emplace<Right>(args...)
@@ -173,17 +493,50 @@ namespace funky {
     void emplaceRight(Args&&... args) {
       destroy();
       construct<RightT>(std::forward<Args>(args)...);
-      assert(isRight());
+      FUNKY_CHECK_INVARIANT(isRight());
+    }
+
+    /// Replace our value with fn(args...). When neither fn nor the
+    /// conversion of its result can throw, the old value is destroyed first
+    /// and the result constructed in place, like fromInvoke(). fn then mustn't
+    /// use this Either at all: `e.emplaceRightFrom([&]() noexcept { return
+    /// e.right() + 1; })` reads a destroyed value. Otherwise the result is
+    /// built first and moved in, so fn can read the old value, and we keep
+    /// it if fn throws.
+    template <class Fn, class... Args>
+    void emplaceLeftFrom(Fn &&fn, Args&&... args) {
+      replaceFrom<LeftT>(EmplaceLeft, constructFromIsNoexcept<LeftT, Fn, Args...>(), std::forward<Fn>(fn),
+                         std::forward<Args>(args)...);
+      FUNKY_EITHER_RECORD_LEFT_HERE();
+      FUNKY_CHECK_INVARIANT(isLeft());
+    }
+
+    template <class Fn, class... Args>
+    void emplaceRightFrom(Fn &&fn, Args&&... args) {
+      replaceFrom<RightT>(EmplaceRight, constructFromIsNoexcept<RightT, Fn, Args...>(), std::forward<Fn>(fn),
+                          std::forward<Args>(args)...);
+      FUNKY_CHECK_INVARIANT(isRight());
     }
 
-    /// Get a {const,non-const,rvalue} reference to our {LeftT,RightT}. asserts is{LeftT,RightT}();
-    LeftT const &left() const & { assert(isLeft()); return *rawGetPtr<LeftT>(); }
-    LeftT       &left()       & { assert(isLeft()); return *rawGetPtr<LeftT>(); }
-    LeftT      &&left()      && { assert(isLeft()); return std::move(*rawGetPtr<LeftT>()); }
+    /// Get a {const,non-const,rvalue} reference to our {LeftT,RightT}. checks is{LeftT,RightT}()
+    /// (see Check.hh). For a void side, these just check.
+    typename LeftSlot::ConstRef  left() const & { FUNKY_CHECK(isLeft()); return LeftSlot::ref(&storage_); }
+    typename LeftSlot::Ref       left()       & { FUNKY_CHECK(isLeft()); return LeftSlot::ref(&storage_); }
+    typename LeftSlot::RvalueRef left()      && { FUNKY_CHECK(isLeft()); return LeftSlot::rvalue(&storage_); }
+
+    typename RightSlot::ConstRef  right() const & { FUNKY_CHECK(isRight()); return RightSlot::ref(&storage_); }
+    typename RightSlot::Ref       right()       & { FUNKY_CHECK(isRight()); return RightSlot::ref(&storage_); }
+    typename RightSlot::RvalueRef right()      && { FUNKY_CHECK(isRight()); return RightSlot::rvalue(&storage_); }
 
-    RightT const &right() const & { assert(isRight()); return *rawGetPtr<RightT>(); }
-    RightT       &right()       & { assert(isRight()); return *rawGetPtr<RightT>(); }
-    RightT      &&right()      && { assert(isRight()); return std::move(*rawGetPtr<RightT>()); }
+    /// As above, but never checked, whatever FUNKY_CHECK_LEVEL is. For hot
+    /// paths that have just tested isLeft() or isRight() themselves.
+    typename LeftSlot::ConstRef  unsafeLeft() const & { return LeftSlot::ref(&storage_); }
+    typename LeftSlot::Ref       unsafeLeft()       & { return LeftSlot::ref(&storage_); }
+    typename LeftSlot::RvalueRef unsafeLeft()      && { return LeftSlot::rvalue(&storage_); }
+
+    typename RightSlot::ConstRef  unsafeRight() const & { return RightSlot::ref(&storage_); }
+    typename RightSlot::Ref       unsafeRight()       & { return RightSlot::ref(&storage_); }
+    typename RightSlot::RvalueRef unsafeRight()      && { return RightSlot::rvalue(&storage_); }
 
 
     /// Do we hold a {Left,Right}?
@@ -192,7 +545,8 @@ namespace funky {
 
     /// Comparison of eithers
     bool operator==(Either const &e) const {
-      return (isLeft() == e.isLeft() && (isLeft() ? left() == e.left() : right() == e.right()));
+      return (isLeft() == e.isLeft() &&
+              (isLeft() ? LeftSlot::equal(&storage_, &e.storage_) : RightSlot::equal(&storage_, &e.storage_)));
     }
 
     bool operator!=(Either const &e) const {
@@ -203,74 +557,211 @@ namespace funky {
     template <class T>
     bool is() const {
       // hm... should it just be false?
-      static_assert(isLeftOrRight<T>::value, "Either<L, R>::is<T> where T != L && T != R");
+      static_assert(isLeftOrRight<T>(), "Either<L, R>::is<T> where T != L && T != R");
       return std::is_same<LeftT, T>::value ? isLeft() : isRight();
     }
 
-    /// If is<T>(), get a pointer to our T. otherwise, return nullptr.
-    template <class T> T *getPointer() {
-      static_assert(isLeftOrRight<T>::value, "Either<L, R>::as<T> where T != L && T != R");
+    /// If is<T>(), get a pointer to our T (or what it refers to). otherwise,
+    /// return nullptr.
+    template <class T> typename detail::EitherSlot<T>::Pointer getPointer() {
+      static_assert(isLeftOrRight<T>(), "Either<L, R>::as<T> where T != L && T != R");
       return is<T>() ? rawGetPtr<T>() : nullptr;
     }
 
     /// If is<T>(), get a const pointer to our T. otherwise, return nullptr.
-    template <class T> T const *getPointer() const {
-      static_assert(isLeftOrRight<T>::value, "Either<L, R>::as<T> where T != L && T != R");
+    template <class T> typename detail::EitherSlot<T>::ConstPointer getPointer() const {
+      static_assert(isLeftOrRight<T>(), "Either<L, R>::as<T> where T != L && T != R");
       return is<T>() ? rawGetPtr<T>() : nullptr;
     }
 
-    LeftT       *getLeftPointer()       { return getPointer<LeftT>(); }
-    LeftT const *getLeftPointer() const { return getPointer<LeftT>(); }
+    typename LeftSlot::Pointer      getLeftPointer()       { return getPointer<LeftT>(); }
+    typename LeftSlot::ConstPointer getLeftPointer() const { return getPointer<LeftT>(); }
 
-    RightT       *getRightPointer()       { return getPointer<RightT>(); }
-    RightT const *getRightPointer() const { return getPointer<RightT>(); }
+    typename RightSlot::Pointer      getRightPointer()       { return getPointer<RightT>(); }
+    typename RightSlot::ConstPointer getRightPointer() const { return getPointer<RightT>(); }
 
     /// templated versions of left() and right().
-    template <class T> T       &get()       & { assert(is<T>()); return *rawGetPtr<T>(); }
-    template <class T> T const &get() const & { assert(is<T>()); return *rawGetPtr<T>(); }
-    template <class T> T      &&get()      && { assert(is<T>()); return std::move(*rawGetPtr<T>()); }
+    template <class T> typename detail::EitherSlot<T>::Ref get() & {
+      FUNKY_CHECK(is<T>()); return detail::EitherSlot<T>::ref(&storage_);
+    }
+    template <class T> typename detail::EitherSlot<T>::ConstRef get() const & {
+      FUNKY_CHECK(is<T>()); return detail::EitherSlot<T>::ref(&storage_);
+    }
+    template <class T> typename detail::EitherSlot<T>::RvalueRef get() && {
+      FUNKY_CHECK(is<T>()); return detail::EitherSlot<T>::rvalue(&storage_);
+    }
+
+    /// Our RightT if we hold one, otherwise fallback converted to a RightT.
+    /// Called on an rvalue, the Right is moved out rather than copied.
+    template <class U>
+    RightT rightOr(U &&fallback) const & {
+      static_assert(!std::is_void<RightT>::value, "rightOr() on a void Right");
+      static_assert(detail::FallbackBinds<RightT, U&&>::value, "rightOr() on a reference Right needs an lvalue fallback");
+      if (isRight()) return RightSlot::ref(&storage_);
+      return static_cast<RightT>(std::forward<U>(fallback));
+    }
+
+    template <class U>
+    RightT rightOr(U &&fallback) && {
+      static_assert(!std::is_void<RightT>::value, "rightOr() on a void Right");
+      static_assert(detail::FallbackBinds<RightT, U&&>::value, "rightOr() on a reference Right needs an lvalue fallback");
+      if (isRight()) return RightSlot::rvalue(&storage_);
+      return static_cast<RightT>(std::forward<U>(fallback));
+    }
+
+    /// Our RightT if we hold one, otherwise the result of fn(), which is
+    /// only called when we hold a Left.
+    template <class Fn>
+    RightT rightOrElse(Fn &&fn) const & {
+      static_assert(!std::is_void<RightT>::value, "rightOrElse() on a void Right");
+      static_assert(detail::FallbackBinds<RightT, decltype(std::declval<Fn>()())>::value,
+                    "rightOrElse() on a reference Right needs fn to return an lvalue reference");
+      if (isRight()) return RightSlot::ref(&storage_);
+      return std::forward<Fn>(fn)();
+    }
+
+    template <class Fn>
+    RightT rightOrElse(Fn &&fn) && {
+      static_assert(!std::is_void<RightT>::value, "rightOrElse() on a void Right");
+      static_assert(detail::FallbackBinds<RightT, decltype(std::declval<Fn>()())>::value,
+                    "rightOrElse() on a reference Right needs fn to return an lvalue reference");
+      if (isRight()) return RightSlot::rvalue(&storage_);
+      return std::forward<Fn>(fn)();
+    }
+
+    /// As above, for the Left.
+    template <class U>
+    LeftT leftOr(U &&fallback) const & {
+      static_assert(!std::is_void<LeftT>::value, "leftOr() on a void Left");
+      static_assert(detail::FallbackBinds<LeftT, U&&>::value, "leftOr() on a reference Left needs an lvalue fallback");
+      if (isLeft()) return LeftSlot::ref(&storage_);
+      return static_cast<LeftT>(std::forward<U>(fallback));
+    }
+
+    template <class U>
+    LeftT leftOr(U &&fallback) && {
+      static_assert(!std::is_void<LeftT>::value, "leftOr() on a void Left");
+      static_assert(detail::FallbackBinds<LeftT, U&&>::value, "leftOr() on a reference Left needs an lvalue fallback");
+      if (isLeft()) return LeftSlot::rvalue(&storage_);
+      return static_cast<LeftT>(std::forward<U>(fallback));
+    }
+
+    template <class Fn>
+    LeftT leftOrElse(Fn &&fn) const & {
+      static_assert(!std::is_void<LeftT>::value, "leftOrElse() on a void Left");
+      static_assert(detail::FallbackBinds<LeftT, decltype(std::declval<Fn>()())>::value,
+                    "leftOrElse() on a reference Left needs fn to return an lvalue reference");
+      if (isLeft()) return LeftSlot::ref(&storage_);
+      return std::forward<Fn>(fn)();
+    }
+
+    template <class Fn>
+    LeftT leftOrElse(Fn &&fn) && {
+      static_assert(!std::is_void<LeftT>::value, "leftOrElse() on a void Left");
+      static_assert(detail::FallbackBinds<LeftT, decltype(std::declval<Fn>()())>::value,
+                    "leftOrElse() on a reference Left needs fn to return an lvalue reference");
+      if (isLeft()) return LeftSlot::rvalue(&storage_);
+      return std::forward<Fn>(fn)();
+    }
 
 
 
     /// either(leftfn, rightfn):
     /// if we're a left, call leftfn(left()),
-    /// otherwise call rightfn(right()).
+    /// otherwise call rightfn(right()). A void side's function takes no
+    /// arguments.
     template <class LeftFn, class RightFn>
-    auto either(LeftFn lf, RightFn rf) const -> decltype(isRight() ? rf(right()) : lf(left())) {
-      return isRight() ? rf(right()) : lf(left());
+    auto either(LeftFn lf, RightFn rf) const
+      -> decltype(isRight() ? RightSlot::apply(rf, std::declval<void const*>())
+                            : LeftSlot::apply(lf, std::declval<void const*>())) {
+      return isRight() ? RightSlot::apply(rf, &storage_) : LeftSlot::apply(lf, &storage_);
     }
 
     /// as above, but non-const.
     template <class LeftFn, class RightFn>
-    auto either(LeftFn lf, RightFn rf) -> decltype(isRight() ? rf(right()) : lf(left())) {
-      return isRight() ? rf(right()) : lf(left());
+    auto either(LeftFn lf, RightFn rf)
+      -> decltype(isRight() ? RightSlot::apply(rf, std::declval<void*>())
+                            : LeftSlot::apply(lf, std::declval<void*>())) {
+      return isRight() ? RightSlot::apply(rf, &storage_) : LeftSlot::apply(lf, &storage_);
     }
 
   private:
 
-    // storage type. If this is changed (e.g. if std::aligned_union isn't well supported)
-    // we should only need to change the implementation of rawGetPtr and construct.
-    typedef typename std::aligned_union<0, LeftT, RightT>::type Storage;
+    template <class Fn, class... Args>
+    Either(detail::EitherInvokeTag, EmplaceLeftTag, Fn &&fn, Args&&... args) {
+      constructFrom<LeftT>(std::forward<Fn>(fn), std::forward<Args>(args)...);
+    }
+
+    template <class Fn, class... Args>
+    Either(detail::EitherInvokeTag, EmplaceRightTag, Fn &&fn, Args&&... args) {
+      constructFrom<RightT>(std::forward<Fn>(fn), std::forward<Args>(args)...);
+    }
+
+    // Cheap to instantiate: a constexpr function rather than a class
+    // template, so it doesn't add a type per (Either, T) pair.
+    template <class T>
+    static constexpr bool isLeftOrRight() {
+      return std::is_same<T, LeftT>::value || std::is_same<T, RightT>::value;
+    }
+
+    // Storage. A raw aligned buffer rather than std::aligned_union, which
+    // instantiates a handful of helper templates per Either. If this is
+    // changed we should only need to change the implementation of
+    // rawGetPtr and construct. References are stored as pointers, and void
+    // as an empty struct, by detail::EitherSlot.
+    typedef typename LeftSlot::Stored LeftStored;
+    typedef typename RightSlot::Stored RightStored;
 
-    Storage storage_;
+    alignas(LeftStored) alignas(RightStored)
+    unsigned char storage_[sizeof(LeftStored) > sizeof(RightStored) ? sizeof(LeftStored) : sizeof(RightStored)];
     bool isLeft_;
 
-    template <class T> T       *rawGetPtr()       { return reinterpret_cast<T*>(&storage_); }
-    template <class T> T const *rawGetPtr() const { return reinterpret_cast<T const*>(&storage_); }
+    template <class T> typename detail::EitherSlot<T>::Pointer rawGetPtr() {
+      return detail::EitherSlot<T>::get(&storage_);
+    }
+    template <class T> typename detail::EitherSlot<T>::ConstPointer rawGetPtr() const {
+      return detail::EitherSlot<T>::get(&storage_);
+    }
 
     template <class T, class... Args>
     void construct(Args&&... args) {
-      static_assert(isLeftOrRight<T>::value, "bug");
       void const *ptr = &storage_; // use a const void to allow const LeftT or RightTs
-      new (const_cast<void*>(ptr)) T(std::forward<Args>(args)...);
+      detail::EitherSlot<T>::construct(const_cast<void*>(ptr), std::forward<Args>(args)...);
       isLeft_ = std::is_same<T, LeftT>::value;
     }
 
+    template <class T, class Fn, class... Args>
+    void constructFrom(Fn &&fn, Args&&... args) {
+      void const *ptr = &storage_;
+      detail::EitherSlot<T>::constructFrom(const_cast<void*>(ptr), std::forward<Fn>(fn), std::forward<Args>(args)...);
+      isLeft_ = std::is_same<T, LeftT>::value;
+    }
+
+    template <class T, class Fn, class... Args>
+    using constructFromIsNoexcept = typename detail::EitherSlot<T>::template ConstructFromIsNoexcept<Fn, Args...>;
+
+    template <class T, class Tag, class Fn, class... Args>
+    void replaceFrom(Tag, std::true_type, Fn &&fn, Args&&... args) {
+      destroy();
+      constructFrom<T>(std::forward<Fn>(fn), std::forward<Args>(args)...);
+    }
+
+    template <class T, class Tag, class Fn, class... Args>
+    void replaceFrom(Tag tag, std::false_type, Fn &&fn, Args&&... args) {
+      static_assert(std::is_move_constructible<typename detail::EitherSlot<T>::Stored>::value,
+                    "emplaceLeftFrom/emplaceRightFrom of a type that can't be moved needs a noexcept fn "
+                    "returning it");
+      Either next(detail::EitherInvokeTag(), tag, std::forward<Fn>(fn), std::forward<Args>(args)...);
+      destroy();
+      detail::EitherSlot<T>::move(&storage_, &next.storage_);
+      isLeft_ = next.isLeft_;
+    }
+
     void destroy() {
       if (isLeft()) {
-        rawGetPtr<LeftT>()->~LeftT();
+        LeftSlot::destroy(&storage_);
       } else {
-        rawGetPtr<RightT>()->~RightT();
+        RightSlot::destroy(&storage_);
       }
     }
 
@@ -279,15 +770,19 @@ namespace funky {
 
   template <class L, class R>
   void swap(Either<L, R> &a, Either<L, R> &b) {
-   if (a.isLeft() && b.isLeft()) {
-     using std::swap;
-     swap(a.left(), b.left());
-   } else if (a.isRight() && b.isRight()) {
-     using std::swap;
-     swap(a.right(), b.right());
-   } else {
-     std::swap(a, b);
-   }
+    typedef detail::SwapByMoving<L> LeftByMoving;
+    typedef detail::SwapByMoving<R> RightByMoving;
+    if (a.isLeft() && b.isLeft() && !LeftByMoving::value) {
+      detail::swapInPlace<L>(a, b, LeftByMoving());
+    } else if (a.isRight() && b.isRight() && !RightByMoving::value) {
+      detail::swapInPlace<R>(a, b, RightByMoving());
+    } else {
+      // not std::swap(a, b): that drags in a pile of type traits for every
+      // Either it's instantiated with, and this is all it would do anyway.
+      Either<L, R> tmp{std::move(a)};
+      a = std::move(b);
+      b = std::move(tmp);
+    }
   }
 
 }
@@ -0,0 +1,317 @@
+#ifndef FUNKY_EITHER_COROUTINE_HH_INCLUDED
+#define FUNKY_EITHER_COROUTINE_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+/// Lets a function returning an Either be a C++20 coroutine, in which
+/// `co_await e` on another Either evaluates to its Right, or returns its Left
+/// from the function immediately:
+///
+///     Either<Error, Config> load(std::string const &path) {
+///       std::string text = co_await readFile(path); // Either<Error, std::string>
+///       Config c = co_await parse(text);            // Either<Error, Config>
+///       co_return c;
+///     }
+///
+/// A coroutine returning Either<E, void> ends with `co_return;`, or by
+/// running off its end, and `co_await` on one evaluates to nothing.
+///
+/// Such coroutines never suspend, so they run start to finish inside the
+/// call. The frame is freed before the call returns, which is what lets a
+/// compiler that does heap allocation elision (clang) remove the allocation.
+/// Where it doesn't (gcc), pass a CoroutineArena as the first parameter and
+/// frames are carved out of its buffer instead.
+///
+/// Without C++20 coroutine support this header only defines CoroutineArena.
+
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#include <optional>
+#define FUNKY_HAS_COROUTINES 1
+#else
+#define FUNKY_HAS_COROUTINES 0
+#endif
+
+namespace funky {
+
+  /// A bump allocator over a caller-provided buffer, for coroutine frames.
+  /// Frames of nested calls are freed in reverse order, so the space is
+  /// reused; when the buffer runs out, frames come from the heap.
+  class CoroutineArena {
+  public:
+    /// `buffer` should be aligned for std::max_align_t.
+    CoroutineArena(void *buffer, std::size_t size)
+      : begin_(static_cast<unsigned char*>(buffer)), top_(begin_), end_(begin_ + size) {}
+
+    template <std::size_t N>
+    explicit CoroutineArena(unsigned char (&buffer)[N]) : CoroutineArena(buffer, N) {}
+
+    CoroutineArena(CoroutineArena const &) = delete;
+    CoroutineArena &operator=(CoroutineArena const &) = delete;
+
+    /// Null if there isn't room.
+    void *allocate(std::size_t n) {
+      n = alignUp(n);
+      if (n > static_cast<std::size_t>(end_ - top_)) {
+        return nullptr;
+      }
+      unsigned char *p = top_;
+      top_ += n;
+      return p;
+    }
+
+    /// Only reclaims space when `p` is the most recent allocation.
+    void deallocate(void *p, std::size_t n) {
+      if (static_cast<unsigned char*>(p) + alignUp(n) == top_) {
+        top_ = static_cast<unsigned char*>(p);
+      }
+    }
+
+    std::size_t used() const { return static_cast<std::size_t>(top_ - begin_); }
+
+  private:
+    static std::size_t alignUp(std::size_t n) {
+      return (n + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    unsigned char *begin_, *top_, *end_;
+  };
+
+#if FUNKY_HAS_COROUTINES
+
+  namespace detail {
+
+    // every frame starts with a header saying which arena, if any, it came from.
+    struct alignas(std::max_align_t) FrameHeader {
+      CoroutineArena *arena;
+    };
+
+    inline void *allocateFrame(CoroutineArena *arena, std::size_t n) {
+      std::size_t const total = sizeof(FrameHeader) + n;
+      void *p = arena ? arena->allocate(total) : nullptr;
+      if (!p) {
+        p = ::operator new(total);
+        arena = nullptr;
+      }
+      FrameHeader *h = new (p) FrameHeader{arena};
+      return h + 1;
+    }
+
+    inline void deallocateFrame(void *frame, std::size_t n) {
+      FrameHeader *h = static_cast<FrameHeader*>(frame) - 1;
+      if (h->arena) {
+        h->arena->deallocate(h, sizeof(FrameHeader) + n);
+      } else {
+        ::operator delete(h);
+      }
+    }
+
+    // A coroutine that throws from its first call, to see what the call
+    // does with its frame.
+    struct FrameProbe {
+      struct promise_type {
+        promise_type(bool &freed, std::coroutine_handle<promise_type> &threw) : freed(&freed), threw(&threw) {}
+        ~promise_type() { *freed = true; }
+
+        FrameProbe get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+
+        void unhandled_exception() {
+          *threw = std::coroutine_handle<promise_type>::from_promise(*this);
+          throw;
+        }
+
+        bool *freed;
+        std::coroutine_handle<promise_type> *threw;
+      };
+    };
+
+    inline FrameProbe throwFromFrame(bool &, std::coroutine_handle<FrameProbe::promise_type> &) {
+      throw 0;
+      co_return;
+    }
+
+    // Whether an exception leaving a coroutine's first call frees its frame.
+    // The standard says it doesn't (the coroutine is left suspended at its
+    // final suspend point, for its owner to destroy), but gcc's call does.
+    // Rather than trust either, a probe finds out, once.
+    inline bool probeCallFreesFrameOnThrow() {
+      bool freed = false;
+      std::coroutine_handle<FrameProbe::promise_type> threw;
+      try {
+        throwFromFrame(freed, threw);
+      } catch (int) {
+      }
+      if (!freed) {
+        threw.destroy();
+      }
+      return freed;
+    }
+
+    inline bool callFreesFrameOnThrow() {
+      static bool const frees = probeCallFreesFrameOnThrow();
+      return frees;
+    }
+
+    template <class E, class T>
+    class CoroutinePromise;
+
+    template <class E, class T>
+    class CoroutineResult;
+
+    /// What an Either coroutine returns to its caller before converting to
+    /// the Either. The result is stored here rather than in the promise,
+    /// because the frame (and the promise with it) is gone by the time the
+    /// conversion happens. The conversion only moves it, and can't throw:
+    /// an exception leaving it is one the call's own cleanup isn't written
+    /// for, and compilers differ on what they do with the frame then.
+    ///
+    /// An exception the coroutine throws instead is rethrown from
+    /// unhandled_exception(), to leave the call as it is. Where the call
+    /// doesn't free the frame then (see callFreesFrameOnThrow()), this does,
+    /// as the exception unwinds the call.
+    template <class E, class T>
+    class CoroutineReturn {
+    public:
+      ~CoroutineReturn() {
+        if (threw_) {
+          threw_.destroy();
+        }
+      }
+
+      CoroutineReturn(CoroutineReturn const &) = delete;
+      CoroutineReturn &operator=(CoroutineReturn const &) = delete;
+
+      operator Either<E, T>() noexcept {
+        FUNKY_CHECK(result_ && "Either coroutine finished without a result");
+        return std::move(*result_);
+      }
+
+    private:
+      friend class CoroutinePromise<E, T>;
+      friend class CoroutineResult<E, T>;
+
+      // only made by get_return_object(), whose prvalue initializes the
+      // call's return object directly; it's never copied or moved, so
+      // `this` stays valid for the promise to refer to.
+      explicit CoroutineReturn(CoroutinePromise<E, T> &p) : result_(), threw_() { p.return_ = this; }
+
+      std::optional<Either<E, T>> result_;
+      std::coroutine_handle<CoroutinePromise<E, T>> threw_;
+    };
+
+    /// co_return, which sets the result with return_value, or for an
+    /// Either<E, void> with return_void (a promise can't have both).
+    template <class E, class T>
+    class CoroutineResult {
+    public:
+      template <class U>
+      void return_value(U &&u) { return_->result_.emplace(std::forward<U>(u)); }
+
+    protected:
+      CoroutineResult() : return_(nullptr) {}
+
+      CoroutineReturn<E, T> *return_;
+    };
+
+    template <class E>
+    class CoroutineResult<E, void> {
+    public:
+      void return_void() { return_->result_.emplace(Either<E, void>::success()); }
+
+    protected:
+      CoroutineResult() : return_(nullptr) {}
+
+      CoroutineReturn<E, void> *return_;
+    };
+
+    template <class E, class T>
+    class CoroutinePromise : public CoroutineResult<E, T> {
+      static_assert(std::is_nothrow_move_constructible<Either<E, T>>::value,
+                    "an Either coroutine's result is moved out after its frame is gone, "
+                    "where a throwing move can't be handled");
+
+    public:
+      CoroutineReturn<E, T> get_return_object() { return CoroutineReturn<E, T>{*this}; }
+
+      std::suspend_never initial_suspend() noexcept { return {}; }
+
+      // finishing frees the frame.
+      std::suspend_never final_suspend() noexcept { return {}; }
+
+      // rethrown to the caller, leaving the frame for the CoroutineReturn to
+      // destroy if the call won't.
+      void unhandled_exception() {
+        if (!callFreesFrameOnThrow()) {
+          this->return_->threw_ = std::coroutine_handle<CoroutinePromise>::from_promise(*this);
+        }
+        throw;
+      }
+
+      /// `co_await` on an Either whose Left converts to E.
+      template <class E2, class U>
+      auto await_transform(Either<E2, U> &&e) { return Awaiter<E2, U, Either<E2, U>&&>{std::move(e), *this}; }
+
+      template <class E2, class U>
+      auto await_transform(Either<E2, U> &e) { return Awaiter<E2, U, Either<E2, U>&>{e, *this}; }
+
+      template <class E2, class U>
+      auto await_transform(Either<E2, U> const &e) { return Awaiter<E2, U, Either<E2, U> const&>{e, *this}; }
+
+      static void *operator new(std::size_t n) { return allocateFrame(nullptr, n); }
+
+      template <class... Args>
+      static void *operator new(std::size_t n, CoroutineArena &arena, Args const &...) {
+        return allocateFrame(&arena, n);
+      }
+
+      static void operator delete(void *p, std::size_t n) { deallocateFrame(p, n); }
+
+    private:
+      friend class CoroutineReturn<E, T>;
+
+      // a Right resumes with the value; a Left is stored as the result and the
+      // coroutine is destroyed without resuming.
+      template <class E2, class U, class Ref>
+      struct Awaiter {
+        Ref either;
+        CoroutinePromise &promise;
+
+        bool await_ready() const noexcept { return either.isRight(); }
+
+        void await_suspend(std::coroutine_handle<CoroutinePromise> h) {
+          promise.return_->result_.emplace(EmplaceLeft, std::forward<Ref>(either).left());
+          h.destroy();
+        }
+
+        decltype(auto) await_resume() { return std::forward<Ref>(either).right(); }
+      };
+    };
+
+  }
+
+#endif
+
+}
+
+#if FUNKY_HAS_COROUTINES
+
+template <class E, class T, class... Args>
+struct std::coroutine_traits<funky::Either<E, T>, Args...> {
+  typedef funky::detail::CoroutinePromise<E, T> promise_type;
+};
+
+#endif
+
+#endif
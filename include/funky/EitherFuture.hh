@@ -0,0 +1,440 @@
+#ifndef FUNKY_EITHER_FUTURE_HH_INCLUDED
+#define FUNKY_EITHER_FUTURE_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// A promise/future pair whose value is an Either, for carrying errors across
+/// threads as Lefts rather than exceptions.
+///
+/// Compared to std::promise/std::future, a pair shares a single allocation
+/// holding an atomic state word and the Either; there's no mutex or condition
+/// variable. Waiting spins briefly and then sleeps on the state word (a futex
+/// on Linux, out of line in libfunky). Continuations attached with then() run
+/// inline: immediately if the value is already there, otherwise in the thread
+/// that sets it.
+
+namespace funky {
+
+  template <class E, class T> class EitherFuture;
+  template <class E, class T> class EitherPromise;
+
+  namespace detail {
+
+    /// Sleep until `word` might no longer equal `expected` (spurious wakeups
+    /// are possible), and wake one or every thread sleeping on `word`.
+    void futexWait(std::atomic<std::uint32_t> &word, std::uint32_t expected);
+    void futexWakeOne(std::atomic<std::uint32_t> &word);
+    void futexWakeAll(std::atomic<std::uint32_t> &word);
+
+    /// How long wait() spins before sleeping: zero on a single core, where
+    /// spinning only delays the thread we're waiting for.
+    int waitSpins();
+
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__)
+      __asm__ __volatile__("yield");
+#endif
+    }
+
+    template <class V> class FutureState;
+    struct FutureAccess;
+
+    /// What a FutureState runs once its value is ready. `from` has already
+    /// been handed over; the continuation must release it.
+    template <class V>
+    class Continuation {
+    public:
+      virtual void run(FutureState<V> &from) = 0;
+    protected:
+      ~Continuation() {}
+    };
+
+    /// The shared slot behind a promise and its future.
+    template <class V>
+    class FutureState {
+    public:
+      enum : std::uint32_t {
+        Ready     = 1, // value_ is constructed
+        Continued = 2, // continuation_ is set
+        Waiting   = 4, // someone may be asleep on state_
+        Setting   = 8  // set() has been called, so value_ is or will be constructed
+      };
+
+      explicit FutureState(std::uint32_t refs)
+        : state_(0), refs_(refs), continuation_(nullptr), storage_() {}
+
+      virtual ~FutureState() {
+        if (state_.load(std::memory_order_relaxed) & Ready) {
+          value().~V();
+        }
+      }
+
+      FutureState(FutureState const &) = delete;
+      FutureState &operator=(FutureState const &) = delete;
+
+      V &value() { return *reinterpret_cast<V*>(&storage_); }
+
+      bool ready() const { return (state_.load(std::memory_order_acquire) & Ready) != 0; }
+
+      /// Only the first call sets the value: with checks off, later ones
+      /// are ignored rather than overwriting it. If constructing the value
+      /// throws, it's as if set() hadn't been called.
+      template <class... Args>
+      void set(Args&&... args) {
+        bool const first = !(state_.fetch_or(Setting, std::memory_order_relaxed) & Setting);
+        FUNKY_CHECK(first && "EitherPromise set twice");
+        if (!first) {
+          return;
+        }
+        try {
+          new (&storage_) V(std::forward<Args>(args)...);
+        } catch (...) {
+          state_.fetch_and(~std::uint32_t(Setting), std::memory_order_relaxed);
+          throw;
+        }
+        std::uint32_t const old = state_.fetch_or(Ready, std::memory_order_acq_rel);
+        if (old & Continued) {
+          continuation_->run(*this);
+        } else if (old & Waiting) {
+          futexWakeAll(state_);
+        }
+      }
+
+      /// Hand the value to `c`, running it now if the value is ready.
+      void attach(Continuation<V> *c) {
+        continuation_ = c;
+        if (state_.fetch_or(Continued, std::memory_order_acq_rel) & Ready) {
+          c->run(*this);
+        }
+      }
+
+      void wait() {
+        for (int spin = waitSpins(); spin > 0; --spin) {
+          if (ready()) {
+            return;
+          }
+          cpuRelax();
+        }
+        std::uint32_t s = state_.load(std::memory_order_acquire);
+        while (!(s & Ready)) {
+          if (!(s & Waiting) &&
+              !state_.compare_exchange_weak(s, s | Waiting, std::memory_order_acquire)) {
+            continue;
+          }
+          futexWait(state_, s | Waiting);
+          s = state_.load(std::memory_order_acquire);
+        }
+      }
+
+      void addRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+      void release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          delete this;
+        }
+      }
+
+    private:
+      std::atomic<std::uint32_t> state_;
+      std::atomic<std::uint32_t> refs_;
+      Continuation<V> *continuation_;
+      typename std::aligned_storage<sizeof(V), alignof(V)>::type storage_;
+    };
+
+    /// The state of a future returned by then(). It is also the continuation
+    /// of the future it was called on, so then() makes one allocation.
+    template <class V, class W, class Fn>
+    class ThenState : public FutureState<W>, public Continuation<V> {
+    public:
+      explicit ThenState(Fn &&fn) : FutureState<W>(2), fn_(std::move(fn)) {}
+
+      // noexcept: an exception would escape into whichever thread set the
+      // value, and leave this future never ready, with its waiters stuck.
+      // Like a ThreadPool task, a continuation reports failure with a Left.
+      void run(FutureState<V> &from) noexcept override {
+        this->set(fn_(std::move(from.value())));
+        from.release();
+        this->release();
+      }
+
+    private:
+      Fn fn_;
+    };
+
+    template <class W>
+    struct FutureFor {
+      static_assert(sizeof(W) == 0, "then() continuations must return an Either");
+    };
+
+    template <class E, class T>
+    struct FutureFor<Either<E, T>> {
+      typedef EitherFuture<E, T> type;
+    };
+
+    template <class V, class Fn>
+    struct ThenResult {
+      typedef typename std::decay<decltype(std::declval<Fn&>()(std::declval<V&&>()))>::type Value;
+      typedef typename FutureFor<Value>::type Future;
+    };
+
+  }
+
+
+  /// The receiving end of an EitherPromise. Move-only; get() and then()
+  /// consume it.
+  template <class E, class T>
+  class EitherFuture {
+  public:
+    typedef Either<E, T> Value;
+
+    /// A future with no state; only valid() may be called on it.
+    EitherFuture() : state_(nullptr) {}
+
+    EitherFuture(EitherFuture &&o) noexcept : state_(o.state_) { o.state_ = nullptr; }
+
+    EitherFuture &operator=(EitherFuture &&o) noexcept {
+      std::swap(state_, o.state_);
+      return *this;
+    }
+
+    ~EitherFuture() {
+      if (state_) {
+        state_->release();
+      }
+    }
+
+    EitherFuture(EitherFuture const &) = delete;
+    EitherFuture &operator=(EitherFuture const &) = delete;
+
+    bool valid() const { return state_ != nullptr; }
+
+    bool isReady() const { FUNKY_CHECK(valid()); return state_->ready(); }
+
+    /// Block until the value is set.
+    void wait() const { FUNKY_CHECK(valid()); state_->wait(); }
+
+    /// Block until the value is set, and move it out.
+    Value get() {
+      FUNKY_CHECK(valid());
+      state_->wait();
+      Value v{std::move(state_->value())};
+      state_->release();
+      state_ = nullptr;
+      return v;
+    }
+
+    /// Chain `fn`, which takes a `Value &&` and returns an Either, and get a
+    /// future for its result. If the value is already set `fn` runs now, in
+    /// this thread, otherwise it runs in whichever thread sets the value.
+    template <class Fn>
+    typename detail::ThenResult<Value, Fn>::Future then(Fn fn) {
+      FUNKY_CHECK(valid());
+      typedef detail::ThenResult<Value, Fn> R;
+      typedef detail::ThenState<Value, typename R::Value, Fn> Next;
+      Next *next = new Next(std::move(fn));
+      typename R::Future f{next};
+      detail::FutureState<Value> *prev = state_;
+      state_ = nullptr;
+      prev->attach(next);
+      return f;
+    }
+
+  private:
+    template <class, class> friend class EitherFuture;
+    friend class EitherPromise<E, T>;
+    friend struct detail::FutureAccess;
+
+    explicit EitherFuture(detail::FutureState<Value> *s) : state_(s) {}
+
+    detail::FutureState<Value> *state_;
+  };
+
+
+  /// The sending end. A promise must be given a value (exactly once) before
+  /// it's destroyed; otherwise its future would wait forever.
+  template <class E, class T>
+  class EitherPromise {
+  public:
+    typedef Either<E, T> Value;
+
+    EitherPromise() : state_(new detail::FutureState<Value>(1)), retrieved_(false) {}
+
+    EitherPromise(EitherPromise &&o) noexcept : state_(o.state_), retrieved_(o.retrieved_) {
+      o.state_ = nullptr;
+    }
+
+    EitherPromise &operator=(EitherPromise &&o) noexcept {
+      std::swap(state_, o.state_);
+      std::swap(retrieved_, o.retrieved_);
+      return *this;
+    }
+
+    ~EitherPromise() {
+      if (state_) {
+        FUNKY_CHECK((!retrieved_ || state_->ready()) && "EitherPromise destroyed without a value");
+        state_->release();
+      }
+    }
+
+    EitherPromise(EitherPromise const &) = delete;
+    EitherPromise &operator=(EitherPromise const &) = delete;
+
+    /// May only be called once.
+    EitherFuture<E, T> getFuture() {
+      FUNKY_CHECK(state_ && !retrieved_);
+      retrieved_ = true;
+      state_->addRef();
+      return EitherFuture<E, T>{state_};
+    }
+
+    void set(Value const &v) { state_->set(v); }
+    void set(Value &&v) { state_->set(std::move(v)); }
+
+    template <class... Args>
+    void emplaceLeft(Args&&... args) { state_->set(EmplaceLeft, std::forward<Args>(args)...); }
+
+    template <class... Args>
+    void emplaceRight(Args&&... args) { state_->set(EmplaceRight, std::forward<Args>(args)...); }
+
+  private:
+    detail::FutureState<Value> *state_;
+    bool retrieved_;
+  };
+
+  /// A future that's already holding `v`.
+  template <class E, class T>
+  EitherFuture<E, T> makeReadyFuture(Either<E, T> v) {
+    EitherPromise<E, T> p;
+    EitherFuture<E, T> f = p.getFuture();
+    p.set(std::move(v));
+    return f;
+  }
+
+  namespace detail {
+
+    /// For code that builds on FutureState directly (whenAll, ThreadPool).
+    struct FutureAccess {
+      template <class E, class T>
+      static EitherFuture<E, T> make(FutureState<Either<E, T>> *s) { return EitherFuture<E, T>{s}; }
+
+      template <class E, class T>
+      static FutureState<Either<E, T>> *detach(EitherFuture<E, T> &f) {
+        FutureState<Either<E, T>> *s = f.state_;
+        f.state_ = nullptr;
+        return s;
+      }
+    };
+
+    /// Collects whenAll()'s values. The continuations of the input futures
+    /// are parts of this object, so they aren't allocated one by one.
+    template <class E, class T>
+    class WhenAllState {
+    public:
+      typedef Either<E, T> Value;
+
+      struct Part final : Continuation<Value> {
+        Part() : owner(nullptr), index(0) {}
+        Part(Part const &) = delete;
+        Part &operator=(Part const &) = delete;
+
+        void run(FutureState<Value> &from) override { owner->arrive(index, from); }
+        WhenAllState *owner;
+        std::size_t index;
+      };
+
+      explicit WhenAllState(std::size_t n)
+        : promise_(), remaining_(n), settled_(false), parts_(n), slots_(n), constructed_(n, 0) {
+        for (std::size_t i = 0; i < n; ++i) {
+          parts_[i].owner = this;
+          parts_[i].index = i;
+        }
+      }
+
+      WhenAllState(WhenAllState const &) = delete;
+      WhenAllState &operator=(WhenAllState const &) = delete;
+
+      EitherFuture<E, std::vector<T>> future() { return promise_.getFuture(); }
+
+      Part &part(std::size_t i) { return parts_[i]; }
+
+    private:
+      // the first Left settles the result right away; the rest are dropped.
+      void arrive(std::size_t i, FutureState<Value> &from) {
+        Value &v = from.value();
+        if (v.isRight()) {
+          new (&slots_[i]) T(std::move(v.right()));
+          constructed_[i] = 1;
+        } else if (!settled_.exchange(true, std::memory_order_acq_rel)) {
+          promise_.emplaceLeft(std::move(v.left()));
+        }
+        from.release();
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          finish();
+        }
+      }
+
+      void finish() {
+        if (!settled_.load(std::memory_order_relaxed)) {
+          std::vector<T> out;
+          out.reserve(slots_.size());
+          for (std::size_t i = 0; i < slots_.size(); ++i) {
+            out.push_back(std::move(slot(i)));
+          }
+          promise_.emplaceRight(std::move(out));
+        }
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+          if (constructed_[i]) {
+            slot(i).~T();
+          }
+        }
+        delete this;
+      }
+
+      T &slot(std::size_t i) { return *reinterpret_cast<T*>(&slots_[i]); }
+
+      EitherPromise<E, std::vector<T>> promise_;
+      std::atomic<std::size_t> remaining_;
+      std::atomic<bool> settled_;
+      std::vector<Part> parts_;
+      std::vector<typename std::aligned_storage<sizeof(T), alignof(T)>::type> slots_;
+      std::vector<char> constructed_;
+    };
+
+  }
+
+  /// A future for the Right values of all of `futures`, in order, or for the
+  /// first Left any of them produces. A Left settles the result as soon as
+  /// it arrives, without waiting for the other futures.
+  template <class E, class T>
+  EitherFuture<E, std::vector<T>> whenAll(std::vector<EitherFuture<E, T>> futures) {
+    if (futures.empty()) {
+      return makeReadyFuture(Either<E, std::vector<T>>{std::vector<T>{}});
+    }
+    for (EitherFuture<E, T> const &f : futures) {
+      FUNKY_CHECK(f.valid());
+    }
+    detail::WhenAllState<E, T> *s = new detail::WhenAllState<E, T>(futures.size());
+    EitherFuture<E, std::vector<T>> result = s->future();
+    // s may be gone once the last part is attached.
+    for (std::size_t i = 0; i < futures.size(); ++i) {
+      detail::FutureAccess::detach(futures[i])->attach(&s->part(i));
+    }
+    return result;
+  }
+
+}
+
+#endif
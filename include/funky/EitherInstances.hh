@@ -0,0 +1,60 @@
+#ifndef FUNKY_EITHER_INSTANCES_HH_INCLUDED
+#define FUNKY_EITHER_INSTANCES_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+
+#include <string>
+
+// generated with libfunky, into the build's include directory.
+#if defined(__has_include)
+#if __has_include("funky/LibraryConfig.hh")
+#include "funky/LibraryConfig.hh"
+#endif
+#endif
+
+/// Explicit instantiations of commonly used Eithers, compiled once into
+/// libfunky.a. Include this instead of Either.hh (and link with libfunky) so
+/// that translation units using these types don't each instantiate and emit
+/// their members again.
+///
+/// Only the non-template members are covered; member templates like
+/// `either()` and `emplace<T>()` are still instantiated where they're used.
+///
+/// Either's members depend on FUNKY_CHECK_LEVEL and FUNKY_EITHER_TELEMETRY,
+/// so the instantiations are only used where both match libfunky's build,
+/// as recorded in funky/LibraryConfig.hh. Elsewhere, mixing them with inline
+/// members compiled differently would break the one definition rule, so
+/// FUNKY_EITHER_INSTANCES_EXTERN is 0 and these Eithers are instantiated
+/// locally, as with Either.hh.
+
+/// X(LeftT, RightT) for each instantiation.
+#define FUNKY_EITHER_INSTANCES(X) \
+  X(int, std::string) \
+  X(std::string, int) \
+  X(bool, std::string) \
+  X(std::string, bool) \
+  X(long, std::string) \
+  X(double, std::string)
+
+#if defined(FUNKY_LIBRARY_CHECK_LEVEL) && FUNKY_CHECK_LEVEL == FUNKY_LIBRARY_CHECK_LEVEL && \
+    defined(FUNKY_EITHER_TELEMETRY) == FUNKY_LIBRARY_EITHER_TELEMETRY
+#define FUNKY_EITHER_INSTANCES_EXTERN 1
+#else
+#define FUNKY_EITHER_INSTANCES_EXTERN 0
+#endif
+
+#if FUNKY_EITHER_INSTANCES_EXTERN
+namespace funky {
+
+#define FUNKY_EXTERN_EITHER(L, R) extern template class Either<L, R>;
+  FUNKY_EITHER_INSTANCES(FUNKY_EXTERN_EITHER)
+#undef FUNKY_EXTERN_EITHER
+
+}
+#endif
+
+#endif
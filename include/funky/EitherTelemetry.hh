@@ -0,0 +1,129 @@
+#ifndef FUNKY_EITHER_TELEMETRY_HH_INCLUDED
+#define FUNKY_EITHER_TELEMETRY_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/// Opt-in counting of Left constructions per call site.
+///
+/// Define FUNKY_EITHER_TELEMETRY before including Either.hh (in every
+/// translation unit that should be counted) and link with libfunky. Every
+/// Either constructed as a Left from a LeftT then records the file and line
+/// of the expression that constructed it, as does every set() of a Left.
+/// operator=, EmplaceLeft, fromInvoke(EmplaceLeft, ...), emplaceLeft(),
+/// emplaceLeftFrom() and emplace<LeftT>() can't see their caller's location,
+/// and record their own line in Either.hh. Copies and moves
+/// of Eithers aren't counted, so a Left that's propagated up through several
+/// layers is counted once, where it was made.
+///
+/// Counters live in per-thread tables, padded to cache lines so threads never
+/// contend, and are only read by snapshot(). Without FUNKY_EITHER_TELEMETRY
+/// none of this is compiled into Either.
+///
+/// Eithers are class templates, so the same Either<L, R> must not be used from
+/// translation units that disagree about FUNKY_EITHER_TELEMETRY.
+
+namespace funky {
+namespace telemetry {
+
+  /// Where an Either was constructed. The defaults capture the caller's
+  /// location when used as a default argument.
+  struct Site {
+    Site(char const *file = __builtin_FILE(), unsigned line = __builtin_LINE())
+      : file(file), line(line) {}
+
+    char const *file;
+    unsigned line;
+  };
+
+  struct SiteCount {
+    char const *file;
+    unsigned line;
+    std::uint64_t lefts;
+  };
+
+  /// Totals for every site, across all threads (including ones that have
+  /// exited), highest count first. Sites that didn't fit in a thread's table
+  /// are reported together under the file "<overflow>".
+  std::vector<SiteCount> snapshot();
+
+  /// Zero every counter. Increments racing with a reset may survive it.
+  void reset();
+
+  /// Print snapshot() to `out`, one "file:line count" per line.
+  void dump(std::FILE *out = stderr);
+
+  namespace detail {
+
+    /// One thread's counters. Only the owning thread writes; snapshot() reads
+    /// concurrently, hence the relaxed atomics.
+    struct alignas(64) ThreadCounters {
+      static std::size_t const Capacity = 512; // power of two
+
+      struct Slot {
+        std::atomic<char const *> file;
+        std::atomic<unsigned> line;
+        std::atomic<std::uint64_t> count;
+      };
+
+      ThreadCounters() : slots(), overflow() {}
+
+      void record(char const *file, unsigned line) {
+        std::size_t h = reinterpret_cast<std::uintptr_t>(file) ^ (std::size_t(line) * 0x9e3779b97f4a7c15ull);
+        h ^= h >> 29;
+        for (std::size_t probe = 0; probe < Capacity; ++probe) {
+          Slot &s = slots[(h + probe) & (Capacity - 1)];
+          char const *f = s.file.load(std::memory_order_relaxed);
+          if (f == file && s.line.load(std::memory_order_relaxed) == line) {
+            bump(s.count);
+            return;
+          }
+          if (f == nullptr) {
+            s.line.store(line, std::memory_order_relaxed);
+            s.count.store(1, std::memory_order_relaxed);
+            s.file.store(file, std::memory_order_release);
+            return;
+          }
+        }
+        bump(overflow);
+      }
+
+      // not fetch_add: we're the only writer, so skip the locked instruction.
+      static void bump(std::atomic<std::uint64_t> &c) {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      }
+
+      Slot slots[Capacity];
+      std::atomic<std::uint64_t> overflow;
+    };
+
+    /// The calling thread's counters, or null before its first Left.
+    inline ThreadCounters *&current() {
+      static thread_local ThreadCounters *counters = nullptr;
+      return counters;
+    }
+
+    /// Allocate and register counters for this thread (out of line).
+    ThreadCounters *attachThread();
+
+  }
+
+  /// Record a Left constructed at file:line.
+  inline void recordLeft(char const *file, unsigned line) {
+    detail::ThreadCounters *c = detail::current();
+    if (__builtin_expect(c == nullptr, 0)) {
+      c = detail::attachThread();
+    }
+    c->record(file, line);
+  }
+
+}
+}
+
+#endif
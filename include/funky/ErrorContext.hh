@@ -0,0 +1,171 @@
+#ifndef FUNKY_ERROR_CONTEXT_HH_INCLUDED
+#define FUNKY_ERROR_CONTEXT_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+#include "funky/ErrorMessage.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace funky {
+
+  /// A bump allocator for error contexts. Memory comes from chunks that are
+  /// kept when the arena is reset or rewound, so once an arena has grown to
+  /// the size of its busiest request it doesn't allocate again.
+  ///
+  /// Nothing allocated from an arena is destroyed; it's only for trivially
+  /// destructible things, like ErrorContext's nodes.
+  class ErrorArena {
+    struct Chunk;
+
+  public:
+    /// A position in the arena, to rewind() to.
+    struct Mark {
+      Chunk *chunk;
+      char *next;
+    };
+
+    /// Rewinds the arena to where it was when the scope began, when it ends.
+    /// Scopes nest, so a request handler can use one without knowing
+    /// whether its caller did.
+    class Scope {
+    public:
+      explicit Scope(ErrorArena &arena = ErrorArena::local())
+        : arena_(arena), mark_(arena.mark()) {}
+      ~Scope() { arena_.rewind(mark_); }
+
+      Scope(Scope const &) = delete;
+      Scope &operator=(Scope const &) = delete;
+
+    private:
+      ErrorArena &arena_;
+      Mark mark_;
+    };
+
+    /// An empty arena, which allocates chunks of `chunkSize` bytes when
+    /// it's first used.
+    explicit ErrorArena(std::size_t chunkSize = 4096)
+      : chunkSize_(chunkSize), first_(nullptr), current_(nullptr), next_(nullptr), end_(nullptr) {}
+    ~ErrorArena() { release(); }
+
+    ErrorArena(ErrorArena const &) = delete;
+    ErrorArena &operator=(ErrorArena const &) = delete;
+
+    /// The calling thread's arena, which ErrorContext uses by default.
+    static ErrorArena &local() {
+      static thread_local ErrorArena arena;
+      return arena;
+    }
+
+    /// `size` bytes aligned to `align`, which must be a power of two no
+    /// bigger than alignof(std::max_align_t).
+    void *allocate(std::size_t size, std::size_t align) {
+      std::uintptr_t const p = (reinterpret_cast<std::uintptr_t>(next_) + align - 1) & ~(align - 1);
+      std::uintptr_t const end = reinterpret_cast<std::uintptr_t>(end_);
+      // rounding up can take p past the end of a chunk whose size isn't a
+      // multiple of align, so check that before taking the difference.
+      if (next_ != nullptr && p <= end && size <= end - p) {
+        next_ = reinterpret_cast<char*>(p) + size;
+        return reinterpret_cast<void*>(p);
+      }
+      return allocateSlow(size, align);
+    }
+
+    Mark mark() const { return Mark{current_, next_}; }
+
+    /// Free everything allocated since `m` was taken, keeping the memory.
+    /// Anything allocated after it is dangling afterwards.
+    void rewind(Mark m);
+
+    /// Free everything, keeping the memory.
+    void reset() { rewind(Mark{nullptr, nullptr}); }
+
+    /// Free everything and return the memory.
+    void release();
+
+    /// Bytes in use (including alignment padding) and bytes held.
+    std::size_t bytesUsed() const;
+    std::size_t bytesReserved() const;
+
+  private:
+    void *allocateSlow(std::size_t size, std::size_t align);
+
+    std::size_t chunkSize_;
+    Chunk *first_;
+    Chunk *current_;
+    char *next_;
+    char *end_;
+  };
+
+  /// The Left of an Either for errors that pick up context as they
+  /// propagate: "loading config: reading /etc/foo: permission denied". Each
+  /// layer adds a message in front of its cause, in a node allocated from
+  /// an ErrorArena, so an ErrorContext is a single pointer and propagating
+  /// one never touches the heap.
+  ///
+  /// An ErrorContext is only valid until its arena is reset, or rewound past
+  /// it. Copy out what's needed (str(), say) before that happens.
+  class ErrorContext {
+    struct Node {
+      ErrorMessage message;
+      Node const *cause;
+    };
+
+  public:
+    /// A root error.
+    explicit ErrorContext(ErrorMessage message, ErrorArena &arena = ErrorArena::local())
+      : node_(make(message, nullptr, arena)) {}
+
+    /// `message`, caused by `cause`.
+    ErrorContext(ErrorMessage message, ErrorContext cause, ErrorArena &arena = ErrorArena::local())
+      : node_(make(message, cause.node_, arena)) {}
+
+    /// This layer's message.
+    ErrorMessage const &message() const { return node_->message; }
+
+    bool hasCause() const { return node_->cause != nullptr; }
+    ErrorContext cause() const { FUNKY_CHECK(hasCause()); return ErrorContext(node_->cause); }
+
+    /// The innermost message, where the error started.
+    ErrorMessage const &rootMessage() const;
+
+    /// The number of messages in the chain.
+    std::size_t depth() const;
+
+    /// Every message, outermost first, separated by ": ".
+    std::string str() const;
+
+    /// Whether both are the same chain (not just the same messages).
+    bool operator==(ErrorContext const &o) const { return node_ == o.node_; }
+    bool operator!=(ErrorContext const &o) const { return node_ != o.node_; }
+
+  private:
+    explicit ErrorContext(Node const *node) : node_(node) {}
+
+    static Node const *make(ErrorMessage const &message, Node const *cause, ErrorArena &arena) {
+      return new (arena.allocate(sizeof(Node), alignof(Node))) Node{message, cause};
+    }
+
+    Node const *node_;
+  };
+
+  /// `e`, with `message` added to its Left if it is one.
+  template <class T>
+  Either<ErrorContext, T> withContext(Either<ErrorContext, T> e, ErrorMessage const &message,
+                                      ErrorArena &arena = ErrorArena::local()) {
+    if (e.isLeft()) {
+      e.left() = ErrorContext(message, e.left(), arena);
+    }
+    return e;
+  }
+
+}
+
+#endif
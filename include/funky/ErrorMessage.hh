@@ -0,0 +1,223 @@
+#ifndef FUNKY_ERROR_MESSAGE_HH_INCLUDED
+#define FUNKY_ERROR_MESSAGE_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace funky {
+
+  /// A fixed-size error message, meant to be the Left of an Either instead of
+  /// a std::string. It never allocates and is trivially copyable.
+  ///
+  /// A message is one of:
+  ///
+  /// - a string literal, kept as a pointer and a length without copying,
+  ///   when made with fromStatic(); or
+  /// - up to `Size - 1` characters stored inline. Longer text is truncated,
+  ///   ending in "...".
+  ///
+  /// The last byte holds the number of unused inline characters (so it is
+  /// the terminating NUL when the buffer is full), or 0xff for a literal.
+  template <std::size_t Size>
+  class BasicErrorMessage {
+    static_assert(Size >= sizeof(char const*) + sizeof(std::size_t) + sizeof(std::uint64_t) &&
+                  (Size - sizeof(char const*) - sizeof(std::size_t)) % sizeof(std::uint64_t) == 0,
+                  "BasicErrorMessage needs room for a pointer, a length and whole words after them");
+    static_assert(Size <= 255, "the inline length has to fit in the tag byte");
+
+  public:
+    /// How many characters fit inline.
+    static std::size_t const capacity = Size - 1;
+
+    /// An empty message.
+    BasicErrorMessage() : ptr_(), size_(), tail_() { setInlineSize(0); }
+
+    /// The text in `text`, up to its first NUL, copied inline. An array
+    /// might be a literal, but it might as well be a buffer that's about to
+    /// go away, so it isn't referred to; see fromStatic() for that. Copying
+    /// a literal of known length that fits is as cheap as referring to it.
+    template <std::size_t N>
+    BasicErrorMessage(char const (&text)[N]) : ptr_(), size_(), tail_() {
+      std::size_t const n = length(text, N);
+      if (N <= Size && n <= capacity) {
+        assignWhole(text, n);
+      } else {
+        assign(text, n);
+      }
+    }
+
+    /// Refer to `s`, which must outlive the message, without copying it.
+    /// `s[n]` must be a NUL, so that c_str() ends there.
+    static BasicErrorMessage fromStatic(char const *s, std::size_t n) {
+      FUNKY_CHECK(s[n] == '\0' && "fromStatic text must be NUL-terminated");
+      BasicErrorMessage m;
+      m.setStatic(s, n);
+      return m;
+    }
+
+    /// Refer to a string literal (or other array that outlives the
+    /// message), up to its first NUL, without copying it.
+    template <std::size_t N>
+    static BasicErrorMessage fromStatic(char const (&literal)[N]) {
+      std::size_t const n = length(literal, N);
+      FUNKY_CHECK(n < N && "fromStatic text must be NUL-terminated");
+      BasicErrorMessage m;
+      m.setStatic(literal, n);
+      return m;
+    }
+
+    /// Copy `n` characters of `s` inline, truncating if they don't fit.
+    static BasicErrorMessage copy(char const *s, std::size_t n) {
+      BasicErrorMessage m;
+      m.assign(s, n);
+      return m;
+    }
+
+    static BasicErrorMessage copy(char const *s) { return copy(s, std::strlen(s)); }
+    static BasicErrorMessage copy(std::string const &s) { return copy(s.data(), s.size()); }
+
+    /// Format like printf, straight into the inline buffer.
+    __attribute__((format(printf, 1, 2)))
+    static BasicErrorMessage format(char const *fmt, ...) {
+      BasicErrorMessage m;
+      std::va_list args;
+      va_start(args, fmt);
+      int const n = std::vsnprintf(m.chars(), capacity + 1, fmt, args);
+      va_end(args);
+      std::size_t const size = n < 0 ? 0 : static_cast<std::size_t>(n);
+      if (size > capacity) {
+        m.markTruncated();
+      } else {
+        m.setInlineSize(size);
+      }
+      return m;
+    }
+
+    /// The text, NUL-terminated.
+    char const *c_str() const { return isStatic() ? ptr_ : chars(); }
+    char const *data() const { return c_str(); }
+
+    std::size_t size() const { return isStatic() ? size_ : capacity - tag(); }
+
+    bool empty() const { return size() == 0; }
+
+    /// Whether the text is a literal referred to, rather than stored inline.
+    bool isStatic() const { return tag() == StaticTag; }
+
+    std::string str() const { return std::string(data(), size()); }
+
+    bool operator==(BasicErrorMessage const &o) const {
+      std::size_t const n = size();
+      return n == o.size() && std::memcmp(data(), o.data(), n) == 0;
+    }
+    bool operator!=(BasicErrorMessage const &o) const { return !(*this == o); }
+
+    bool operator==(char const *s) const {
+      std::size_t const n = size();
+      return std::strlen(s) == n && std::memcmp(data(), s, n) == 0;
+    }
+    bool operator!=(char const *s) const { return !(*this == s); }
+
+  private:
+    static unsigned char const StaticTag = 0xff;
+    static std::size_t const TailWords = (Size - sizeof(char const*) - sizeof(std::size_t)) / sizeof(std::uint64_t);
+
+    // inline text overlays all of the members, which are typed (rather than
+    // one char array) so that copies are a few word moves the compiler can
+    // keep in registers.
+    char       *chars()       { return reinterpret_cast<char*>(this); }
+    char const *chars() const { return reinterpret_cast<char const*>(this); }
+
+    unsigned char tag() const { return static_cast<unsigned char>(chars()[capacity]); }
+
+    static std::size_t length(char const *text, std::size_t n) {
+      void const *end = std::memchr(text, '\0', n);
+      return end ? static_cast<std::size_t>(static_cast<char const*>(end) - text) : n;
+    }
+
+    void setStatic(char const *s, std::size_t n) {
+      ptr_ = s;
+      size_ = n;
+      // the tag is set with a whole word store; a lone byte store would make
+      // copying the message right afterwards stall on store forwarding.
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      tail_[TailWords - 1] = std::uint64_t(StaticTag) << 56;
+#else
+      tail_[TailWords - 1] = StaticTag;
+#endif
+    }
+
+    void setInlineSize(std::size_t n) {
+      chars()[n] = '\0';
+      chars()[capacity] = static_cast<char>(capacity - n);
+    }
+
+    void markTruncated() {
+      std::memcpy(chars() + capacity - 3, "...", 3);
+      setInlineSize(capacity);
+    }
+
+    // `n` must fit. The message is assembled a word at a time, which the
+    // compiler folds into a few stores of constants for a literal (where
+    // memcpy and then setting the tag would be byte stores that stall the
+    // copy that usually follows).
+    void assignWhole(char const *s, std::size_t n) {
+      std::uint64_t words[Size / sizeof(std::uint64_t)];
+      for (std::size_t i = 0; i < Size / sizeof(std::uint64_t); ++i) {
+        std::uint64_t w = 0;
+        for (std::size_t j = 0; j < sizeof(std::uint64_t) && i * sizeof(std::uint64_t) + j < n; ++j) {
+          w |= byteInWord(static_cast<unsigned char>(s[i * sizeof(std::uint64_t) + j]), j);
+        }
+        words[i] = w;
+      }
+      words[Size / sizeof(std::uint64_t) - 1] |= byteInWord(static_cast<unsigned char>(capacity - n), 7);
+      std::memcpy(chars(), words, Size);
+    }
+
+    static std::uint64_t byteInWord(unsigned char c, std::size_t j) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      return std::uint64_t(c) << (8 * j);
+#else
+      return std::uint64_t(c) << (8 * (7 - j));
+#endif
+    }
+
+    void assign(char const *s, std::size_t n) {
+      if (n > capacity) {
+        std::memcpy(chars(), s, capacity - 3);
+        markTruncated();
+      } else {
+        std::memcpy(chars(), s, n);
+        setInlineSize(n);
+      }
+    }
+
+    char const *ptr_;
+    std::size_t size_;
+    std::uint64_t tail_[TailWords];
+  };
+
+  template <std::size_t Size>
+  std::size_t const BasicErrorMessage<Size>::capacity;
+
+  template <std::size_t Size>
+  unsigned char const BasicErrorMessage<Size>::StaticTag;
+
+  template <std::size_t Size>
+  std::size_t const BasicErrorMessage<Size>::TailWords;
+
+  /// 24 bytes, with room for 23 characters inline.
+  typedef BasicErrorMessage<24> ErrorMessage;
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef FUNKY_INTERNED_ERROR_HH_INCLUDED
+#define FUNKY_INTERNED_ERROR_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/ErrorMessage.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace funky {
+
+  namespace detail {
+
+    /// One distinct error. Entries are never freed or moved, so an
+    /// InternedError can point at one for the life of the program.
+    struct InternedErrorEntry {
+      char const *text;
+      std::size_t size;
+      unsigned id;
+    };
+
+    enum CanonicalError {
+      CanonicalCancelled,
+      CanonicalInvalidArgument,
+      CanonicalTimedOut,
+      CanonicalNotFound,
+      CanonicalAlreadyExists,
+      CanonicalPermissionDenied,
+      CanonicalOutOfRange,
+      CanonicalUnavailable,
+      CanonicalErrorCount
+    };
+
+    // defined in src/InternedError.cc, and registered before anything else.
+    extern InternedErrorEntry const canonicalErrors[CanonicalErrorCount];
+
+  }
+
+  /// A handle to an error in a process-wide registry, for the Left of an
+  /// Either whose errors are one of a known set. It's a single pointer, so
+  /// it's as cheap to construct and copy as an int, and since every
+  /// distinct text is registered once, comparing two compares pointers.
+  ///
+  /// The canonical errors below are built in and cost nothing to make;
+  /// intern() registers (or finds) any other, and should be called once,
+  /// with the handle kept:
+  ///
+  ///     static InternedError const diskFull = InternedError::intern("disk full");
+  class InternedError {
+  public:
+    static InternedError cancelled() { return canonical(detail::CanonicalCancelled); }
+    static InternedError invalidArgument() { return canonical(detail::CanonicalInvalidArgument); }
+    static InternedError timedOut() { return canonical(detail::CanonicalTimedOut); }
+    static InternedError notFound() { return canonical(detail::CanonicalNotFound); }
+    static InternedError alreadyExists() { return canonical(detail::CanonicalAlreadyExists); }
+    static InternedError permissionDenied() { return canonical(detail::CanonicalPermissionDenied); }
+    static InternedError outOfRange() { return canonical(detail::CanonicalOutOfRange); }
+    static InternedError unavailable() { return canonical(detail::CanonicalUnavailable); }
+
+    /// The error with this text, registering it if it's new. Takes a lock,
+    /// and the first time, copies the text. Thread safe.
+    static InternedError intern(char const *s, std::size_t n);
+    static InternedError intern(char const *s) { return intern(s, std::strlen(s)); }
+    static InternedError intern(std::string const &s) { return intern(s.data(), s.size()); }
+
+    /// How many distinct errors are registered, canonical ones included.
+    static std::size_t registered();
+
+    /// A dense number for the error, less than registered(), for tables
+    /// indexed by error. The canonical errors are numbered first, in the
+    /// order above.
+    unsigned id() const { return entry_->id; }
+
+    char const *c_str() const { return entry_->text; }
+    std::size_t size() const { return entry_->size; }
+    std::string str() const { return std::string(entry_->text, entry_->size); }
+
+    /// The text as an ErrorMessage, referring to it rather than copying.
+    ErrorMessage message() const { return ErrorMessage::fromStatic(entry_->text, entry_->size); }
+
+    bool operator==(InternedError const &o) const { return entry_ == o.entry_; }
+    bool operator!=(InternedError const &o) const { return entry_ != o.entry_; }
+
+  private:
+    explicit InternedError(detail::InternedErrorEntry const *entry) : entry_(entry) {}
+
+    static InternedError canonical(detail::CanonicalError e) {
+      return InternedError(&detail::canonicalErrors[e]);
+    }
+
+    detail::InternedErrorEntry const *entry_;
+  };
+
+}
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef FUNKY_LAZY_ERROR_HH_INCLUDED
+#define FUNKY_LAZY_ERROR_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+
+#include <cstddef>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <type_traits>
+
+namespace funky {
+
+  /// An error whose message is formatted only when someone asks for it.
+  ///
+  /// It captures a printf-style format string and a copy of the arguments,
+  /// which have to be numbers, enums or pointers and fit in ArgBytes, and
+  /// renders them with snprintf in message() or render(). Creating, copying and
+  /// dropping one costs a few word stores, so errors that are checked and
+  /// discarded never pay for formatting.
+
+  namespace detail {
+
+    /// The captured arguments, as a trivially copyable aggregate. Arrays
+    /// (string literals, mostly) are stored as pointers.
+    template <class... Ts>
+    struct ArgPack;
+
+    template <>
+    struct ArgPack<> {};
+
+    template <class T>
+    struct ArgPack<T> {
+      T head;
+    };
+
+    template <class T, class U, class... Ts>
+    struct ArgPack<T, U, Ts...> {
+      T head;
+      ArgPack<U, Ts...> tail;
+    };
+
+    inline ArgPack<> packArgs() { return ArgPack<>{}; }
+
+    template <class T, bool = std::is_enum<T>::value>
+    struct Promoted {
+      typedef T type;
+    };
+
+    template <class T>
+    struct Promoted<T, true> : std::underlying_type<T> {};
+
+    /// How an argument is stored: arrays as pointers, and enums (which
+    /// printf knows nothing of) as their underlying type.
+    template <class T>
+    struct Captured : Promoted<typename std::decay<T const>::type> {};
+
+    template <class T>
+    ArgPack<typename Captured<T>::type> packArgs(T const &head) {
+      return {static_cast<typename Captured<T>::type>(head)};
+    }
+
+    template <class T, class U, class... Ts>
+    ArgPack<typename Captured<T>::type, typename Captured<U>::type, typename Captured<Ts>::type...>
+    packArgs(T const &head, U const &next, Ts const &... tail) {
+      return {static_cast<typename Captured<T>::type>(head), packArgs(next, tail...)};
+    }
+
+    /// What printf reads an argument as, after the default promotions.
+    /// Integers of up to an int's size are read as int, and the bigger
+    /// ones as long (which is also how long long and size_t are read on
+    /// the LP64 systems funky builds on). long double isn't taken: it's
+    /// more aligned than the argument storage.
+    enum class FormatArg : char { Int, Long, Double, String, Pointer, Other };
+
+    template <class T>
+    struct FormatArgOf
+      : std::integral_constant<
+          FormatArg,
+          std::is_integral<T>::value ? (sizeof(T) <= sizeof(int) ? FormatArg::Int : FormatArg::Long)
+          : std::is_same<T, long double>::value ? FormatArg::Other
+          : std::is_floating_point<T>::value ? FormatArg::Double
+          : std::is_same<T, char const *>::value || std::is_same<T, char *>::value ? FormatArg::String
+          : std::is_pointer<T>::value ? FormatArg::Pointer
+          : FormatArg::Other> {};
+
+    template <class... Ts>
+    struct AllFormattable;
+
+    template <>
+    struct AllFormattable<> : std::true_type {};
+
+    template <class T, class... Ts>
+    struct AllFormattable<T, Ts...>
+      : std::integral_constant<bool, FormatArgOf<T>::value != FormatArg::Other && AllFormattable<Ts...>::value> {};
+
+    // Whether a printf format takes exactly the `n` arguments `args`: one
+    // per conversion, of a kind that conversion reads, and an int for each
+    // `*` width or precision. Recursive, to be constexpr in C++11; the
+    // recursion is all tail calls, so it's a loop at run time.
+    constexpr bool formatMatches(char const *f, FormatArg const *args, std::size_t n);
+
+    // `length` is 'l' after an l, ll, j, z or t modifier and 'L' after an L,
+    // which nothing matches, as there are no long double arguments.
+    constexpr bool conversionReads(char c, char length, FormatArg a) {
+      return c == 'd' || c == 'i' || c == 'u' || c == 'o' || c == 'x' || c == 'X'
+               ? a == (length == 'l' ? FormatArg::Long : FormatArg::Int)
+           : c == 'c' ? a == FormatArg::Int
+           : c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G' || c == 'a' || c == 'A'
+               ? length != 'L' && a == FormatArg::Double
+           : c == 's' ? a == FormatArg::String
+           : c == 'p' ? a == FormatArg::String || a == FormatArg::Pointer
+           : false;
+    }
+
+    constexpr bool isFlagWidthOrPrecision(char c) {
+      return c == '-' || c == '+' || c == ' ' || c == '#' || c == '.' || c == 'h' || (c >= '0' && c <= '9');
+    }
+
+    // in a conversion specification, after its '%'.
+    constexpr bool specMatches(char const *s, char length, FormatArg const *args, std::size_t n) {
+      return n == 0 ? false
+           : *s == '*' ? args[0] == FormatArg::Int && specMatches(s + 1, length, args + 1, n - 1)
+           : *s == 'l' || *s == 'j' || *s == 'z' || *s == 't' ? specMatches(s + 1, 'l', args, n)
+           : *s == 'L' ? specMatches(s + 1, 'L', args, n)
+           : isFlagWidthOrPrecision(*s) ? specMatches(s + 1, length, args, n)
+           : conversionReads(*s, length, args[0]) && formatMatches(s + 1, args + 1, n - 1);
+    }
+
+    constexpr bool formatMatches(char const *f, FormatArg const *args, std::size_t n) {
+      return *f == '\0' ? n == 0
+           : *f != '%' ? formatMatches(f + 1, args, n)
+           : f[1] == '%' ? formatMatches(f + 2, args, n)
+           : specMatches(f + 1, 0, args, n);
+    }
+
+#if defined(__cpp_consteval)
+    // not constexpr, so calling it from a consteval function doesn't compile.
+    inline void lazyErrorFormatDoesNotMatchItsArguments() {}
+#endif
+
+    /// A LazyError's format string, which from C++20 on is checked against
+    /// the arguments at compile time. Before that, render() checks it.
+    template <class... Ts>
+    struct LazyFormat {
+#if defined(__cpp_consteval)
+      template <std::size_t N>
+      consteval LazyFormat(char const (&f)[N]) : format(f) {
+        FormatArg const args[] = {FormatArgOf<Ts>::value..., FormatArg::Other};
+        if (!formatMatches(f, args, sizeof...(Ts))) {
+          lazyErrorFormatDoesNotMatchItsArguments();
+        }
+      }
+#else
+      template <std::size_t N>
+      LazyFormat(char const (&f)[N]) : format(f) {}
+#endif
+
+      char const *format;
+    };
+
+    template <class T>
+    struct Nondeduced {
+      typedef T type;
+    };
+
+    struct Snprintf {
+      char *out;
+      std::size_t size;
+      char const *format;
+
+      template <class... As>
+      int operator()(As... as) const {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-security"
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+        return std::snprintf(out, size, format, as...);
+#pragma GCC diagnostic pop
+      }
+    };
+
+    // Unpack the arguments onto the end of `done`, then call fn with them.
+    // The last one is stored without an empty tail, which would pad the pack.
+    template <class... Done>
+    int unpackArgs(ArgPack<> const &, Snprintf fn, Done... done) {
+      return fn(done...);
+    }
+
+    template <class T, class... Done>
+    int unpackArgs(ArgPack<T> const &p, Snprintf fn, Done... done) {
+      return fn(done..., p.head);
+    }
+
+    template <class T, class U, class... Ts, class... Done>
+    int unpackArgs(ArgPack<T, U, Ts...> const &p, Snprintf fn, Done... done) {
+      return unpackArgs(p.tail, fn, done..., p.head);
+    }
+
+    template <class... Ts>
+    int renderLazy(void const *args, char const *format, char *out, std::size_t size) {
+#if !defined(__cpp_consteval) && FUNKY_CHECK_LEVEL >= FUNKY_CHECK_CHEAP
+      FormatArg const kinds[] = {FormatArgOf<Ts>::value..., FormatArg::Other};
+      FUNKY_CHECK(formatMatches(format, kinds, sizeof...(Ts)));
+#endif
+      return unpackArgs(*static_cast<ArgPack<Ts...> const*>(args), Snprintf{out, size, format});
+    }
+
+  }
+
+  template <std::size_t ArgBytes>
+  class BasicLazyError {
+  public:
+    /// Capture `format` (a literal, since it's kept by pointer) and copies of
+    /// `args`, which must be numbers, enums or pointers, as the format
+    /// expects. Pointer arguments, like strings for `%s`, have to outlive
+    /// the error.
+    template <class... Args>
+    BasicLazyError(typename detail::Nondeduced<detail::LazyFormat<typename detail::Captured<Args>::type...>>::type format,
+                   Args const &... args)
+      : format_(format.format)
+      , render_(&detail::renderLazy<typename detail::Captured<Args>::type...>)
+      , args_() {
+      typedef detail::ArgPack<typename detail::Captured<Args>::type...> Pack;
+      static_assert(detail::AllFormattable<typename detail::Captured<Args>::type...>::value,
+                    "LazyError arguments must be numbers other than long double, enums or pointers");
+      static_assert(sizeof(Pack) <= ArgBytes, "LazyError arguments don't fit; use a bigger BasicLazyError");
+      static_assert(alignof(Pack) <= alignof(Storage), "LazyError arguments are over-aligned");
+      new (&args_) Pack(detail::packArgs(args...));
+    }
+
+    /// A mutable array isn't a literal, and could change before rendering.
+    template <std::size_t N, class... Args>
+    BasicLazyError(char (&format)[N], Args const &... args) = delete;
+
+    /// The format string, which identifies the kind of error without
+    /// rendering it.
+    char const *format() const { return format_; }
+
+    /// snprintf the message into `out`, returning the length of the whole
+    /// message (which is more than fits if that's `size` or greater).
+    std::size_t render(char *out, std::size_t size) const {
+      int const n = render_(&args_, format_, out, size);
+      return n < 0 ? 0 : static_cast<std::size_t>(n);
+    }
+
+    /// The formatted message.
+    std::string message() const {
+      char buffer[256];
+      std::size_t const n = render(buffer, sizeof(buffer));
+      if (n < sizeof(buffer)) {
+        return std::string(buffer, n);
+      }
+      std::string s(n + 1, '\0');
+      render(&s[0], n + 1);
+      s.resize(n);
+      return s;
+    }
+
+  private:
+    typedef typename std::aligned_storage<ArgBytes, alignof(double)>::type Storage;
+
+    char const *format_;
+    int (*render_)(void const *args, char const *format, char *out, std::size_t size);
+    Storage args_;
+  };
+
+  /// 40 bytes, with room for three 8-byte arguments.
+  typedef BasicLazyError<24> LazyError;
+
+}
+
+#endif
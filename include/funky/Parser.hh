@@ -0,0 +1,582 @@
+#ifndef FUNKY_PARSER_HH_INCLUDED
+#define FUNKY_PARSER_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace funky {
+
+  /// Parser combinators over a borrowed `(char const *, std::size_t)` view.
+  ///
+  /// A parser is a small function object with a `Value` typedef and
+  ///
+  ///     ParseResult<Value> operator()(ParseInput in) const;
+  ///
+  /// which either fails with a ParseError or returns the parsed value together
+  /// with the rest of the input. The primitives match characters, literals,
+  /// runs of characters and integers; the combinators build bigger parsers out
+  /// of smaller ones. Every parser is its own type, so a whole grammar is one
+  /// type the compiler can inline. Nothing allocates: text comes back as views
+  /// into the input, and repetition folds into an accumulator instead of
+  /// collecting into a container.
+
+  /// A view of the input that hasn't been parsed yet. It doesn't own the text.
+  struct ParseInput {
+    ParseInput() : data(nullptr), size(0) {}
+    ParseInput(char const *data, std::size_t size) : data(data), size(size) {}
+
+    bool empty() const { return size == 0; }
+    char front() const { FUNKY_CHECK(size != 0); return *data; }
+
+    /// The view without its first `n` characters.
+    ParseInput advance(std::size_t n) const { FUNKY_CHECK(n <= size); return ParseInput{data + n, size - n}; }
+
+    /// The first `n` characters.
+    ParseInput take(std::size_t n) const { FUNKY_CHECK(n <= size); return ParseInput{data, n}; }
+
+    char const *data;
+    std::size_t size;
+  };
+
+  /// Where parsing failed and what was expected there. `expected` is a
+  /// string with static storage duration, so errors never allocate.
+  struct ParseError {
+    char const *position;
+    char const *expected;
+
+    bool operator==(ParseError const &o) const {
+      return position == o.position && std::strcmp(expected, o.expected) == 0;
+    }
+    bool operator!=(ParseError const &o) const { return !(*this == o); }
+  };
+
+  template <class T>
+  using ParseResult = Either<ParseError, std::pair<T, ParseInput>>;
+
+  /// The value of parsers that only recognize something, like endOfInput().
+  struct Unit {
+    bool operator==(Unit) const { return true; }
+    bool operator!=(Unit) const { return false; }
+  };
+
+  namespace detail {
+
+    template <class T>
+    ParseResult<typename std::decay<T>::type> parsed(T &&value, ParseInput rest) {
+      return ParseResult<typename std::decay<T>::type>{EmplaceRight, std::forward<T>(value), rest};
+    }
+
+    // "'c'" for every char c, so character() errors can name the character
+    // without allocating.
+    template <unsigned... I>
+    struct CharNames {
+      static constexpr char names[sizeof...(I)][4] = {{'\'', static_cast<char>(I), '\'', '\0'}...};
+    };
+
+    template <unsigned... I>
+    constexpr char CharNames<I...>::names[sizeof...(I)][4];
+
+    template <unsigned N, unsigned... I>
+    struct MakeCharNames : MakeCharNames<N - 1, N - 1, I...> {};
+
+    template <unsigned... I>
+    struct MakeCharNames<0, I...> {
+      typedef CharNames<I...> type;
+    };
+
+    inline char const *charName(char c) {
+      return MakeCharNames<256>::type::names[static_cast<unsigned char>(c)];
+    }
+
+    // whether a parser that failed with `e` on `in` consumed any input first.
+    // Repetition and option() only stop quietly on failures that didn't.
+    inline bool consumed(ParseError const &e, ParseInput in) {
+      return e.position != in.data;
+    }
+
+  }
+
+  /// Run `p` on `[data, data + size)`.
+  template <class P>
+  ParseResult<typename P::Value> parse(P const &p, char const *data, std::size_t size) {
+    return p(ParseInput{data, size});
+  }
+
+  // ------------------------------------------------------------------------
+  // primitives
+
+  class CharParser {
+  public:
+    typedef char Value;
+
+    explicit CharParser(char c) : c_(c) {}
+
+    ParseResult<char> operator()(ParseInput in) const {
+      if (!in.empty() && in.front() == c_) {
+        return detail::parsed(c_, in.advance(1));
+      }
+      return ParseError{in.data, detail::charName(c_)};
+    }
+
+  private:
+    char c_;
+  };
+
+  /// Match the character `c`.
+  inline CharParser character(char c) { return CharParser{c}; }
+
+
+  template <class Pred>
+  class SatisfyParser {
+  public:
+    typedef char Value;
+
+    SatisfyParser(Pred pred, char const *expected) : pred_(pred), expected_(expected) {}
+
+    ParseResult<char> operator()(ParseInput in) const {
+      if (!in.empty() && pred_(in.front())) {
+        return detail::parsed(in.front(), in.advance(1));
+      }
+      return ParseError{in.data, expected_};
+    }
+
+  private:
+    Pred pred_;
+    char const *expected_;
+  };
+
+  /// Match one character for which `pred(c)` is true.
+  template <class Pred>
+  SatisfyParser<Pred> satisfy(Pred pred, char const *expected) {
+    return SatisfyParser<Pred>{pred, expected};
+  }
+
+
+  class LiteralParser {
+  public:
+    typedef ParseInput Value;
+
+    LiteralParser(char const *s, std::size_t n) : s_(s), n_(n) {}
+
+    ParseResult<ParseInput> operator()(ParseInput in) const {
+      if (in.size >= n_ && std::memcmp(in.data, s_, n_) == 0) {
+        return detail::parsed(in.take(n_), in.advance(n_));
+      }
+      return ParseError{in.data, s_};
+    }
+
+  private:
+    char const *s_;
+    std::size_t n_;
+  };
+
+  /// Match the string literal `s` exactly, giving a view of the match.
+  template <std::size_t N>
+  LiteralParser literal(char const (&s)[N]) {
+    return LiteralParser{s, N - 1};
+  }
+
+
+  template <class Pred>
+  class TakeWhileParser {
+  public:
+    typedef ParseInput Value;
+
+    TakeWhileParser(Pred pred, std::size_t min, char const *expected)
+      : pred_(pred), min_(min), expected_(expected) {}
+
+    ParseResult<ParseInput> operator()(ParseInput in) const {
+      std::size_t n = 0;
+      while (n < in.size && pred_(in.data[n])) {
+        ++n;
+      }
+      if (n < min_) {
+        return ParseError{in.data + n, expected_};
+      }
+      return detail::parsed(in.take(n), in.advance(n));
+    }
+
+  private:
+    Pred pred_;
+    std::size_t min_;
+    char const *expected_;
+  };
+
+  /// The longest run of characters for which `pred(c)` is true, possibly
+  /// empty, as a view into the input.
+  template <class Pred>
+  TakeWhileParser<Pred> takeWhile(Pred pred) {
+    return TakeWhileParser<Pred>{pred, 0, ""};
+  }
+
+  /// Like takeWhile(), but fails unless the run is at least one character.
+  template <class Pred>
+  TakeWhileParser<Pred> takeWhile1(Pred pred, char const *expected) {
+    return TakeWhileParser<Pred>{pred, 1, expected};
+  }
+
+
+  template <class T>
+  class IntegerParser {
+    static_assert(std::is_integral<T>::value, "integer<T>() needs an integral T");
+
+  public:
+    typedef T Value;
+
+    ParseResult<T> operator()(ParseInput in) const {
+      typedef typename std::make_unsigned<T>::type U;
+      std::size_t i = 0;
+      bool const negative = std::is_signed<T>::value && in.size != 0 && in.data[0] == '-';
+      if (negative) {
+        ++i;
+      }
+      std::size_t const firstDigit = i;
+      U v = 0;
+      for (; i < in.size; ++i) {
+        unsigned const d = static_cast<unsigned char>(in.data[i]) - static_cast<unsigned>('0');
+        if (d > 9) {
+          break;
+        }
+        if (__builtin_mul_overflow(v, U(10), &v) || __builtin_add_overflow(v, U(d), &v)) {
+          return ParseError{in.data, "integer in range"};
+        }
+      }
+      if (i == firstDigit) {
+        return ParseError{in.data + i, "digit"};
+      }
+      U const limit = static_cast<U>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+      if (v > limit) {
+        return ParseError{in.data, "integer in range"};
+      }
+      // -v computed in U, so the most negative T doesn't overflow.
+      T const value = negative ? static_cast<T>(U(0) - v) : static_cast<T>(v);
+      return detail::parsed(value, in.advance(i));
+    }
+  };
+
+  /// A decimal integer, with a leading '-' if T is signed. Out of range
+  /// values are an error.
+  template <class T>
+  IntegerParser<T> integer() { return IntegerParser<T>{}; }
+
+
+  class EndParser {
+  public:
+    typedef Unit Value;
+
+    ParseResult<Unit> operator()(ParseInput in) const {
+      if (in.empty()) {
+        return detail::parsed(Unit{}, in);
+      }
+      return ParseError{in.data, "end of input"};
+    }
+  };
+
+  /// Succeed only when there is no input left.
+  inline EndParser endOfInput() { return EndParser{}; }
+
+  // ------------------------------------------------------------------------
+  // combinators
+
+  template <class... Ps>
+  class SequenceParser;
+
+  template <class P>
+  class SequenceParser<P> {
+  public:
+    typedef std::tuple<typename P::Value> Value;
+
+    explicit SequenceParser(P p) : p_(p) {}
+
+    ParseResult<Value> operator()(ParseInput in) const {
+      ParseResult<typename P::Value> r = p_(in);
+      if (r.isLeft()) {
+        return r.left();
+      }
+      return detail::parsed(Value{std::move(r.right().first)}, r.right().second);
+    }
+
+  private:
+    P p_;
+  };
+
+  template <class P, class Q, class... Ps>
+  class SequenceParser<P, Q, Ps...> {
+    typedef SequenceParser<Q, Ps...> Tail;
+
+  public:
+    typedef decltype(std::tuple_cat(std::declval<std::tuple<typename P::Value>>(),
+                                    std::declval<typename Tail::Value>())) Value;
+
+    SequenceParser(P p, Q q, Ps... ps) : p_(p), tail_(q, ps...) {}
+
+    ParseResult<Value> operator()(ParseInput in) const {
+      ParseResult<typename P::Value> head = p_(in);
+      if (head.isLeft()) {
+        return head.left();
+      }
+      ParseResult<typename Tail::Value> tail = tail_(head.right().second);
+      if (tail.isLeft()) {
+        return tail.left();
+      }
+      return detail::parsed(std::tuple_cat(std::tuple<typename P::Value>{std::move(head.right().first)},
+                                           std::move(tail.right().first)),
+                            tail.right().second);
+    }
+
+  private:
+    P p_;
+    Tail tail_;
+  };
+
+  /// Run each parser on what the previous one left, giving a tuple of their
+  /// values. Fails with the first failure.
+  template <class... Ps>
+  SequenceParser<Ps...> sequence(Ps... ps) {
+    return SequenceParser<Ps...>{ps...};
+  }
+
+
+  template <class P, class Q, bool KeepFirst>
+  class KeepParser {
+  public:
+    typedef typename std::conditional<KeepFirst, typename P::Value, typename Q::Value>::type Value;
+
+    KeepParser(P p, Q q) : p_(p), q_(q) {}
+
+    ParseResult<Value> operator()(ParseInput in) const {
+      ParseResult<typename P::Value> a = p_(in);
+      if (a.isLeft()) {
+        return a.left();
+      }
+      ParseResult<typename Q::Value> b = q_(a.right().second);
+      if (b.isLeft()) {
+        return b.left();
+      }
+      return detail::parsed(std::move(pick(a.right().first, b.right().first, std::integral_constant<bool, KeepFirst>{})),
+                            b.right().second);
+    }
+
+  private:
+    template <class A, class B>
+    static A &pick(A &a, B &, std::true_type) { return a; }
+    template <class A, class B>
+    static B &pick(A &, B &b, std::false_type) { return b; }
+
+    P p_;
+    Q q_;
+  };
+
+  /// Run `p` then `q`, and keep only `p`'s value.
+  template <class P, class Q>
+  KeepParser<P, Q, true> keepFirst(P p, Q q) { return KeepParser<P, Q, true>{p, q}; }
+
+  /// Run `p` then `q`, and keep only `q`'s value.
+  template <class P, class Q>
+  KeepParser<P, Q, false> keepSecond(P p, Q q) { return KeepParser<P, Q, false>{p, q}; }
+
+
+  template <class... Ps>
+  class AlternativeParser;
+
+  template <class P>
+  class AlternativeParser<P> {
+  public:
+    typedef typename P::Value Value;
+
+    explicit AlternativeParser(P p) : p_(p) {}
+
+    ParseResult<Value> operator()(ParseInput in) const { return p_(in); }
+
+  private:
+    P p_;
+  };
+
+  template <class P, class Q, class... Ps>
+  class AlternativeParser<P, Q, Ps...> {
+    typedef AlternativeParser<Q, Ps...> Tail;
+
+    static_assert(std::is_same<typename P::Value, typename Tail::Value>::value,
+                  "alternative() needs parsers with the same Value");
+
+  public:
+    typedef typename P::Value Value;
+
+    AlternativeParser(P p, Q q, Ps... ps) : p_(p), tail_(q, ps...) {}
+
+    ParseResult<Value> operator()(ParseInput in) const {
+      ParseResult<Value> first = p_(in);
+      if (first.isRight()) {
+        return first;
+      }
+      ParseResult<Value> rest = tail_(in);
+      if (rest.isRight() || rest.left().position > first.left().position) {
+        return rest;
+      }
+      return first;
+    }
+
+  private:
+    P p_;
+    Tail tail_;
+  };
+
+  /// Try each parser on the same input, and give the value of the first one
+  /// that succeeds. If they all fail, the error is the one that got furthest.
+  template <class... Ps>
+  AlternativeParser<Ps...> alternative(Ps... ps) {
+    return AlternativeParser<Ps...>{ps...};
+  }
+
+
+  template <class P, class Fn>
+  class MapParser {
+  public:
+    typedef typename std::decay<decltype(std::declval<Fn const&>()(std::declval<typename P::Value>()))>::type Value;
+
+    MapParser(P p, Fn fn) : p_(p), fn_(fn) {}
+
+    ParseResult<Value> operator()(ParseInput in) const {
+      ParseResult<typename P::Value> r = p_(in);
+      if (r.isLeft()) {
+        return r.left();
+      }
+      return detail::parsed(fn_(std::move(r.right().first)), r.right().second);
+    }
+
+  private:
+    P p_;
+    Fn fn_;
+  };
+
+  /// Parse with `p` and give `fn(value)` instead.
+  template <class P, class Fn>
+  MapParser<P, Fn> fmap(P p, Fn fn) { return MapParser<P, Fn>{p, fn}; }
+
+
+  template <class P>
+  class OptionParser {
+  public:
+    typedef typename P::Value Value;
+
+    OptionParser(P p, Value fallback) : p_(p), fallback_(fallback) {}
+
+    ParseResult<Value> operator()(ParseInput in) const {
+      ParseResult<Value> r = p_(in);
+      if (r.isLeft() && !detail::consumed(r.left(), in)) {
+        return detail::parsed(fallback_, in);
+      }
+      return r;
+    }
+
+  private:
+    P p_;
+    Value fallback_;
+  };
+
+  /// Parse with `p`, or give `fallback` without consuming anything if `p`
+  /// fails at the start of the input. Failures further in are still errors.
+  template <class P>
+  OptionParser<P> option(P p, typename P::Value fallback) { return OptionParser<P>{p, fallback}; }
+
+
+  template <class P, class Sep, class Acc, class Fn>
+  class ManyParser {
+  public:
+    typedef Acc Value;
+
+    ManyParser(P p, Sep sep, std::size_t min, Acc init, Fn fn)
+      : p_(p), sep_(sep), min_(min), init_(init), fn_(fn) {}
+
+    ParseResult<Acc> operator()(ParseInput in) const {
+      Acc acc(init_);
+      std::size_t n = 0;
+      for (;;) {
+        ParseInput item = in;
+        if (n != 0) {
+          ParseResult<typename Sep::Value> s = sep_(in);
+          if (s.isLeft()) {
+            if (detail::consumed(s.left(), in)) {
+              return s.left();
+            }
+            break;
+          }
+          item = s.right().second;
+        }
+        ParseResult<typename P::Value> r = p_(item);
+        if (r.isLeft()) {
+          // after a separator, an item is required.
+          if (detail::consumed(r.left(), item) || item.data != in.data) {
+            return r.left();
+          }
+          break;
+        }
+        fn_(acc, std::move(r.right().first));
+        ++n;
+        if (r.right().second.data == in.data) {
+          break; // matched nothing; repeating would never end
+        }
+        in = r.right().second;
+      }
+      if (n < min_) {
+        return ParseError{in.data, "at least one item"};
+      }
+      return detail::parsed(std::move(acc), in);
+    }
+
+  private:
+    P p_;
+    Sep sep_;
+    std::size_t min_;
+    Acc init_;
+    Fn fn_;
+  };
+
+  /// Matches nothing; the separator used by many().
+  class EmptyParser {
+  public:
+    typedef Unit Value;
+    ParseResult<Unit> operator()(ParseInput in) const { return detail::parsed(Unit{}, in); }
+  };
+
+  /// Parse `p` as many times as it matches, calling `fn(acc, value)` on a
+  /// copy of `init` with each value, and give the accumulator. Repetition
+  /// stops at the first failure that consumed no input; any other failure is
+  /// an error.
+  template <class P, class Acc, class Fn>
+  ManyParser<P, EmptyParser, Acc, Fn> many(P p, Acc init, Fn fn) {
+    return ManyParser<P, EmptyParser, Acc, Fn>{p, EmptyParser{}, 0, init, fn};
+  }
+
+  /// Like many(), but `p` has to match at least once.
+  template <class P, class Acc, class Fn>
+  ManyParser<P, EmptyParser, Acc, Fn> many1(P p, Acc init, Fn fn) {
+    return ManyParser<P, EmptyParser, Acc, Fn>{p, EmptyParser{}, 1, init, fn};
+  }
+
+  /// Like many(), for items separated by `sep`. An item must follow every
+  /// separator.
+  template <class P, class Sep, class Acc, class Fn>
+  ManyParser<P, Sep, Acc, Fn> sepBy(P p, Sep sep, Acc init, Fn fn) {
+    return ManyParser<P, Sep, Acc, Fn>{p, sep, 0, init, fn};
+  }
+
+  /// Like sepBy(), but `p` has to match at least once.
+  template <class P, class Sep, class Acc, class Fn>
+  ManyParser<P, Sep, Acc, Fn> sepBy1(P p, Sep sep, Acc init, Fn fn) {
+    return ManyParser<P, Sep, Acc, Fn>{p, sep, 1, init, fn};
+  }
+
+}
+
+#endif
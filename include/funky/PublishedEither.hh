@@ -0,0 +1,84 @@
+#ifndef FUNKY_PUBLISHED_EITHER_HH_INCLUDED
+#define FUNKY_PUBLISHED_EITHER_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/AtomicEither.hh"
+#include "funky/Either.hh"
+
+#include <mutex>
+#include <utility>
+
+namespace funky {
+
+  /// An Either of trivially copyable sides, too big for an AtomicEither to
+  /// be lock-free, that a few threads change and many read. Writers change
+  /// their own copy in place, with set() or update(), and then publish it
+  /// behind a seqlock; readers copy out the last one published, and retry
+  /// if a writer was publishing meanwhile. Readers never block and never
+  /// write to memory another thread reads.
+  ///
+  /// The seqlock doesn't guard the Either itself: a reader's plain reads
+  /// of it would race with a writer's in-place changes. Writers pack their
+  /// copy into atomic words instead, and a load() copies those out a word
+  /// at a time, then unpacks them into the Either. So a read costs about
+  /// 5-10x a plain copy of the Either (see PublishedEither/Load/ in
+  /// bench/PublishedEither.cc), still linear in its size.
+  template <class LeftT, class RightT>
+  class PublishedEither {
+    typedef detail::AtomicEitherCodec<LeftT, RightT> Codec;
+    typedef detail::AtomicEitherSeqLock<(Codec::size + 7) / 8> Words;
+
+  public:
+    typedef Either<LeftT, RightT> Value;
+
+    explicit PublishedEither(Value const &initial) : writers_(), current_(initial), words_() { publish(); }
+
+    PublishedEither(PublishedEither const &) = delete;
+    PublishedEither &operator=(PublishedEither const &) = delete;
+
+    /// A copy of the last Either published.
+    Value load() const {
+      unsigned char bytes[Words::size];
+      words_.load(bytes);
+      return Codec::unpack(bytes);
+    }
+
+    /// Set the writers' copy, as Either::set() does, and publish it.
+    template <class V>
+    void set(V &&v) {
+      std::lock_guard<std::mutex> lock{writers_};
+      current_.set(std::forward<V>(v));
+      publish();
+    }
+
+    /// Call fn with the writers' copy, to change in place, and publish it.
+    /// Other writers wait until it's done; readers don't.
+    template <class Fn>
+    void update(Fn &&fn) {
+      std::lock_guard<std::mutex> lock{writers_};
+      std::forward<Fn>(fn)(current_);
+      publish();
+    }
+
+  private:
+    // with writers_ held, so the seqlock's own lock is never contended.
+    void publish() {
+      unsigned char bytes[Words::size] = {};
+      Codec::pack(bytes, current_);
+      std::uint64_t const s = words_.lock();
+      words_.write(bytes);
+      words_.unlock(s + 2);
+    }
+
+    std::mutex writers_;
+    Value current_;
+    // on lines of its own, so readers don't share them with what writers
+    // change before publishing.
+    alignas(64) Words words_;
+  };
+
+}
+
+#endif
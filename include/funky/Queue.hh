@@ -0,0 +1,481 @@
+#ifndef FUNKY_QUEUE_HH_INCLUDED
+#define FUNKY_QUEUE_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace funky {
+
+  /// Bounded lock-free ring queues for handing values (typically
+  /// `Either<Error, Result>`s) between threads.
+  ///
+  /// - SpscQueue<T>: one producer thread, one consumer thread.
+  /// - MpmcQueue<T>: any number of each.
+  ///
+  /// Values are moved in (or emplaced) and moved out (or consumed in place),
+  /// never copied. Both queues support batches, which amortize the
+  /// synchronization over several values. Capacity is rounded up to a power of
+  /// two and fixed at construction; a full queue rejects pushes rather than
+  /// blocking or allocating.
+
+  namespace detail {
+
+    std::size_t const CacheLine = 64;
+
+    inline std::size_t roundUpToPowerOfTwo(std::size_t n) {
+      std::size_t p = 1;
+      while (p < n) {
+        p <<= 1;
+      }
+      return p;
+    }
+
+    /// Array of n default-constructed Ts, aligned to alignof(T). `new T[n]`
+    /// doesn't honor over-alignment before C++17. T's default constructor
+    /// must not throw.
+    template <class T>
+    class AlignedArray {
+    public:
+      explicit AlignedArray(std::size_t n)
+        : raw_(::operator new(n * sizeof(T) + alignof(T)))
+        , data_(reinterpret_cast<T*>((reinterpret_cast<std::uintptr_t>(raw_) + alignof(T) - 1) &
+                                     ~std::uintptr_t(alignof(T) - 1)))
+        , size_(n) {
+        static_assert(std::is_nothrow_default_constructible<T>::value, "AlignedArray can't undo a throwing constructor");
+        for (std::size_t i = 0; i < n; ++i) {
+          new (data_ + i) T;
+        }
+      }
+
+      ~AlignedArray() {
+        for (std::size_t i = 0; i < size_; ++i) {
+          data_[i].~T();
+        }
+        ::operator delete(raw_);
+      }
+
+      AlignedArray(AlignedArray const &) = delete;
+      AlignedArray &operator=(AlignedArray const &) = delete;
+
+      T &operator[](std::size_t i) const { return data_[i]; }
+
+    private:
+      void *raw_;
+      T *data_;
+      std::size_t size_;
+    };
+
+    /// Raw storage for one T, constructed and destroyed by hand.
+    template <class T>
+    struct Slot {
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+      T *get() { return reinterpret_cast<T*>(&storage); }
+
+      template <class... Args>
+      void construct(Args&&... args) { new (&storage) T(std::forward<Args>(args)...); }
+
+      void destroy() { get()->~T(); }
+    };
+
+    /// Destroys a Slot's value when it goes out of scope.
+    template <class T>
+    class SlotGuard {
+    public:
+      explicit SlotGuard(Slot<T> &slot) : slot_(slot) {}
+      ~SlotGuard() { slot_.destroy(); }
+
+      SlotGuard(SlotGuard const &) = delete;
+      SlotGuard &operator=(SlotGuard const &) = delete;
+
+    private:
+      Slot<T> &slot_;
+    };
+
+    /// The alignment that keeps a `size`-byte slot off cache-line boundaries:
+    /// `size` rounded up to a power of two, but no more than a line.
+    constexpr std::size_t lineAlignment(std::size_t size, std::size_t align = 1) {
+      return align >= size || align >= CacheLine ? align : lineAlignment(size, 2 * align);
+    }
+
+    /// A Slot aligned to its own (power of two) size, so that none straddles
+    /// two cache lines, and one bigger than a line starts on a line of its own.
+    template <class T>
+    struct alignas(lineAlignment(sizeof(T)) > alignof(T) ? lineAlignment(sizeof(T)) : alignof(T))
+    PackedSlot : Slot<T> {};
+
+  }
+
+
+  /// Single-producer single-consumer queue. push* may only be called from one
+  /// thread at a time, and pop*/consume* only from one (other) thread.
+  ///
+  /// Values are stored back to back, each in a slot rounded up to a power of
+  /// two bytes (or to whole cache lines) so that reading or writing one never
+  /// touches two lines; the producer and consumer indices live on their own
+  /// cache lines, and each side caches the other's index so that it
+  /// only touches the shared line when it appears to be full or empty.
+  template <class T>
+  class SpscQueue {
+  public:
+    explicit SpscQueue(std::size_t capacity)
+      : mask_(detail::roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity) - 1)
+      , slots_(mask_ + 1), head_(0), tailCache_(0), tail_(0), headCache_(0) {}
+
+    ~SpscQueue() {
+      std::size_t const tail = tail_.load(std::memory_order_relaxed);
+      for (std::size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i) {
+        slots_[i & mask_].destroy();
+      }
+    }
+
+    SpscQueue(SpscQueue const &) = delete;
+    SpscQueue &operator=(SpscQueue const &) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    /// Approximate unless called from the producer or consumer while the other is idle.
+    std::size_t sizeApprox() const {
+      return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    /// Construct a value at the back. Returns false if the queue is full.
+    template <class... Args>
+    bool tryEmplace(Args&&... args) {
+      std::size_t const tail = tail_.load(std::memory_order_relaxed);
+      if (tail - headCache_ > mask_) {
+        headCache_ = head_.load(std::memory_order_acquire);
+        if (tail - headCache_ > mask_) {
+          return false;
+        }
+      }
+      slots_[tail & mask_].construct(std::forward<Args>(args)...);
+      tail_.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool tryPush(T &&v) { return tryEmplace(std::move(v)); }
+    bool tryPush(T const &v) { return tryEmplace(v); }
+
+    /// Move up to n values from `items` into the queue, publishing them all at
+    /// once. Returns how many were pushed; the rest are left untouched. If a
+    /// move throws, the values moved in before it are published and the
+    /// exception propagates.
+    std::size_t tryPushBatch(T *items, std::size_t n) {
+      std::size_t const tail = tail_.load(std::memory_order_relaxed);
+      if (capacity() - (tail - headCache_) < n) {
+        headCache_ = head_.load(std::memory_order_acquire);
+      }
+      std::size_t const room = capacity() - (tail - headCache_);
+      std::size_t const count = n < room ? n : room;
+      std::size_t i = 0;
+      try {
+        for (; i < count; ++i) {
+          slots_[(tail + i) & mask_].construct(std::move(items[i]));
+        }
+      } catch (...) {
+        tail_.store(tail + i, std::memory_order_release);
+        throw;
+      }
+      if (count != 0) {
+        tail_.store(tail + count, std::memory_order_release);
+      }
+      return count;
+    }
+
+    /// Call fn(T&&) on the front value, in place, then remove it. Returns
+    /// false if the queue is empty.
+    template <class Fn>
+    bool tryConsume(Fn &&fn) {
+      std::size_t const head = head_.load(std::memory_order_relaxed);
+      if (head == tailCache_) {
+        tailCache_ = tail_.load(std::memory_order_acquire);
+        if (head == tailCache_) {
+          return false;
+        }
+      }
+      detail::Slot<T> &slot = slots_[head & mask_];
+      fn(std::move(*slot.get()));
+      slot.destroy();
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Move the front value into `out`. Returns false if the queue is empty.
+    bool tryPop(T &out) {
+      return tryConsume([&out](T &&v) { out = std::move(v); });
+    }
+
+    /// Move up to `max` values to `out` (an output iterator), releasing their
+    /// slots all at once. Returns how many were popped. If writing to `out`
+    /// throws, the values already written are released and the rest stay
+    /// queued, as with tryConsume.
+    template <class OutIt>
+    std::size_t tryPopBatch(OutIt out, std::size_t max) {
+      std::size_t const head = head_.load(std::memory_order_relaxed);
+      if (tailCache_ - head < max) {
+        tailCache_ = tail_.load(std::memory_order_acquire);
+      }
+      std::size_t const avail = tailCache_ - head;
+      std::size_t const count = max < avail ? max : avail;
+      std::size_t i = 0;
+      try {
+        while (i < count) {
+          detail::Slot<T> &slot = slots_[(head + i) & mask_];
+          *out = std::move(*slot.get());
+          slot.destroy();
+          ++i;
+          ++out;
+        }
+      } catch (...) {
+        head_.store(head + i, std::memory_order_release);
+        throw;
+      }
+      if (count != 0) {
+        head_.store(head + count, std::memory_order_release);
+      }
+      return count;
+    }
+
+  private:
+    std::size_t const mask_;
+    detail::AlignedArray<detail::PackedSlot<T>> slots_;
+
+    // consumer side
+    alignas(detail::CacheLine) std::atomic<std::size_t> head_;
+    std::size_t tailCache_;
+
+    // producer side
+    alignas(detail::CacheLine) std::atomic<std::size_t> tail_;
+    std::size_t headCache_;
+  };
+
+
+  /// Multi-producer multi-consumer queue (Vyukov's bounded queue).
+  ///
+  /// Each cell holds a sequence number next to its value and is padded to a
+  /// whole number of cache lines, so the sequence number, the Either's tag and
+  /// (for payloads up to about 48 bytes) its payload share one line, and
+  /// threads working on neighbouring cells never share one.
+  ///
+  /// Every other thread that reaches a cell waits for whoever claimed it, so
+  /// nothing that can throw runs while one is claimed: T's move constructor
+  /// must be noexcept, a value whose construction can throw is built before
+  /// its cell is claimed, and a fn that can throw is given the value after
+  /// it's been moved out of its cell.
+  template <class T>
+  class MpmcQueue {
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "MpmcQueue can't give back a cell whose value failed to move in");
+
+  public:
+    explicit MpmcQueue(std::size_t capacity)
+      : mask_(detail::roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity) - 1)
+      , cells_(mask_ + 1), enqueuePos_(0), dequeuePos_(0) {
+      for (std::size_t i = 0; i <= mask_; ++i) {
+        cells_[i].seq.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    ~MpmcQueue() {
+      std::size_t const end = enqueuePos_.load(std::memory_order_relaxed);
+      for (std::size_t i = dequeuePos_.load(std::memory_order_relaxed); i != end; ++i) {
+        cells_[i & mask_].value.destroy();
+      }
+    }
+
+    MpmcQueue(MpmcQueue const &) = delete;
+    MpmcQueue &operator=(MpmcQueue const &) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    std::size_t sizeApprox() const {
+      std::size_t const enq = enqueuePos_.load(std::memory_order_relaxed);
+      std::size_t const deq = dequeuePos_.load(std::memory_order_relaxed);
+      return enq > deq ? enq - deq : 0;
+    }
+
+    template <class... Args>
+    bool tryEmplace(Args&&... args) {
+      return emplace(std::integral_constant<bool, std::is_nothrow_constructible<T, Args&&...>::value>(),
+                     std::forward<Args>(args)...);
+    }
+
+    bool tryPush(T &&v) { return tryEmplace(std::move(v)); }
+    bool tryPush(T const &v) { return tryEmplace(v); }
+
+    /// Claim up to n consecutive free cells with a single CAS and move
+    /// `items` into them. Returns how many were pushed.
+    std::size_t tryPushBatch(T *items, std::size_t n) {
+      std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+      std::size_t count;
+      for (;;) {
+        count = 0;
+        while (count < n && count <= mask_ &&
+               cells_[(pos + count) & mask_].seq.load(std::memory_order_acquire) == pos + count) {
+          ++count;
+        }
+        if (count == 0) {
+          std::intptr_t const diff = std::intptr_t(cells_[pos & mask_].seq.load(std::memory_order_acquire)) -
+                                     std::intptr_t(pos);
+          if (diff < 0) {
+            return 0; // full
+          }
+          pos = enqueuePos_.load(std::memory_order_relaxed);
+          continue;
+        }
+        if (enqueuePos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      for (std::size_t i = 0; i < count; ++i) {
+        Cell &cell = cells_[(pos + i) & mask_];
+        cell.value.construct(std::move(items[i]));
+        cell.seq.store(pos + i + 1, std::memory_order_release);
+      }
+      return count;
+    }
+
+    template <class Fn>
+    bool tryConsume(Fn &&fn) {
+      return consume(std::integral_constant<bool, noexcept(fn(std::declval<T>()))>(), fn);
+    }
+
+    bool tryPop(T &out) {
+      return tryConsume([&out](T &&v) noexcept(std::is_nothrow_move_assignable<T>::value) {
+        out = std::move(v);
+      });
+    }
+
+    /// Claim up to `max` consecutive full cells with a single CAS and move
+    /// them to `out`. Returns how many were popped. If writing to `out`
+    /// throws, the values claimed but not yet written are destroyed, to free
+    /// their cells.
+    template <class OutIt>
+    std::size_t tryPopBatch(OutIt out, std::size_t max) {
+      std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+      std::size_t count;
+      for (;;) {
+        count = 0;
+        while (count < max && count <= mask_ &&
+               cells_[(pos + count) & mask_].seq.load(std::memory_order_acquire) == pos + count + 1) {
+          ++count;
+        }
+        if (count == 0) {
+          std::intptr_t const diff = std::intptr_t(cells_[pos & mask_].seq.load(std::memory_order_acquire)) -
+                                     std::intptr_t(pos + 1);
+          if (diff < 0) {
+            return 0; // empty
+          }
+          pos = dequeuePos_.load(std::memory_order_relaxed);
+          continue;
+        }
+        if (dequeuePos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      std::size_t i = 0;
+      try {
+        for (; i < count; ++i) {
+          *out = std::move(*cells_[(pos + i) & mask_].value.get());
+          ++out;
+          release(pos + i);
+        }
+      } catch (...) {
+        for (; i < count; ++i) {
+          release(pos + i);
+        }
+        throw;
+      }
+      return count;
+    }
+
+  private:
+    struct alignas(detail::CacheLine) Cell {
+      std::atomic<std::size_t> seq;
+      detail::Slot<T> value;
+    };
+
+    template <class... Args>
+    bool emplace(std::true_type, Args&&... args) {
+      std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+      for (;;) {
+        Cell &cell = cells_[pos & mask_];
+        std::size_t const seq = cell.seq.load(std::memory_order_acquire);
+        std::intptr_t const diff = std::intptr_t(seq) - std::intptr_t(pos);
+        if (diff == 0) {
+          if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            cell.value.construct(std::forward<Args>(args)...);
+            cell.seq.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false; // full
+        } else {
+          pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    template <class... Args>
+    bool emplace(std::false_type, Args&&... args) {
+      T v(std::forward<Args>(args)...);
+      return emplace(std::true_type(), std::move(v));
+    }
+
+    template <class Fn>
+    bool consume(std::true_type, Fn &fn) {
+      std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+      for (;;) {
+        Cell &cell = cells_[pos & mask_];
+        std::size_t const seq = cell.seq.load(std::memory_order_acquire);
+        std::intptr_t const diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+        if (diff == 0) {
+          if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            fn(std::move(*cell.value.get()));
+            release(pos);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false; // empty
+        } else {
+          pos = dequeuePos_.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    template <class Fn>
+    bool consume(std::false_type, Fn &fn) {
+      detail::Slot<T> taken;
+      auto take = [&taken](T &&v) noexcept { taken.construct(std::move(v)); };
+      if (!consume(std::true_type(), take)) {
+        return false;
+      }
+      detail::SlotGuard<T> guard(taken);
+      fn(std::move(*taken.get()));
+      return true;
+    }
+
+    /// Destroy the value in `pos`'s cell and hand the cell back to producers.
+    void release(std::size_t pos) {
+      Cell &cell = cells_[pos & mask_];
+      cell.value.destroy();
+      cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+    }
+
+    std::size_t const mask_;
+    detail::AlignedArray<Cell> cells_;
+    alignas(detail::CacheLine) std::atomic<std::size_t> enqueuePos_;
+    alignas(detail::CacheLine) std::atomic<std::size_t> dequeuePos_;
+  };
+
+}
+
+#endif
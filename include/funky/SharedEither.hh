@@ -0,0 +1,183 @@
+#ifndef FUNKY_SHARED_EITHER_HH_INCLUDED
+#define FUNKY_SHARED_EITHER_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace funky {
+
+  namespace detail {
+
+    /// Reference counts for BasicSharedEither. release() returns true when
+    /// the last reference is dropped.
+    class LocalRefCount {
+    public:
+      explicit LocalRefCount(std::size_t n) : n_(n) {}
+      void addRef() { ++n_; }
+      bool release() { return --n_ == 0; }
+      std::size_t count() const { return n_; }
+
+    private:
+      std::size_t n_;
+    };
+
+    class AtomicRefCount {
+    public:
+      explicit AtomicRefCount(std::size_t n) : n_(n) {}
+      void addRef() { n_.fetch_add(1, std::memory_order_relaxed); }
+      bool release() { return n_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+      // acquire, so that when this is 1 the other owners' releases happen
+      // before the caller mutates in place.
+      std::size_t count() const { return n_.load(std::memory_order_acquire); }
+
+    private:
+      std::atomic<std::size_t> n_;
+    };
+
+  }
+
+  /// An Either<LeftT, RightT> in a reference-counted block. Copies share the
+  /// block; mutating through one that isn't the only reference clones the
+  /// Either first, so copies never see each other's changes.
+  ///
+  /// RefCount is detail::LocalRefCount for LocalSharedEither, whose copies
+  /// must all stay on one thread, and detail::AtomicRefCount for
+  /// SharedEither, whose copies can be handed to other threads (though, as
+  /// with std::shared_ptr, one SharedEither object can't be used by two
+  /// threads at once if either writes to it).
+  template <class LeftT, class RightT, class RefCount>
+  class BasicSharedEither {
+  public:
+    typedef Either<LeftT, RightT> Value;
+
+    BasicSharedEither(BasicSharedEither const &o) : block_(o.block_) {
+      FUNKY_CHECK(o.block_);
+      block_->refs.addRef();
+    }
+    /// Leaves `o` empty: it can only be assigned to or destroyed.
+    BasicSharedEither(BasicSharedEither &&o) noexcept : block_(o.block_) { o.block_ = nullptr; }
+
+    /// Put `v` (or what it's constructed from) in a new block.
+    BasicSharedEither(Value const &v) : block_(new Block(v)) {}
+    BasicSharedEither(Value &&v) : block_(new Block(std::move(v))) {}
+
+    template <class... Args>
+    BasicSharedEither(EmplaceLeftTag, Args&&... args)
+      : block_(new Block(EmplaceLeft, std::forward<Args>(args)...)) {}
+
+    template <class... Args>
+    BasicSharedEither(EmplaceRightTag, Args&&... args)
+      : block_(new Block(EmplaceRight, std::forward<Args>(args)...)) {}
+
+    ~BasicSharedEither() { drop(); }
+
+    BasicSharedEither &operator=(BasicSharedEither const &o) {
+      FUNKY_CHECK(o.block_);
+      if (block_ != o.block_) {
+        o.block_->refs.addRef();
+        drop();
+        block_ = o.block_;
+      }
+      return *this;
+    }
+
+    BasicSharedEither &operator=(BasicSharedEither &&o) noexcept {
+      if (block_ == o.block_) {
+        // we hold another reference, so this can't be the last one.
+        if (this != &o && o.block_) {
+          o.block_->refs.release();
+          o.block_ = nullptr;
+        }
+      } else {
+        drop();
+        block_ = o.block_;
+        o.block_ = nullptr;
+      }
+      return *this;
+    }
+
+    /// The shared Either, for reading.
+    Value const &get() const { FUNKY_CHECK(block_); return block_->value; }
+    Value const &operator*() const { return get(); }
+    Value const *operator->() const { return &get(); }
+
+    bool isLeft() const { return get().isLeft(); }
+    bool isRight() const { return get().isRight(); }
+    typename detail::EitherSlot<LeftT>::ConstRef left() const { return get().left(); }
+    typename detail::EitherSlot<RightT>::ConstRef right() const { return get().right(); }
+
+    /// The Either, for writing. Clones it into a block of our own first,
+    /// unless this is the only reference to it.
+    Value &mutate() {
+      FUNKY_CHECK(block_);
+      if (!unique()) {
+        Block *clone = new Block(block_->value);
+        drop();
+        block_ = clone;
+      }
+      return block_->value;
+    }
+
+    /// Replace the Either. Assigns in place if this is the only reference,
+    /// and otherwise puts `v` in a new block without copying the old value.
+    template <class V>
+    void set(V &&v) {
+      if (block_ && unique()) {
+        block_->value = std::forward<V>(v);
+      } else {
+        Block *fresh = new Block(std::forward<V>(v));
+        drop();
+        block_ = fresh;
+      }
+    }
+
+    /// Whether this is the only reference to its Either, so mutate() won't
+    /// copy it.
+    bool unique() const { return useCount() == 1; }
+    std::size_t useCount() const { FUNKY_CHECK(block_); return block_->refs.count(); }
+
+    /// Copies of the same SharedEither compare equal without comparing
+    /// their Eithers.
+    bool operator==(BasicSharedEither const &o) const { return block_ == o.block_ || get() == o.get(); }
+    bool operator!=(BasicSharedEither const &o) const { return !operator==(o); }
+
+    void swap(BasicSharedEither &o) noexcept { std::swap(block_, o.block_); }
+    friend void swap(BasicSharedEither &a, BasicSharedEither &b) noexcept { a.swap(b); }
+
+  private:
+    struct Block {
+      template <class... Args>
+      explicit Block(Args&&... args) : refs(1), value(std::forward<Args>(args)...) {}
+
+      RefCount refs;
+      Value value;
+    };
+
+    void drop() {
+      if (block_ && block_->refs.release()) {
+        delete block_;
+      }
+    }
+
+    Block *block_;
+  };
+
+  /// A BasicSharedEither whose copies can go to other threads.
+  template <class LeftT, class RightT>
+  using SharedEither = BasicSharedEither<LeftT, RightT, detail::AtomicRefCount>;
+
+  /// A BasicSharedEither whose copies all stay on one thread, which saves
+  /// the atomic instructions on copies.
+  template <class LeftT, class RightT>
+  using LocalSharedEither = BasicSharedEither<LeftT, RightT, detail::LocalRefCount>;
+
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef FUNKY_THREAD_POOL_HH_INCLUDED
+#define FUNKY_THREAD_POOL_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/EitherFuture.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// A work-stealing pool for tasks that return Eithers.
+///
+/// Every worker has its own Chase-Lev deque. Tasks submitted from a worker go
+/// on the bottom of its deque, and the worker takes from the bottom (newest
+/// first, which keeps nested work cache-hot). Idle workers steal from the top
+/// of a randomly chosen victim's deque. Tasks submitted from other threads
+/// go through a shared injection queue. The pool itself is out of line, in
+/// libfunky; only submit() is a template.
+
+namespace funky {
+
+  namespace detail {
+
+    /// A unit of work in a ThreadPool.
+    class PoolTask {
+    public:
+      virtual void run() = 0;
+    protected:
+      ~PoolTask() {}
+    };
+
+    /// A submitted function and the state of the future for its result, in
+    /// one allocation.
+    template <class V, class Fn>
+    class SubmittedTask : public FutureState<V>, public PoolTask {
+    public:
+      explicit SubmittedTask(Fn &&fn) : FutureState<V>(2), fn_(std::move(fn)) {}
+
+      void run() override {
+        this->set(fn_());
+        this->release();
+      }
+
+    private:
+      Fn fn_;
+    };
+
+    template <class Fn>
+    struct SubmitResult {
+      typedef typename std::decay<decltype(std::declval<Fn&>()())>::type Value;
+      typedef typename FutureFor<Value>::type Future;
+    };
+
+    struct PoolWorker;
+
+  }
+
+  class ThreadPool {
+  public:
+    /// Start `threads` workers (at least one).
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+
+    /// Runs every task already submitted (and any they submit), then stops
+    /// the workers.
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+    /// Run `fn` (which takes no arguments and returns an Either) on the pool,
+    /// and get a future for its result. Tasks report failure by returning a
+    /// Left; an exception escaping a task terminates the program.
+    template <class Fn>
+    typename detail::SubmitResult<Fn>::Future submit(Fn fn) {
+      typedef detail::SubmitResult<Fn> R;
+      typedef detail::SubmittedTask<typename R::Value, Fn> Task;
+      Task *task = new Task(std::move(fn));
+      typename R::Future f = detail::FutureAccess::make(static_cast<detail::FutureState<typename R::Value>*>(task));
+      schedule(task);
+      return f;
+    }
+
+    /// Wait for `f`, running other tasks from the pool in the meantime. This
+    /// is how a task should wait for tasks it submitted, since blocking in
+    /// EitherFuture::wait() would take a worker out of the pool.
+    template <class E, class T>
+    Either<E, T> get(EitherFuture<E, T> f) {
+      while (!f.isReady()) {
+        if (!runOne()) {
+          std::this_thread::yield();
+        }
+      }
+      return f.get();
+    }
+
+    /// Run one pending task in the calling thread, if there is one.
+    bool runOne();
+
+  private:
+    friend struct detail::PoolWorker;
+
+    void schedule(detail::PoolTask *task);
+    detail::PoolTask *findTask(detail::PoolWorker *self);
+    void workerLoop(detail::PoolWorker *self);
+
+    std::vector<std::unique_ptr<detail::PoolWorker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex injectMutex_;
+    std::deque<detail::PoolTask*> inject_;
+    std::atomic<std::size_t> injectSize_;
+
+    // workers sleep on wakeups_, which changes whenever work is added.
+    std::atomic<std::uint32_t> wakeups_;
+    std::atomic<int> sleeping_;
+    std::atomic<bool> stopping_;
+  };
+
+}
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef FUNKY_VALIDATION_HH_INCLUDED
+#define FUNKY_VALIDATION_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace funky {
+
+  /// Validation<E, T>: like Either, but collects every error instead of
+  /// stopping at the first. Combining several Validations gives either all of
+  /// their values, or all of their errors, in order.
+  ///
+  /// Errors are kept in a SmallVector, which holds the first N of them inline
+  /// and only allocates beyond that, so building a valid result never
+  /// allocates, and neither does reporting a few errors.
+
+  /// A vector that keeps up to N elements inline, and moves them to the heap
+  /// when it grows past that. Moving a SmallVector that's on the heap just
+  /// takes its buffer.
+  template <class T, std::size_t N>
+  class SmallVector {
+    static_assert(N > 0, "SmallVector needs room for at least one element inline");
+
+  public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef T const *const_iterator;
+
+    SmallVector() : inline_(), data_(inlineData()), size_(0), capacity_(N) {}
+
+    SmallVector(SmallVector const &o) : SmallVector() {
+      reserve(o.size_);
+      for (std::size_t i = 0; i < o.size_; ++i) {
+        new (data_ + i) T(o.data_[i]);
+        ++size_;
+      }
+    }
+
+    SmallVector(SmallVector &&o) noexcept(std::is_nothrow_move_constructible<T>::value) : SmallVector() {
+      takeFrom(o);
+    }
+
+    ~SmallVector() {
+      clear();
+      freeHeap();
+    }
+
+    SmallVector &operator=(SmallVector const &o) {
+      if (this != &o) {
+        clear();
+        reserve(o.size_);
+        for (std::size_t i = 0; i < o.size_; ++i) {
+          new (data_ + i) T(o.data_[i]);
+          ++size_;
+        }
+      }
+      return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&o) noexcept(std::is_nothrow_move_constructible<T>::value) {
+      if (this != &o) {
+        clear();
+        freeHeap();
+        takeFrom(o);
+      }
+      return *this;
+    }
+
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    /// Whether the elements are in the inline buffer.
+    bool isInline() const { return data_ == inlineData(); }
+
+    T       &operator[](std::size_t i)       { FUNKY_CHECK(i < size_); return data_[i]; }
+    T const &operator[](std::size_t i) const { FUNKY_CHECK(i < size_); return data_[i]; }
+
+    T       &front()       { FUNKY_CHECK(size_ != 0); return data_[0]; }
+    T const &front() const { FUNKY_CHECK(size_ != 0); return data_[0]; }
+    T       &back()        { FUNKY_CHECK(size_ != 0); return data_[size_ - 1]; }
+    T const &back()  const { FUNKY_CHECK(size_ != 0); return data_[size_ - 1]; }
+
+    iterator       begin()       { return data_; }
+    const_iterator begin() const { return data_; }
+    iterator       end()         { return data_ + size_; }
+    const_iterator end()   const { return data_ + size_; }
+
+    template <class... Args>
+    void emplace_back(Args&&... args) {
+      if (size_ == capacity_) {
+        growAndEmplace(std::forward<Args>(args)...);
+        return;
+      }
+      new (data_ + size_) T(std::forward<Args>(args)...);
+      ++size_;
+    }
+
+    void push_back(T const &v) { emplace_back(v); }
+    void push_back(T &&v) { emplace_back(std::move(v)); }
+
+    /// Move all of `o`'s elements onto the end of this one, leaving `o`
+    /// empty. If this one is empty, it takes `o`'s heap buffer, if it has one.
+    void append(SmallVector &&o) {
+      if (empty() && !o.isInline()) {
+        *this = std::move(o);
+        return;
+      }
+      reserve(size_ + o.size_);
+      for (std::size_t i = 0; i < o.size_; ++i) {
+        new (data_ + size_) T(std::move(o.data_[i]));
+        ++size_;
+      }
+      o.clear();
+    }
+
+    void reserve(std::size_t n) {
+      if (n > capacity_) {
+        grow(n);
+      }
+    }
+
+    void clear() {
+      for (std::size_t i = 0; i < size_; ++i) {
+        data_[i].~T();
+      }
+      size_ = 0;
+    }
+
+    bool operator==(SmallVector const &o) const {
+      if (size_ != o.size_) {
+        return false;
+      }
+      for (std::size_t i = 0; i < size_; ++i) {
+        if (!(data_[i] == o.data_[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    bool operator!=(SmallVector const &o) const { return !(*this == o); }
+
+  private:
+    T       *inlineData()       { return reinterpret_cast<T*>(&inline_); }
+    T const *inlineData() const { return reinterpret_cast<T const*>(&inline_); }
+
+    // `this` must be empty and inline.
+    void takeFrom(SmallVector &o) {
+      if (o.isInline()) {
+        for (std::size_t i = 0; i < o.size_; ++i) {
+          new (data_ + i) T(std::move(o.data_[i]));
+          ++size_;
+        }
+        o.clear();
+      } else {
+        data_ = o.data_;
+        size_ = o.size_;
+        capacity_ = o.capacity_;
+        o.data_ = o.inlineData();
+        o.size_ = 0;
+        o.capacity_ = N;
+      }
+    }
+
+    void grow(std::size_t min) {
+      std::size_t const capacity = min > 2 * capacity_ ? min : 2 * capacity_;
+      moveTo(static_cast<T*>(::operator new(capacity * sizeof(T))), capacity);
+    }
+
+    // the new element is built before the old ones move, since args may
+    // refer to one of them, as in v.push_back(v[0]).
+    template <class... Args>
+    void growAndEmplace(Args&&... args) {
+      std::size_t const capacity = 2 * capacity_;
+      T *data = static_cast<T*>(::operator new(capacity * sizeof(T)));
+      try {
+        new (data + size_) T(std::forward<Args>(args)...);
+      } catch (...) {
+        ::operator delete(data);
+        throw;
+      }
+      moveTo(data, capacity);
+      ++size_;
+    }
+
+    void moveTo(T *data, std::size_t capacity) {
+      for (std::size_t i = 0; i < size_; ++i) {
+        new (data + i) T(std::move(data_[i]));
+        data_[i].~T();
+      }
+      freeHeap();
+      data_ = data;
+      capacity_ = capacity;
+    }
+
+    void freeHeap() {
+      if (!isInline()) {
+        ::operator delete(data_);
+        data_ = inlineData();
+        capacity_ = N;
+      }
+    }
+
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_;
+    T *data_;
+    std::size_t size_;
+    std::size_t capacity_;
+  };
+
+
+  template <class E, class T, std::size_t N = 4>
+  class Validation {
+  public:
+    typedef SmallVector<E, N> Errors;
+
+    Validation(T const &v) : either_(v) {}
+    Validation(T &&v) : either_(std::move(v)) {}
+
+    /// Construct the value in place.
+    template <class... Args>
+    explicit Validation(EmplaceRightTag, Args&&... args) : either_(EmplaceRight, std::forward<Args>(args)...) {}
+
+    /// Construct a single error in place.
+    template <class... Args>
+    explicit Validation(EmplaceLeftTag, Args&&... args) : either_(EmplaceLeft) {
+      either_.left().emplace_back(std::forward<Args>(args)...);
+    }
+
+    /// An invalid result with the given errors, of which there must be at
+    /// least one.
+    explicit Validation(Errors errors) : either_(std::move(errors)) { FUNKY_CHECK(!either_.left().empty()); }
+
+    /// From an Either: its Left becomes the only error. A template so that
+    /// Validation<T, T> doesn't name Either<T, T>, which can't exist.
+    template <class Ei, class = typename std::enable_if<
+                          std::is_same<typename std::decay<Ei>::type, Either<E, T>>::value>::type>
+    Validation(Ei &&e) : either_(EmplaceLeft) {
+      if (e.isRight()) {
+        either_.emplaceRight(std::forward<Ei>(e).right());
+      } else {
+        either_.left().emplace_back(std::forward<Ei>(e).left());
+      }
+    }
+
+    bool isValid() const { return either_.isRight(); }
+    bool isInvalid() const { return either_.isLeft(); }
+
+    T const &value() const & { return either_.right(); }
+    T       &value()       & { return either_.right(); }
+    T      &&value()      && { return std::move(either_).right(); }
+
+    Errors const &errors() const & { return either_.left(); }
+    Errors       &errors()       & { return either_.left(); }
+    Errors      &&errors()      && { return std::move(either_).left(); }
+
+    /// As an Either holding all the errors.
+    Either<Errors, T> const &toEither() const & { return either_; }
+    Either<Errors, T>      &&toEither()      && { return std::move(either_); }
+
+    /// A Validation of `fn(value())`, or of these errors.
+    template <class Fn>
+    Validation<E, typename std::decay<decltype(std::declval<Fn&>()(std::declval<T const&>()))>::type, N>
+    map(Fn fn) const & {
+      typedef Validation<E, typename std::decay<decltype(fn(std::declval<T const&>()))>::type, N> R;
+      return isValid() ? R{fn(value())} : R{errors()};
+    }
+
+    template <class Fn>
+    Validation<E, typename std::decay<decltype(std::declval<Fn&>()(std::declval<T&&>()))>::type, N>
+    map(Fn fn) && {
+      typedef Validation<E, typename std::decay<decltype(fn(std::declval<T&&>()))>::type, N> R;
+      return isValid() ? R{fn(std::move(*this).value())} : R{std::move(*this).errors()};
+    }
+
+    bool operator==(Validation const &o) const { return either_ == o.either_; }
+    bool operator!=(Validation const &o) const { return either_ != o.either_; }
+
+  private:
+    Either<Errors, T> either_;
+  };
+
+  namespace detail {
+
+    inline bool allOf(std::initializer_list<bool> bs) {
+      for (bool b : bs) {
+        if (!b) return false;
+      }
+      return true;
+    }
+
+    template <class Fn, class... Ts>
+    struct CombineResult {
+      typedef typename std::decay<decltype(std::declval<Fn&>()(std::declval<Ts&&>()...))>::type type;
+    };
+
+  }
+
+  /// If every one of `vs` is valid, `fn(values...)`. Otherwise all of their
+  /// errors, in order, moved out of `vs` (the first invalid one's heap buffer,
+  /// if it has one, is reused).
+  template <class Fn, class E, std::size_t N, class... Ts>
+  Validation<E, typename detail::CombineResult<Fn, Ts...>::type, N>
+  combine(Fn fn, Validation<E, Ts, N>... vs) {
+    static_assert(sizeof...(Ts) > 0, "combine() needs at least one Validation");
+    typedef Validation<E, typename detail::CombineResult<Fn, Ts...>::type, N> R;
+    if (detail::allOf({vs.isValid()...})) {
+      return R{fn(std::move(vs).value()...)};
+    }
+    typename R::Errors errors;
+    int const expand[] = {(vs.isInvalid() ? errors.append(std::move(vs).errors()) : void(), 0)...};
+    (void)expand;
+    return R{std::move(errors)};
+  }
+
+}
+
+#endif
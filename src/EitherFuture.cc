@@ -0,0 +1,90 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/EitherFuture.hh"
+
+#include <climits>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#endif
+
+namespace funky {
+namespace detail {
+
+  int waitSpins() {
+    static int const spins = std::thread::hardware_concurrency() > 1 ? 128 : 0;
+    return spins;
+  }
+
+#if defined(__linux__)
+
+  static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                "futexes need a plain 32 bit word");
+
+  void futexWait(std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+            expected, nullptr, nullptr, 0);
+  }
+
+  void futexWakeOne(std::atomic<std::uint32_t> &word) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+            1, nullptr, nullptr, 0);
+  }
+
+  void futexWakeAll(std::atomic<std::uint32_t> &word) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+            INT_MAX, nullptr, nullptr, 0);
+  }
+
+#else
+
+  // elsewhere, sleep on one of a fixed set of condition variables picked by
+  // address. Wakers lock the same mutex, so a waiter can't miss a wakeup
+  // between checking the word and going to sleep.
+  namespace {
+
+    struct Bucket {
+      Bucket() : mutex(), cv() {}
+      std::mutex mutex;
+      std::condition_variable cv;
+    };
+
+    Bucket &bucketFor(void const *p) {
+      static Bucket buckets[64];
+      return buckets[(reinterpret_cast<std::size_t>(p) >> 4) % 64];
+    }
+
+  }
+
+  void futexWait(std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    Bucket &b = bucketFor(&word);
+    std::unique_lock<std::mutex> lock{b.mutex};
+    while (word.load(std::memory_order_acquire) == expected) {
+      b.cv.wait(lock);
+    }
+  }
+
+  // buckets are shared, so waking "one" could wake the wrong waiter.
+  void futexWakeOne(std::atomic<std::uint32_t> &word) {
+    futexWakeAll(word);
+  }
+
+  void futexWakeAll(std::atomic<std::uint32_t> &word) {
+    Bucket &b = bucketFor(&word);
+    std::lock_guard<std::mutex> lock{b.mutex};
+    b.cv.notify_all();
+  }
+
+#endif
+
+}
+}
@@ -0,0 +1,17 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/EitherInstances.hh"
+
+#if !FUNKY_EITHER_INSTANCES_EXTERN
+#error "funky/LibraryConfig.hh is missing, or wasn't generated with these flags"
+#endif
+
+namespace funky {
+
+#define FUNKY_INSTANTIATE_EITHER(L, R) template class Either<L, R>;
+  FUNKY_EITHER_INSTANCES(FUNKY_INSTANTIATE_EITHER)
+#undef FUNKY_INSTANTIATE_EITHER
+
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/EitherTelemetry.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace funky {
+namespace telemetry {
+
+  namespace {
+
+    using detail::ThreadCounters;
+
+    char const OverflowFile[] = "<overflow>";
+
+    // the same file may be named by different pointers in different
+    // translation units, so sites are compared by string.
+    struct SiteLess {
+      bool operator()(std::pair<char const *, unsigned> const &a,
+                      std::pair<char const *, unsigned> const &b) const {
+        int const c = std::strcmp(a.first, b.first);
+        return c != 0 ? c < 0 : a.second < b.second;
+      }
+    };
+
+    typedef std::map<std::pair<char const *, unsigned>, std::uint64_t, SiteLess> Totals;
+
+    struct Registry {
+      Registry() : mutex(), live(), retired() {}
+
+      std::mutex mutex;
+      std::vector<ThreadCounters *> live;
+      Totals retired; // counts from threads that have exited
+    };
+
+    // leaked on purpose, threads may exit after static destructors run.
+    Registry &registry() {
+      static Registry *r = new Registry;
+      return *r;
+    }
+
+    void collect(ThreadCounters const &c, Totals &into) {
+      for (std::size_t i = 0; i < ThreadCounters::Capacity; ++i) {
+        ThreadCounters::Slot const &s = c.slots[i];
+        if (char const *file = s.file.load(std::memory_order_acquire)) {
+          into[std::make_pair(file, s.line.load(std::memory_order_relaxed))]
+            += s.count.load(std::memory_order_relaxed);
+        }
+      }
+      if (std::uint64_t const overflow = c.overflow.load(std::memory_order_relaxed)) {
+        into[std::make_pair(OverflowFile, 0u)] += overflow;
+      }
+    }
+
+    // folds a thread's counts into the registry when it exits.
+    struct Retirer {
+      Retirer() : counters(nullptr) {}
+      Retirer(Retirer const &) = delete;
+      Retirer &operator=(Retirer const &) = delete;
+
+      ~Retirer() {
+        if (!counters) {
+          return;
+        }
+        Registry &r = registry();
+        {
+          std::lock_guard<std::mutex> lock{r.mutex};
+          collect(*counters, r.retired);
+          r.live.erase(std::remove(r.live.begin(), r.live.end(), counters), r.live.end());
+        }
+        detail::current() = nullptr;
+        counters->~ThreadCounters();
+        std::free(counters);
+      }
+
+      ThreadCounters *counters;
+    };
+
+    thread_local Retirer retirer;
+
+  }
+
+  namespace detail {
+
+    ThreadCounters *attachThread() {
+      void *mem = nullptr;
+      if (posix_memalign(&mem, alignof(ThreadCounters), sizeof(ThreadCounters)) != 0) {
+        throw std::bad_alloc{};
+      }
+      ThreadCounters *c = new (mem) ThreadCounters;
+      {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock{r.mutex};
+        r.live.push_back(c);
+      }
+      retirer.counters = c;
+      current() = c;
+      return c;
+    }
+
+  }
+
+  std::vector<SiteCount> snapshot() {
+    Totals totals;
+    {
+      Registry &r = registry();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      totals = r.retired;
+      for (ThreadCounters const *c : r.live) {
+        collect(*c, totals);
+      }
+    }
+
+    std::vector<SiteCount> result;
+    result.reserve(totals.size());
+    for (Totals::value_type const &t : totals) {
+      if (t.second != 0) {
+        SiteCount const sc = { t.first.first, t.first.second, t.second };
+        result.push_back(sc);
+      }
+    }
+    std::stable_sort(result.begin(), result.end(), [](SiteCount const &a, SiteCount const &b) {
+      return a.lefts > b.lefts;
+    });
+    return result;
+  }
+
+  void reset() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock{r.mutex};
+    r.retired.clear();
+    for (ThreadCounters *c : r.live) {
+      for (std::size_t i = 0; i < ThreadCounters::Capacity; ++i) {
+        c->slots[i].count.store(0, std::memory_order_relaxed);
+      }
+      c->overflow.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void dump(std::FILE *out) {
+    std::vector<SiteCount> const counts = snapshot();
+    std::fprintf(out, "funky: Left constructions by site\n");
+    for (SiteCount const &c : counts) {
+      std::fprintf(out, "%s:%u %llu\n", c.file, c.line, static_cast<unsigned long long>(c.lefts));
+    }
+  }
+
+}
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/ErrorContext.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+namespace funky {
+
+  // chunks are linked in the order they were first used, and the data
+  // follows the header.
+  struct ErrorArena::Chunk {
+    Chunk *next;
+    std::size_t size;
+
+    char *begin() { return reinterpret_cast<char*>(this) + sizeof(Chunk); }
+    char *end() { return begin() + size; }
+  };
+
+  static_assert(sizeof(ErrorArena::Mark) == 2 * sizeof(void*), "");
+
+  void *ErrorArena::allocateSlow(std::size_t size, std::size_t align) {
+    std::size_t const needed = size + align - 1;
+    // move on to the next chunk that's kept from before a rewind, if it's
+    // big enough. One that isn't (only possible for allocations bigger
+    // than chunkSize_) stays where it is, after a new chunk for this one.
+    Chunk *next = current_ != nullptr ? current_->next : first_;
+    if (next == nullptr || next->size < needed) {
+      std::size_t const bytes = std::max(chunkSize_, needed);
+      Chunk *c = static_cast<Chunk*>(::operator new(sizeof(Chunk) + bytes));
+      c->next = next;
+      c->size = bytes;
+      (current_ != nullptr ? current_->next : first_) = c;
+      next = c;
+    }
+    current_ = next;
+    next_ = next->begin();
+    end_ = next->end();
+    void *p = allocate(size, align);
+    FUNKY_CHECK_INVARIANT(p != nullptr);
+    return p;
+  }
+
+  void ErrorArena::rewind(Mark m) {
+    current_ = m.chunk;
+    next_ = m.next;
+    end_ = m.chunk != nullptr ? m.chunk->end() : nullptr;
+  }
+
+  void ErrorArena::release() {
+    for (Chunk *c = first_; c != nullptr;) {
+      Chunk *next = c->next;
+      ::operator delete(c);
+      c = next;
+    }
+    first_ = current_ = nullptr;
+    next_ = end_ = nullptr;
+  }
+
+  std::size_t ErrorArena::bytesUsed() const {
+    if (current_ == nullptr) {
+      return 0;
+    }
+    std::size_t n = 0;
+    for (Chunk *c = first_; c != current_; c = c->next) {
+      n += c->size;
+    }
+    return n + static_cast<std::size_t>(next_ - current_->begin());
+  }
+
+  std::size_t ErrorArena::bytesReserved() const {
+    std::size_t n = 0;
+    for (Chunk *c = first_; c != nullptr; c = c->next) {
+      n += c->size;
+    }
+    return n;
+  }
+
+  ErrorMessage const &ErrorContext::rootMessage() const {
+    Node const *n = node_;
+    while (n->cause != nullptr) {
+      n = n->cause;
+    }
+    return n->message;
+  }
+
+  std::size_t ErrorContext::depth() const {
+    std::size_t d = 0;
+    for (Node const *n = node_; n != nullptr; n = n->cause) {
+      ++d;
+    }
+    return d;
+  }
+
+  std::string ErrorContext::str() const {
+    std::string s;
+    for (Node const *n = node_; n != nullptr; n = n->cause) {
+      if (n != node_) {
+        s += ": ";
+      }
+      s.append(n->message.data(), n->message.size());
+    }
+    return s;
+  }
+
+}
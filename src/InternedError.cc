@@ -0,0 +1,90 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/InternedError.hh"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace funky {
+
+  namespace detail {
+
+    InternedErrorEntry const canonicalErrors[CanonicalErrorCount] = {
+      {"cancelled", 9, CanonicalCancelled},
+      {"invalid argument", 16, CanonicalInvalidArgument},
+      {"timed out", 9, CanonicalTimedOut},
+      {"not found", 9, CanonicalNotFound},
+      {"already exists", 14, CanonicalAlreadyExists},
+      {"permission denied", 17, CanonicalPermissionDenied},
+      {"out of range", 12, CanonicalOutOfRange},
+      {"unavailable", 11, CanonicalUnavailable},
+    };
+
+  }
+
+  namespace {
+
+    /// Every registered error by text. An entry's text points at its key,
+    /// which stays put since unordered_map never moves its nodes.
+    class Registry {
+    public:
+      Registry() : mutex_(), byText_(), entries_() {
+        for (detail::InternedErrorEntry const &e : detail::canonicalErrors) {
+          byText_.emplace(std::string(e.text, e.size), &e);
+        }
+      }
+
+      detail::InternedErrorEntry const *intern(char const *s, std::size_t n) {
+        std::string key(s, n);
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto found = byText_.find(key);
+        if (found != byText_.end()) {
+          return found->second;
+        }
+        // add the entry first, so that if the map throws there's no key
+        // without one.
+        entries_.push_back(detail::InternedErrorEntry{nullptr, 0, static_cast<unsigned>(byText_.size())});
+        detail::InternedErrorEntry &entry = entries_.back();
+        try {
+          found = byText_.emplace(std::move(key), &entry).first;
+        } catch (...) {
+          entries_.pop_back();
+          throw;
+        }
+        entry.text = found->first.data();
+        entry.size = found->first.size();
+        return &entry;
+      }
+
+      std::size_t size() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return byText_.size();
+      }
+
+    private:
+      std::mutex mutex_;
+      std::unordered_map<std::string, detail::InternedErrorEntry const *> byText_;
+      std::deque<detail::InternedErrorEntry> entries_;
+    };
+
+    // never destroyed, so errors stay valid in other statics' destructors
+    // and threads still running at exit.
+    Registry &registry() {
+      static Registry &r = *new Registry;
+      return r;
+    }
+
+  }
+
+  InternedError InternedError::intern(char const *s, std::size_t n) {
+    return InternedError(registry().intern(s, n));
+  }
+
+  std::size_t InternedError::registered() {
+    return registry().size();
+  }
+
+}
@@ -0,0 +1,259 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "funky/ThreadPool.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+namespace funky {
+namespace detail {
+
+  namespace {
+
+    /// Chase-Lev deque, after "Correct and Efficient Work-Stealing for Weak
+    /// Memory Models" (Lê et al., 2013). Only the owner pushes and takes, at
+    /// the bottom; anyone may steal from the top. It uses seq_cst operations
+    /// where the paper uses fences, since ThreadSanitizer doesn't model fences.
+    class StealDeque {
+    public:
+      StealDeque() : top_(0), bottom_(0), array_(new Array(256)), retired_() {}
+
+      ~StealDeque() { delete array_.load(std::memory_order_relaxed); }
+
+      StealDeque(StealDeque const &) = delete;
+      StealDeque &operator=(StealDeque const &) = delete;
+
+      void push(PoolTask *task) {
+        std::int64_t const b = bottom_.load(std::memory_order_relaxed);
+        std::int64_t const t = top_.load(std::memory_order_acquire);
+        Array *a = array_.load(std::memory_order_relaxed);
+        if (b - t > static_cast<std::int64_t>(a->mask)) {
+          a = grow(a, t, b);
+        }
+        a->at(b).store(task, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_seq_cst);
+      }
+
+      PoolTask *take() {
+        std::int64_t const b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array *a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_seq_cst);
+        std::int64_t t = top_.load(std::memory_order_seq_cst);
+        if (t > b) {
+          bottom_.store(b + 1, std::memory_order_relaxed);
+          return nullptr;
+        }
+        PoolTask *task = a->at(b).load(std::memory_order_relaxed);
+        if (t == b) {
+          // the last task; race any thieves for it.
+          if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            task = nullptr;
+          }
+          bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+      }
+
+      PoolTask *steal() {
+        std::int64_t t = top_.load(std::memory_order_seq_cst);
+        std::int64_t const b = bottom_.load(std::memory_order_seq_cst);
+        if (t >= b) {
+          return nullptr;
+        }
+        Array *a = array_.load(std::memory_order_acquire);
+        PoolTask *task = a->at(t).load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+          return nullptr; // lost the race; the caller tries elsewhere
+        }
+        return task;
+      }
+
+    private:
+      struct Array {
+        explicit Array(std::size_t capacity)
+          : mask(capacity - 1), slots(new std::atomic<PoolTask*>[capacity]) {}
+
+        std::atomic<PoolTask*> &at(std::int64_t i) { return slots[static_cast<std::size_t>(i) & mask]; }
+
+        std::size_t const mask;
+        std::unique_ptr<std::atomic<PoolTask*>[]> slots;
+      };
+
+      // thieves may still be reading the old array, so it's kept until the
+      // deque is destroyed.
+      Array *grow(Array *a, std::int64_t t, std::int64_t b) {
+        Array *bigger = new Array(2 * (a->mask + 1));
+        for (std::int64_t i = t; i < b; ++i) {
+          bigger->at(i).store(a->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        array_.store(bigger, std::memory_order_release);
+        retired_.emplace_back(a);
+        return bigger;
+      }
+
+      alignas(64) std::atomic<std::int64_t> top_;
+      alignas(64) std::atomic<std::int64_t> bottom_;
+      std::atomic<Array*> array_;
+      std::vector<std::unique_ptr<Array>> retired_;
+    };
+
+    // xorshift64*, for picking victims.
+    std::uint64_t nextRandom(std::uint64_t &state) {
+      state ^= state >> 12;
+      state ^= state << 25;
+      state ^= state >> 27;
+      return state * 0x2545f4914f6cdd1dull;
+    }
+
+  }
+
+  struct PoolWorker {
+    PoolWorker(ThreadPool &pool, unsigned index)
+      : pool(pool), deque(), random(0x9e3779b97f4a7c15ull * (index + 1)) {}
+
+    // the deque's alignas(64) isn't honored by plain new before C++17.
+    static void *operator new(std::size_t size) {
+      void *p = nullptr;
+      if (posix_memalign(&p, alignof(PoolWorker), size) != 0) {
+        throw std::bad_alloc();
+      }
+      return p;
+    }
+
+    static void operator delete(void *p) { std::free(p); }
+
+    ThreadPool &pool;
+    StealDeque deque;
+    std::uint64_t random;
+  };
+
+  namespace {
+
+    thread_local PoolWorker *currentWorker = nullptr;
+
+    // threads outside the pool pick victims with their own generator.
+    std::uint64_t &outsideRandom() {
+      static thread_local std::uint64_t state = reinterpret_cast<std::uintptr_t>(&state) | 1;
+      return state;
+    }
+
+  }
+
+}
+
+  using detail::PoolTask;
+  using detail::PoolWorker;
+
+  ThreadPool::ThreadPool(unsigned threads)
+    : workers_(), threads_(), injectMutex_(), inject_(), injectSize_(0)
+    , wakeups_(0), sleeping_(0), stopping_(false) {
+    if (threads == 0) {
+      threads = 1;
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+      workers_.emplace_back(new PoolWorker(*this, i));
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+      PoolWorker *w = workers_[i].get();
+      threads_.emplace_back([this, w] { workerLoop(w); });
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    stopping_.store(true, std::memory_order_seq_cst);
+    wakeups_.fetch_add(1, std::memory_order_seq_cst);
+    detail::futexWakeAll(wakeups_);
+    for (std::thread &t : threads_) {
+      t.join();
+    }
+  }
+
+  void ThreadPool::schedule(PoolTask *task) {
+    PoolWorker *self = detail::currentWorker;
+    if (self && &self->pool == this) {
+      self->deque.push(task);
+    } else {
+      std::lock_guard<std::mutex> lock{injectMutex_};
+      inject_.push_back(task);
+      injectSize_.fetch_add(1, std::memory_order_release);
+    }
+    // a worker about to sleep either sees the task or sees wakeups_ change.
+    wakeups_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+      detail::futexWakeOne(wakeups_);
+    }
+  }
+
+  PoolTask *ThreadPool::findTask(PoolWorker *self) {
+    if (self) {
+      if (PoolTask *t = self->deque.take()) {
+        return t;
+      }
+    }
+    if (injectSize_.load(std::memory_order_acquire) != 0) {
+      std::lock_guard<std::mutex> lock{injectMutex_};
+      if (!inject_.empty()) {
+        PoolTask *t = inject_.front();
+        inject_.pop_front();
+        injectSize_.fetch_sub(1, std::memory_order_relaxed);
+        return t;
+      }
+    }
+    std::size_t const n = workers_.size();
+    std::uint64_t const r = detail::nextRandom(self ? self->random : detail::outsideRandom());
+    for (std::size_t i = 0; i < n; ++i) {
+      PoolWorker *victim = workers_[(r + i) % n].get();
+      if (victim != self) {
+        if (PoolTask *t = victim->deque.steal()) {
+          return t;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  void ThreadPool::workerLoop(PoolWorker *self) {
+    detail::currentWorker = self;
+    for (;;) {
+      PoolTask *task = findTask(self);
+      for (int spin = 0; !task && spin < 16; ++spin) {
+        std::this_thread::yield();
+        task = findTask(self);
+      }
+      if (!task) {
+        sleeping_.fetch_add(1, std::memory_order_seq_cst);
+        std::uint32_t const seen = wakeups_.load(std::memory_order_seq_cst);
+        task = findTask(self);
+        if (!task) {
+          if (stopping_.load(std::memory_order_seq_cst)) {
+            sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+            break;
+          }
+          detail::futexWait(wakeups_, seen);
+        }
+        sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+      }
+      if (task) {
+        task->run();
+      }
+    }
+    detail::currentWorker = nullptr;
+  }
+
+  bool ThreadPool::runOne() {
+    PoolWorker *self = detail::currentWorker;
+    if (self && &self->pool != this) {
+      self = nullptr;
+    }
+    if (PoolTask *task = findTask(self)) {
+      task->run();
+      return true;
+    }
+    return false;
+  }
+
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+// Replaces the global allocation functions for the whole test runner.
+
+#include "AllocationCounter.hh"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+  thread_local std::size_t allocations = 0;
+  thread_local std::size_t deallocations = 0;
+  thread_local std::size_t bytes = 0;
+
+  void *allocate(std::size_t size) {
+    ++allocations;
+    bytes += size;
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+      return p;
+    }
+    throw std::bad_alloc{};
+  }
+
+#ifdef __cpp_aligned_new
+  void *allocateAligned(std::size_t size, std::size_t align) {
+    ++allocations;
+    bytes += size;
+    void *p = nullptr;
+    if (posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size == 0 ? 1 : size) == 0) {
+      return p;
+    }
+    throw std::bad_alloc{};
+  }
+#endif
+
+  void deallocate(void *p) {
+    if (p) {
+      ++deallocations;
+      std::free(p);
+    }
+  }
+
+}
+
+namespace funkytest {
+
+  AllocationCounts allocationCounts() {
+    AllocationCounts c = { allocations, deallocations, bytes };
+    return c;
+  }
+
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept {
+  try {
+    return allocate(size);
+  } catch (std::bad_alloc const &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept {
+  try {
+    return allocate(size);
+  } catch (std::bad_alloc const &) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *p) noexcept { deallocate(p); }
+void operator delete[](void *p) noexcept { deallocate(p); }
+void operator delete(void *p, std::nothrow_t const &) noexcept { deallocate(p); }
+void operator delete[](void *p, std::nothrow_t const &) noexcept { deallocate(p); }
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void *p, std::size_t) noexcept { deallocate(p); }
+#endif
+
+// over-aligned types, from C++17 on.
+#ifdef __cpp_aligned_new
+void *operator new(std::size_t size, std::align_val_t align) {
+  return allocateAligned(size, static_cast<std::size_t>(align));
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+  return allocateAligned(size, static_cast<std::size_t>(align));
+}
+
+void *operator new(std::size_t size, std::align_val_t align, std::nothrow_t const &) noexcept {
+  try {
+    return allocateAligned(size, static_cast<std::size_t>(align));
+  } catch (std::bad_alloc const &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, std::align_val_t align, std::nothrow_t const &) noexcept {
+  try {
+    return allocateAligned(size, static_cast<std::size_t>(align));
+  } catch (std::bad_alloc const &) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void *p, std::align_val_t, std::nothrow_t const &) noexcept { deallocate(p); }
+void operator delete[](void *p, std::align_val_t, std::nothrow_t const &) noexcept { deallocate(p); }
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { deallocate(p); }
+#endif
+#endif
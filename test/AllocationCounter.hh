@@ -0,0 +1,92 @@
+#ifndef FUNKY_TEST_ALLOCATION_COUNTER_HH_INCLUDED
+#define FUNKY_TEST_ALLOCATION_COUNTER_HH_INCLUDED
+// Copyright (c) 2013 Thom Chiovoloni.
+// This file is distributed under the terms of the Boost Software License.
+// See LICENSE.txt at the root of this distribution for details.
+
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <string>
+
+/// The test runner replaces the global operator new and delete with versions
+/// that count, per thread, how often they're called (see AllocationCounter.cc).
+/// These helpers turn those counts into test expectations.
+
+namespace funkytest {
+
+  struct AllocationCounts {
+    std::size_t allocations;
+    std::size_t deallocations;
+    std::size_t bytes;
+  };
+
+  /// Running totals for the calling thread.
+  AllocationCounts allocationCounts();
+
+  /// Counts allocations made by this thread during its lifetime.
+  class AllocationScope {
+  public:
+    AllocationScope() : start_(allocationCounts()) {}
+
+    std::size_t allocations() const { return allocationCounts().allocations - start_.allocations; }
+    std::size_t deallocations() const { return allocationCounts().deallocations - start_.deallocations; }
+    std::size_t bytes() const { return allocationCounts().bytes - start_.bytes; }
+
+  private:
+    AllocationCounts start_;
+  };
+
+  /// Fails the current test if the enclosing scope doesn't make exactly
+  /// `expected` allocations.
+  class ExpectAllocations {
+  public:
+    explicit ExpectAllocations(std::size_t expected, char const *what = "scope")
+      : expected_(expected), what_(what), scope_() {}
+
+    ~ExpectAllocations() {
+      std::size_t const seen = scope_.allocations();
+      EXPECT_EQ(expected_, seen) << "allocations made by " << what_;
+    }
+
+    ExpectAllocations(ExpectAllocations const &) = delete;
+    ExpectAllocations &operator=(ExpectAllocations const &) = delete;
+
+  private:
+    std::size_t expected_;
+    char const *what_;
+    AllocationScope scope_;
+  };
+
+  /// Fails the current test if the enclosing scope allocates at all.
+  class ExpectNoAllocations : public ExpectAllocations {
+  public:
+    explicit ExpectNoAllocations(char const *what = "scope") : ExpectAllocations(0, what) {}
+  };
+
+  /// Keep the optimizer from eliding an allocation by making `p` escape.
+  /// Lambdas passed to countAllocations should call this on what they build.
+  inline void escape(void const *p) {
+    __asm__ __volatile__("" : : "g"(p) : "memory");
+  }
+
+  /// How many allocations does calling fn() make?
+  template <class Fn>
+  std::size_t countAllocations(Fn &&fn) {
+    AllocationScope scope;
+    fn();
+    return scope.allocations();
+  }
+
+  /// Expect `wrapped()` to make exactly as many allocations as `payload()`,
+  /// e.g. copying an Either holding a string vs copying the string.
+  template <class PayloadFn, class WrappedFn>
+  void expectSameAllocations(PayloadFn &&payload, WrappedFn &&wrapped, char const *what) {
+    std::size_t const expected = countAllocations(payload);
+    std::size_t const seen = countAllocations(wrapped);
+    EXPECT_EQ(expected, seen) << "allocations made by " << what;
+  }
+
+}
+
+#endif
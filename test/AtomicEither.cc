@@ -0,0 +1,165 @@
+#include "gtest/gtest.h"
+#include "funky/AtomicEither.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace funky;
+
+namespace {
+
+  enum class ErrorCode : std::uint8_t { Timeout = 1, Refused = 2 };
+
+  // a Right whose words all hold the same number, so a torn read shows up
+  // as words that differ.
+  template <std::size_t N>
+  struct Repeated {
+    std::uint32_t words[N];
+
+    static Repeated of(std::uint32_t v) {
+      Repeated r;
+      for (std::uint32_t &w : r.words) {
+        w = v;
+      }
+      return r;
+    }
+
+    std::uint32_t value() const { return words[0]; }
+
+    bool consistent() const {
+      for (std::uint32_t w : words) {
+        if (w != words[0]) return false;
+      }
+      return true;
+    }
+
+    bool operator==(Repeated const &o) const { return std::memcmp(words, o.words, sizeof(words)) == 0; }
+  };
+
+  // packed into 8, 16 and 32 bytes.
+  typedef Repeated<1> Small;
+  typedef Repeated<3> Medium;
+  typedef Repeated<6> Large;
+
+  TEST(AtomicEither, LockFreedom) {
+    EXPECT_TRUE((AtomicEither<ErrorCode, std::uint32_t>::isLockFree));
+    EXPECT_TRUE((AtomicEither<ErrorCode, Small>::isLockFree));
+    EXPECT_EQ(FUNKY_ATOMIC_EITHER_CAS16 != 0, (AtomicEither<ErrorCode, Medium>::isLockFree));
+    EXPECT_FALSE((AtomicEither<ErrorCode, Large>::isLockFree));
+  }
+
+  template <class R>
+  void expectOperations() {
+    typedef Either<ErrorCode, R> E;
+    AtomicEither<ErrorCode, R> a{E{ErrorCode::Timeout}};
+    EXPECT_EQ(E{ErrorCode::Timeout}, a.load());
+
+    a.store(E{R::of(3)});
+    EXPECT_EQ(E{R::of(3)}, a.load());
+
+    EXPECT_EQ(E{R::of(3)}, a.exchange(E{ErrorCode::Refused}));
+    EXPECT_EQ(E{ErrorCode::Refused}, a.load());
+
+    E expected{ErrorCode::Timeout};
+    EXPECT_FALSE(a.compareExchange(expected, E{R::of(5)}));
+    EXPECT_EQ(E{ErrorCode::Refused}, expected);
+    EXPECT_TRUE(a.compareExchange(expected, E{R::of(5)}));
+    EXPECT_EQ(E{R::of(5)}, a.load());
+  }
+
+  TEST(AtomicEither, Operations) {
+    expectOperations<Small>();
+    expectOperations<Medium>();
+    expectOperations<Large>();
+  }
+
+  TEST(AtomicEither, VoidSides) {
+    AtomicEither<ErrorCode, void> a{Either<ErrorCode, void>::success()};
+    EXPECT_TRUE(a.load().isRight());
+    a.store(ErrorCode::Timeout);
+    EXPECT_EQ(ErrorCode::Timeout, a.load().left());
+    Either<ErrorCode, void> expected = Either<ErrorCode, void>::success();
+    EXPECT_FALSE(a.compareExchange(expected, expected));
+    EXPECT_EQ(ErrorCode::Timeout, expected.left());
+  }
+
+  // writers store Rights whose words agree, and Lefts; readers check that
+  // they never see a mix of two stores.
+  template <class R>
+  void expectNoTornReads() {
+    typedef Either<ErrorCode, R> E;
+    AtomicEither<ErrorCode, R> a{E{R::of(0)}};
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> threads;
+    for (std::uint32_t w = 1; w <= 2; ++w) {
+      threads.emplace_back([&a, w] {
+        for (std::uint32_t i = 0; i < 20000; ++i) {
+          if (i % 7 == 0) {
+            a.store(E{ErrorCode::Timeout});
+          } else {
+            a.store(E{R::of(w << 24 | i)});
+          }
+        }
+      });
+    }
+    for (int r = 0; r < 2; ++r) {
+      threads.emplace_back([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+          E const e = a.load();
+          if (e.isRight() ? !e.right().consistent() : e.left() != ErrorCode::Timeout) {
+            torn.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+    threads[0].join();
+    threads[1].join();
+    done = true;
+    for (std::size_t t = 2; t < threads.size(); ++t) {
+      threads[t].join();
+    }
+    EXPECT_EQ(0, torn.load());
+  }
+
+  TEST(AtomicEither, NoTornReads) {
+    expectNoTornReads<Small>();
+    expectNoTornReads<Medium>();
+    expectNoTornReads<Large>();
+  }
+
+  // threads add one to a shared count with compareExchange loops, so any
+  // lost update shows up in the total.
+  template <class R>
+  void expectNoLostUpdates() {
+    typedef Either<ErrorCode, R> E;
+    AtomicEither<ErrorCode, R> a{E{R::of(0)}};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&a] {
+        E seen = a.load();
+        for (int i = 0; i < 5000; ++i) {
+          while (!a.compareExchange(seen, E{R::of(seen.right().value() + 1)})) {
+          }
+        }
+      });
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+    E const end = a.load();
+    ASSERT_TRUE(end.isRight());
+    EXPECT_TRUE(end.right().consistent());
+    EXPECT_EQ(20000u, end.right().value());
+  }
+
+  TEST(AtomicEither, NoLostUpdates) {
+    expectNoLostUpdates<Small>();
+    expectNoLostUpdates<Medium>();
+    expectNoLostUpdates<Large>();
+  }
+
+}
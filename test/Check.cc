@@ -0,0 +1,47 @@
+#include "gtest/gtest.h"
+#include "funky/Check.hh"
+#include "funky/Either.hh"
+
+#include <string>
+
+using namespace funky;
+
+namespace {
+
+  // only at the levels that check these, so the tests still pass with e.g.
+  // `make CheckLevel=none`.
+#if FUNKY_CHECK_LEVEL >= FUNKY_CHECK_CHEAP
+  TEST(Check, WrongSideDies) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    Either<int, std::string> const e{std::string("right")};
+    EXPECT_DEATH(e.left(), "funky check failed: isLeft\\(\\)");
+    EXPECT_DEATH(e.get<int>(), "funky check failed: is<T>\\(\\)");
+
+    Either<int, std::string> l{1};
+    EXPECT_DEATH(std::move(l).right(), "funky check failed: isRight\\(\\)");
+  }
+#endif
+
+#if FUNKY_CHECK_LEVEL == FUNKY_CHECK_FULL
+  TEST(Check, Passing) {
+    int calls = 0;
+    FUNKY_CHECK(++calls == 1);
+    FUNKY_CHECK_INVARIANT(++calls == 2);
+    EXPECT_EQ(2, calls);
+  }
+#endif
+
+  TEST(Check, UnsafeAccessors) {
+    Either<int, std::string> e{std::string("right")};
+    EXPECT_EQ("right", e.unsafeRight());
+    e.unsafeRight() += "!";
+    Either<int, std::string> const &c = e;
+    EXPECT_EQ("right!", c.unsafeRight());
+    std::string moved = std::move(e).unsafeRight();
+    EXPECT_EQ("right!", moved);
+
+    e = 3;
+    EXPECT_EQ(3, e.unsafeLeft());
+  }
+
+}
@@ -3,6 +3,8 @@
 
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 using namespace funky;
 
@@ -197,6 +199,369 @@ namespace {
   }
 
 
+  TEST(Either, MoveAssignLeft) {
+    Either<std::unique_ptr<int>, bool> a{EmplaceLeft, new int(3)};
+    Either<std::unique_ptr<int>, bool> b{true};
+
+    b = std::move(a);
+
+    EXPECT_TRUE(a.isLeft());
+    EXPECT_EQ(nullptr, a.left()); // moved, not copied.
+
+    EXPECT_TRUE(b.isLeft());
+    EXPECT_EQ(3, *b.left());
+  }
+
+  TEST(Either, Swap) {
+    Either<int, std::string> a{1};
+    Either<int, std::string> b{std::string("two")};
+
+    swap(a, b);
+
+    EXPECT_TRUE(a.isRight());
+    EXPECT_EQ("two", a.right());
+    EXPECT_TRUE(b.isLeft());
+    EXPECT_EQ(1, b.left());
+
+    Either<int, std::string> c{std::string("three")};
+    swap(a, c);
+
+    EXPECT_EQ("three", a.right());
+    EXPECT_EQ("two", c.right());
+  }
+
+  TEST(Either, AssignConvertible) {
+    Either<int, std::string> e{0};
+
+    e = "literal";
+
+    EXPECT_TRUE(e.isRight());
+    EXPECT_EQ("literal", e.right());
+  }
+
+  struct Row {
+    int id;
+    char name[60];
+  };
+
+  TEST(Either, References) {
+    Row rows[2] = {{1, "first"}, {2, "second"}};
+
+    Either<int, Row &> e{rows[0]};
+    EXPECT_EQ(16u, sizeof(e));
+    EXPECT_TRUE(e.isRight());
+    EXPECT_EQ(&rows[0], &e.right());
+    EXPECT_EQ(&rows[0], e.getRightPointer());
+    EXPECT_EQ(nullptr, e.getLeftPointer());
+
+    // writes go through to the row.
+    e.right().id = 10;
+    EXPECT_EQ(10, rows[0].id);
+
+    // assignment rebinds instead of assigning to the row.
+    e = rows[1];
+    EXPECT_EQ(&rows[1], &e.right());
+    EXPECT_EQ(10, rows[0].id);
+    EXPECT_STREQ("first", rows[0].name);
+
+    Either<int, Row &> copy = e;
+    EXPECT_EQ(&rows[1], &copy.right());
+    Either<int, Row &> moved = std::move(copy);
+    EXPECT_EQ(&rows[1], &moved.right());
+    Row &fromRvalue = std::move(moved).right();
+    EXPECT_EQ(&rows[1], &fromRvalue);
+
+    e = 404;
+    EXPECT_EQ(404, e.left());
+    e.set(rows[0]);
+    EXPECT_EQ(&rows[0], &e.get<Row &>());
+    EXPECT_TRUE(e.is<Row &>());
+  }
+
+  TEST(Either, ConstReferencesOnTheLeft) {
+    std::string const notFound = "not found";
+    std::string const denied = "denied";
+
+    Either<std::string const &, int> a{notFound};
+    Either<std::string const &, int> b{denied};
+    EXPECT_EQ(&notFound, &a.left());
+
+    // compares what they refer to.
+    Either<std::string const &, int> c{*new std::string("not found")};
+    EXPECT_EQ(a, c);
+    EXPECT_NE(a, b);
+    delete &c.left();
+
+    swap(a, b);
+    EXPECT_EQ(&denied, &a.left());
+    EXPECT_EQ(&notFound, &b.left());
+    EXPECT_EQ("not found", notFound);
+
+    Either<std::string const &, int> d{3};
+    swap(a, d);
+    EXPECT_EQ(3, a.right());
+    EXPECT_EQ(&denied, &d.left());
+
+    a.emplaceLeft(notFound);
+    EXPECT_EQ(&notFound, &a.left());
+  }
+
+  Either<std::string, void> checkName(std::string const &name) {
+    if (name.empty()) return std::string("empty name");
+    return Either<std::string, void>::success();
+  }
+
+  TEST(Either, VoidRight) {
+    Either<std::string, void> ok = checkName("funky");
+    EXPECT_TRUE(ok.isRight());
+    EXPECT_EQ(nullptr, ok.getLeftPointer());
+    EXPECT_NE(nullptr, ok.getRightPointer());
+    ok.right(); // just asserts
+
+    Either<std::string, void> bad = checkName("");
+    EXPECT_TRUE(bad.isLeft());
+    EXPECT_EQ("empty name", bad.left());
+
+    EXPECT_EQ(ok, (Either<std::string, void>{EmplaceRight}));
+    EXPECT_NE(ok, bad);
+    EXPECT_EQ(bad, checkName(""));
+
+    EXPECT_EQ(std::string("empty name"),
+              bad.either([](std::string const &e) { return e; },
+                         []() { return std::string("ok"); }));
+    EXPECT_EQ(std::string("ok"),
+              ok.either([](std::string const &e) { return e; },
+                        []() { return std::string("ok"); }));
+
+    Either<std::string, void> moved = std::move(bad);
+    EXPECT_EQ("empty name", moved.left());
+    moved = ok;
+    EXPECT_TRUE(moved.isRight());
+    moved = std::string("again");
+    EXPECT_EQ("again", moved.left());
+    moved.emplaceRight();
+    EXPECT_TRUE(moved.is<void>());
+
+    swap(moved, bad);
+    EXPECT_TRUE(moved.isLeft());
+    EXPECT_TRUE(bad.isRight());
+    swap(bad, ok);
+    EXPECT_TRUE(bad.isRight());
+  }
+
+  TEST(Either, VoidLeft) {
+    Either<void, int> e{EmplaceLeft};
+    EXPECT_TRUE(e.isLeft());
+    e = 3;
+    EXPECT_EQ(3, e.right());
+    e.emplaceLeft();
+    EXPECT_TRUE(e.isLeft());
+    EXPECT_EQ(-1, e.either([]() { return -1; }, [](int i) { return i; }));
+  }
+
+  struct Tracked {
+    explicit Tracked(int v) : value(v) {}
+    Tracked(Tracked const &o) : value(o.value) { ++copies; }
+    Tracked(Tracked &&o) noexcept : value(o.value) { ++moves; }
+    Tracked &operator=(Tracked const &) = delete;
+
+    int value;
+    static int copies;
+    static int moves;
+  };
+
+  int Tracked::copies = 0;
+  int Tracked::moves = 0;
+
+  Tracked makeTracked(int v) noexcept { return Tracked(v); }
+
+  TEST(Either, FromInvoke) {
+    Tracked::copies = Tracked::moves = 0;
+
+    Either<int, Tracked> r = Either<int, Tracked>::fromInvoke(EmplaceRight, makeTracked, 5);
+    EXPECT_EQ(5, r.right().value);
+
+    r.emplaceRightFrom([](int a, int b) noexcept { return Tracked(a + b); }, 2, 3);
+    EXPECT_EQ(5, r.right().value);
+
+    Either<Tracked, int> l = Either<Tracked, int>::fromInvoke(EmplaceLeft, makeTracked, 7);
+    EXPECT_EQ(7, l.left().value);
+    l.emplaceRightFrom([] { return 8; });
+    EXPECT_EQ(8, l.right());
+    l.emplaceLeftFrom([](int v) noexcept { return makeTracked(v); }, 9);
+    EXPECT_EQ(9, l.left().value);
+
+    EXPECT_EQ(0, Tracked::copies);
+    EXPECT_EQ(0, Tracked::moves);
+  }
+
+  template <class T, class A, class = void>
+  struct SlotConstructs : std::false_type {};
+
+  template <class T, class A>
+  struct SlotConstructs<T, A, decltype(detail::EitherSlot<T>::construct(nullptr, std::declval<A>()))>
+    : std::true_type {};
+
+  // emplacing a reference side takes an lvalue, and nothing that would bind
+  // a temporary to a const one.
+  static_assert(SlotConstructs<int const &, int &>::value, "");
+  static_assert(SlotConstructs<int const &, int const &>::value, "");
+  static_assert(SlotConstructs<Row &, Row &>::value, "");
+  static_assert(!SlotConstructs<int const &, int>::value, "a temporary");
+  static_assert(!SlotConstructs<int const &, int &&>::value, "an xvalue");
+  static_assert(!SlotConstructs<int const &, long &>::value, "a temporary int");
+  static_assert(!SlotConstructs<Row &, Row>::value, "a temporary");
+
+  TEST(Either, FromInvokeReferencesAndVoid) {
+    std::vector<int> v(3, 1);
+    Either<bool, int &> e = Either<bool, int &>::fromInvoke(
+      EmplaceRight, [&v](std::size_t i) -> int & { return v[i]; }, 2);
+    EXPECT_EQ(&v[2], &e.right());
+
+    int calls = 0;
+    Either<int, void> done = Either<int, void>::fromInvoke(EmplaceRight, [&calls] { ++calls; });
+    EXPECT_TRUE(done.isRight());
+    EXPECT_EQ(1, calls);
+  }
+
+  // fromInvoke() and the emplace*From()s only store a reference to what fn
+  // returns if it's an lvalue of the side's type.
+  static_assert(detail::EitherSlot<int const &>::ConstructFromBinds<int &(*)()>::value, "");
+  static_assert(detail::EitherSlot<int &>::ConstructFromBinds<int &(&)()>::value, "");
+  static_assert(!detail::EitherSlot<int const &>::ConstructFromBinds<int (*)()>::value, "returned by value");
+  static_assert(!detail::EitherSlot<int const &>::ConstructFromBinds<long &(*)()>::value, "a temporary int");
+
+  // a fn that can throw runs before the old value is destroyed, so it can
+  // read it, and the Either keeps it if fn throws.
+  TEST(Either, EmplaceFromThrowing) {
+    Either<int, std::string> e{std::string(100, 'x')};
+    EXPECT_THROW(e.emplaceRightFrom([]() -> std::string { throw 1; }), int);
+    EXPECT_EQ(std::string(100, 'x'), e.right());
+    EXPECT_THROW(e.emplaceLeftFrom([]() -> int { throw 1; }), int);
+    EXPECT_EQ(std::string(100, 'x'), e.right());
+
+    e.emplaceRightFrom([&e] { return e.right() + "y"; });
+    EXPECT_EQ(std::string(100, 'x') + "y", e.right());
+    e.emplaceLeftFrom([&e] { return static_cast<int>(e.right().size()); });
+    EXPECT_EQ(101, e.left());
+  }
+
+  struct ThrowsOnConversion {
+    ThrowsOnConversion(std::string s) : value(std::move(s)) {}
+    ThrowsOnConversion(int) : value() { throw 2; }
+
+    std::string value;
+  };
+
+  // a noexcept fn isn't enough for the in-place path: converting its result
+  // can still throw.
+  TEST(Either, EmplaceFromThrowingConversion) {
+    Either<int, ThrowsOnConversion> e{EmplaceRight, std::string(100, 'x')};
+    EXPECT_THROW(e.emplaceRightFrom([]() noexcept { return 1; }), int);
+    EXPECT_EQ(std::string(100, 'x'), e.right().value);
+
+    Either<int, std::string> s{std::string(100, 'x')};
+    s.emplaceRightFrom([]() noexcept { return "y"; });
+    EXPECT_EQ("y", s.right());
+  }
+
+#if __cplusplus >= 201703L
+  struct Pinned {
+    explicit Pinned(int v) : value(v), self(this) {}
+    Pinned(Pinned const &) = delete;
+    Pinned(Pinned &&) = delete;
+
+    int value;
+    Pinned *self;
+  };
+
+  Pinned makePinned(int v) noexcept { return Pinned(v); }
+
+  TEST(Either, FromInvokeNonMovable) {
+    Either<int, Pinned> e = Either<int, Pinned>::fromInvoke(EmplaceRight, makePinned, 3);
+    EXPECT_EQ(3, e.right().value);
+    EXPECT_EQ(&e.right(), e.right().self);
+
+    e.emplaceRightFrom(makePinned, 4);
+    EXPECT_EQ(4, e.right().value);
+    EXPECT_EQ(&e.right(), e.right().self);
+
+    e.emplaceLeft(1);
+    e.emplaceRightFrom([]() noexcept { return Pinned(5); });
+    EXPECT_EQ(&e.right(), e.right().self);
+  }
+#endif
+
+  TEST(Either, VoidTakesNoSpace) {
+    EXPECT_EQ(2u, sizeof(Either<char, void>));
+    EXPECT_EQ(8u, sizeof(Either<int, void>));
+    EXPECT_EQ(sizeof(Either<int, char>), sizeof(Either<int, void>));
+    EXPECT_EQ(sizeof(Either<std::string, char>), sizeof(Either<std::string, void>));
+    EXPECT_EQ(16u, sizeof(Either<void, double>));
+  }
+
+  TEST(Either, RightOrAndLeftOr) {
+    Either<int, std::string> const r{std::string("right")};
+    Either<int, std::string> const l{3};
+    EXPECT_EQ("right", r.rightOr("fallback"));
+    EXPECT_EQ("fallback", l.rightOr("fallback"));
+    EXPECT_EQ(0, r.leftOr(0));
+    EXPECT_EQ(3, l.leftOr(0));
+
+    int calls = 0;
+    auto fallback = [&] { ++calls; return std::string("computed"); };
+    EXPECT_EQ("right", r.rightOrElse(fallback));
+    EXPECT_EQ(0, calls);
+    EXPECT_EQ("computed", l.rightOrElse(fallback));
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(3, l.leftOrElse([] { return 9; }));
+    EXPECT_EQ(9, r.leftOrElse([] { return 9; }));
+  }
+
+  TEST(Either, RightOrMovesOutOfRvalues) {
+    Either<int, std::unique_ptr<int>> e{EmplaceRight, new int(4)};
+    int *p = e.right().get();
+    std::unique_ptr<int> moved = std::move(e).rightOr(nullptr);
+    EXPECT_EQ(p, moved.get());
+    EXPECT_EQ(nullptr, e.right());
+
+    Either<int, std::unique_ptr<int>> l{1};
+    std::unique_ptr<int> made = std::move(l).rightOrElse([] { return std::unique_ptr<int>{new int(5)}; });
+    EXPECT_EQ(5, *made);
+
+    Either<std::unique_ptr<int>, bool> left{EmplaceLeft, new int(6)};
+    std::unique_ptr<int> fromLeft = std::move(left).leftOrElse([] { return std::unique_ptr<int>(); });
+    EXPECT_EQ(6, *fromLeft);
+    EXPECT_EQ(nullptr, std::move(left).leftOr(nullptr));
+
+    Tracked::copies = Tracked::moves = 0;
+    Either<int, Tracked> t{EmplaceRight, 7};
+    Tracked const out = std::move(t).rightOr(Tracked(0));
+    EXPECT_EQ(7, out.value);
+    EXPECT_EQ(0, Tracked::copies);
+    EXPECT_EQ(1, Tracked::moves);
+  }
+
+  TEST(Either, RightOrReferences) {
+    int x = 1, y = 2;
+    Either<bool, int &> const r{x};
+    Either<bool, int &> const l{false};
+    EXPECT_EQ(&x, &r.rightOr(y));
+    EXPECT_EQ(&y, &l.rightOr(y));
+    EXPECT_EQ(&y, &l.rightOrElse([&]() -> int & { return y; }));
+  }
+
+  struct Fallback {};
+  struct DerivedFallback : Fallback {};
+
+  // a reference side's fallback has to be something it can refer to.
+  static_assert(detail::FallbackBinds<Fallback const &, Fallback &>::value, "");
+  static_assert(detail::FallbackBinds<Fallback const &, DerivedFallback const &>::value, "");
+  static_assert(!detail::FallbackBinds<Fallback const &, Fallback &&>::value, "a temporary");
+  static_assert(!detail::FallbackBinds<Fallback const &, Fallback>::value, "returned by value");
+  static_assert(!detail::FallbackBinds<long const &, int &>::value, "a temporary long");
+  static_assert(detail::FallbackBinds<Fallback, Fallback &&>::value, "");
+
 
 
 
@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/Either.hh"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  // Either should never allocate on its own. For payloads that allocate, it
+  // should make exactly the allocations the payload operation makes.
+
+  std::string const Small = "small";
+  std::string const Large = "a string that is much too long for any small string buffer";
+
+  typedef Either<int, double> Trivial;
+  typedef Either<int, std::string> Stringy;
+  typedef Either<int, std::unique_ptr<int>> Owning;
+  typedef Either<int, std::vector<int>> Vector;
+
+  TEST(EitherAllocations, CounterWorks) {
+    EXPECT_EQ(1u, countAllocations([] { std::unique_ptr<int> p{new int(1)}; escape(&p); }));
+    EXPECT_EQ(0u, countAllocations([] { int i = 1; escape(&i); }));
+  }
+
+#ifdef __cpp_aligned_new
+  struct alignas(64) OverAligned {
+    char bytes[64];
+  };
+
+  TEST(EitherAllocations, CounterSeesOverAlignedNew) {
+    AllocationScope scope;
+    std::unique_ptr<OverAligned> p{new OverAligned()};
+    escape(p.get());
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(p.get()) % 64);
+    EXPECT_EQ(1u, scope.allocations());
+    p.reset();
+    EXPECT_EQ(1u, scope.deallocations());
+  }
+#endif
+
+  TEST(EitherAllocations, Trivial) {
+    ExpectNoAllocations guard{"trivial Either operations"};
+
+    Trivial a{1};
+    Trivial b{2.0};
+    Trivial c{a};
+    Trivial d{std::move(b)};
+
+    a = 3.0;
+    a = 4;
+    a = c;
+    a = std::move(d);
+    a.set(5);
+    a.emplaceRight(6.0);
+    a.emplace<int>(7);
+
+    using std::swap;
+    swap(a, c);
+    swap(a, d);
+
+    double sum = a.either([](int i) { return double(i); }, [](double v) { return v; });
+    EXPECT_TRUE(sum != 0 || a == c);
+  }
+
+  TEST(EitherAllocations, Construction) {
+    for (std::string const &s : { Small, Large }) {
+      expectSameAllocations([&] { std::string c{s}; escape(&c); },
+                            [&] { Stringy e{s}; escape(&e); }, "copy constructing from a payload");
+
+      std::string m1{s}, m2{s};
+      expectSameAllocations([&] { std::string c{std::move(m1)}; escape(&c); },
+                            [&] { Stringy e{std::move(m2)}; escape(&e); }, "move constructing from a payload");
+
+      expectSameAllocations([&] { std::string c(s.size(), 'x'); escape(&c); },
+                            [&] { Stringy e{EmplaceRight, s.size(), 'x'}; escape(&e); }, "emplacement construction");
+    }
+
+    EXPECT_EQ(0u, countAllocations([] { Stringy e{1}; escape(&e); }));
+    EXPECT_EQ(1u, countAllocations([] { Owning e{EmplaceRight, new int(1)}; escape(&e); }));
+    EXPECT_EQ(0u, countAllocations([] { Owning e{EmplaceRight}; escape(&e); }));
+  }
+
+  TEST(EitherAllocations, CopyAndMove) {
+    for (std::string const &s : { Small, Large }) {
+      Stringy const e{s};
+      expectSameAllocations([&] { std::string c{s}; escape(&c); },
+                            [&] { Stringy c{e}; escape(&c); }, "copying an Either");
+
+      Stringy m{s};
+      ExpectNoAllocations guard{"moving an Either"};
+      Stringy moved{std::move(m)};
+    }
+
+    Owning o{EmplaceRight, new int(1)};
+    ExpectNoAllocations guard{"moving a unique_ptr Either"};
+    Owning moved{std::move(o)};
+    EXPECT_EQ(1, *moved.right());
+  }
+
+  TEST(EitherAllocations, Emplacement) {
+    Stringy e{0};
+    expectSameAllocations([&] { std::string c{Large}; escape(&c); },
+                          [&] { e.emplaceRight(Large); escape(&e); }, "emplaceRight");
+
+    EXPECT_EQ(0u, countAllocations([&] { e.emplaceLeft(3); escape(&e); }));
+
+    Vector v{0};
+    expectSameAllocations([] { std::vector<int> c(100, 1); escape(&c); },
+                          [&] { v.emplace<std::vector<int>>(100, 1); escape(&v); }, "emplace<T>");
+  }
+
+  TEST(EitherAllocations, Assignment) {
+    // same side: the payload's own assignment runs, which may reuse its buffer.
+    {
+      std::string target{Large}, source{Large};
+      std::size_t const expected = countAllocations([&] { target = source; escape(&target); });
+
+      Stringy a{Large}, b{Large};
+      EXPECT_EQ(expected, countAllocations([&] { a = b; escape(&a); }));
+    }
+
+    // changing sides destroys and copy constructs.
+    {
+      Stringy a{1};
+      Stringy const b{Large};
+      expectSameAllocations([&] { std::string c{Large}; escape(&c); },
+                            [&] { a = b; escape(&a); }, "assigning across sides");
+      EXPECT_EQ(0u, countAllocations([&] { a = 4; escape(&a); }));
+    }
+
+    // moves never allocate, whichever side we start on.
+    {
+      Stringy a{1}, b{Large}, c{Large};
+      ExpectNoAllocations guard{"move assignment"};
+      a = std::move(b);
+      c = std::move(a);
+      a = 3;
+      a = std::move(c);
+    }
+
+    {
+      Owning a{1};
+      ExpectNoAllocations guard{"assigning a unique_ptr by move"};
+      a = std::unique_ptr<int>{};
+      a.set(2);
+    }
+  }
+
+  TEST(EitherAllocations, Swap) {
+    Stringy a{1}, b{Large}, c{Large};
+    ExpectNoAllocations guard{"swap"};
+    using std::swap;
+    swap(a, b); // different sides
+    swap(a, c); // both right
+    swap(b, c);
+  }
+
+  TEST(EitherAllocations, EitherFn) {
+    Stringy const l{1}, r{Large};
+    ExpectNoAllocations guard{"either()"};
+    auto leftFn = [](int i) { return std::size_t(i); };
+    auto rightFn = [](std::string const &s) { return s.size(); };
+    EXPECT_EQ(1u, l.either(leftFn, rightFn));
+    EXPECT_EQ(Large.size(), r.either(leftFn, rightFn));
+    EXPECT_FALSE(l == r);
+  }
+
+}
@@ -0,0 +1,241 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/EitherCoroutine.hh"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  TEST(EitherCoroutine, ArenaIsLifo) {
+    alignas(std::max_align_t) unsigned char buffer[256];
+    CoroutineArena arena{buffer};
+    void *a = arena.allocate(10);
+    void *b = arena.allocate(20);
+    ASSERT_NE(nullptr, a);
+    ASSERT_NE(nullptr, b);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(b) % alignof(std::max_align_t));
+    EXPECT_EQ(nullptr, arena.allocate(1000));
+
+    arena.deallocate(a, 10); // not the top, so nothing is reclaimed
+    std::size_t const used = arena.used();
+    arena.deallocate(b, 20);
+    EXPECT_LT(arena.used(), used);
+    EXPECT_EQ(b, arena.allocate(20));
+  }
+
+#if FUNKY_HAS_COROUTINES
+
+  struct Error {
+    bool operator==(Error const &o) const { return what == o.what; }
+    std::string what;
+  };
+
+  typedef Either<Error, int> Result;
+
+  Result parse(std::string const &s) {
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) {
+      return Error{"not a number: '" + s + "'"};
+    }
+    return std::stoi(s);
+  }
+
+  int reachedEnd = 0;
+
+  Result sum(std::string const &a, std::string const &b) {
+    int const x = co_await parse(a);
+    int const y = co_await parse(b);
+    ++reachedEnd;
+    co_return x + y;
+  }
+
+  TEST(EitherCoroutine, RightFlowsThrough) {
+    EXPECT_EQ(Result{5}, sum("2", "3"));
+  }
+
+  TEST(EitherCoroutine, LeftShortCircuits) {
+    reachedEnd = 0;
+    Result const r = sum("2", "x");
+    ASSERT_TRUE(r.isLeft());
+    EXPECT_EQ("not a number: 'x'", r.left().what);
+    EXPECT_EQ(0, reachedEnd);
+  }
+
+  // a Left whose type only converts to the coroutine's Left.
+  Either<char const *, int> lookup(int key) {
+    if (key < 0) return "negative key";
+    return key * 10;
+  }
+
+  Either<std::string, int> lookupTwice(int key) {
+    int const v = co_await lookup(key);
+    co_return co_await lookup(v - 100);
+  }
+
+  TEST(EitherCoroutine, LeftConverts) {
+    EXPECT_EQ((Either<std::string, int>{std::string{"negative key"}}), lookupTwice(3));
+    EXPECT_EQ((Either<std::string, int>{EmplaceRight, 500}), lookupTwice(15));
+  }
+
+  struct Tracked {
+    static int live;
+    Tracked() { ++live; }
+    Tracked(Tracked const &) { ++live; }
+    ~Tracked() { --live; }
+  };
+  int Tracked::live = 0;
+
+  Result holdsLocals(std::string const &s) {
+    Tracked t;
+    std::unique_ptr<Tracked> p{new Tracked};
+    co_return co_await parse(s);
+  }
+
+  TEST(EitherCoroutine, ShortCircuitDestroysLocals) {
+    AllocationScope scope;
+    Tracked::live = 0;
+    EXPECT_TRUE(holdsLocals("bad").isLeft());
+    EXPECT_EQ(0, Tracked::live);
+    EXPECT_TRUE(holdsLocals("1").isRight());
+    EXPECT_EQ(0, Tracked::live);
+    EXPECT_EQ(scope.allocations(), scope.deallocations());
+  }
+
+  Either<int, std::string> keepsSource(Either<int, std::string> &e) {
+    std::string const &s = co_await e;
+    co_return s + "!";
+  }
+
+  TEST(EitherCoroutine, AwaitingAnLvalueDoesNotMove) {
+    Either<int, std::string> e{std::string{"hi"}};
+    EXPECT_EQ("hi!", keepsSource(e).right());
+    EXPECT_EQ("hi", e.right());
+  }
+
+  Either<int, std::unique_ptr<int>> makeOwned(int v) {
+    if (v < 0) return v;
+    return Either<int, std::unique_ptr<int>>{EmplaceRight, new int(v)};
+  }
+
+  Either<int, std::unique_ptr<int>> doubled(int v) {
+    std::unique_ptr<int> p = co_await makeOwned(v);
+    *p *= 2;
+    co_return std::move(p);
+  }
+
+  TEST(EitherCoroutine, MoveOnlyPayloads) {
+    EXPECT_EQ(8, *doubled(4).right());
+    EXPECT_EQ(-1, doubled(-1).left());
+  }
+
+  Result throws(bool really) {
+    int const v = co_await parse("1");
+    if (really) throw std::runtime_error("boom");
+    co_return v;
+  }
+
+  TEST(EitherCoroutine, ExceptionsPropagateAndFreeTheFrame) {
+    AllocationScope scope;
+    EXPECT_THROW(throws(true), std::runtime_error);
+    EXPECT_EQ(Result{1}, throws(false));
+    EXPECT_EQ(scope.allocations(), scope.deallocations());
+  }
+
+  // whichever way the compiler goes, the probe frees its own frame.
+  TEST(EitherCoroutine, FrameProbeFreesItsFrame) {
+    AllocationScope scope;
+    detail::probeCallFreesFrameOnThrow();
+    EXPECT_EQ(scope.allocations(), scope.deallocations());
+  }
+
+  // thrown after a Left was awaited in a nested call, and from the arena.
+  Result throwsLate(CoroutineArena &, bool really) {
+    Result const inner = co_await throws(false);
+    if (really) throw std::logic_error("late");
+    co_return inner;
+  }
+
+  TEST(EitherCoroutine, ExceptionsLeaveArenasEmpty) {
+    alignas(std::max_align_t) unsigned char buffer[1024];
+    CoroutineArena arena{buffer};
+    AllocationScope scope;
+    EXPECT_THROW(throwsLate(arena, true), std::logic_error);
+    EXPECT_EQ(0u, arena.used());
+    EXPECT_EQ(Result{1}, throwsLate(arena, false));
+    EXPECT_EQ(scope.allocations(), scope.deallocations());
+  }
+
+  typedef Either<Error, void> Done;
+
+  int steps = 0;
+
+  Done step(bool ok) {
+    if (!ok) return Error{"step failed"};
+    ++steps;
+    return Done::success();
+  }
+
+  Done run(bool ok) {
+    co_await step(true);
+    co_await step(ok);
+    co_await step(true);
+  }
+
+  Done runAndReturn(bool ok) {
+    co_await step(ok);
+    co_return;
+  }
+
+  TEST(EitherCoroutine, VoidRights) {
+    steps = 0;
+    EXPECT_TRUE(run(true).isRight());
+    EXPECT_EQ(3, steps);
+    Done const failed = run(false);
+    ASSERT_TRUE(failed.isLeft());
+    EXPECT_EQ("step failed", failed.left().what);
+    EXPECT_EQ(4, steps);
+    EXPECT_TRUE(runAndReturn(true).isRight());
+    EXPECT_TRUE(runAndReturn(false).isLeft());
+  }
+
+  Result inArena(CoroutineArena &, std::string const &a, std::string const &b) {
+    int const x = co_await parse(a);
+    int const y = co_await parse(b);
+    co_return x * y;
+  }
+
+  Result nestedInArena(CoroutineArena &arena, std::string const &a) {
+    int const x = co_await inArena(arena, a, a);
+    co_return co_await inArena(arena, a, std::to_string(x));
+  }
+
+  TEST(EitherCoroutine, ArenaFrames) {
+    alignas(std::max_align_t) unsigned char buffer[4096];
+    CoroutineArena arena{buffer};
+    {
+      ExpectNoAllocations none{"coroutine frames in an arena"};
+      EXPECT_EQ(Result{27}, nestedInArena(arena, "3"));
+    }
+    EXPECT_EQ(0u, arena.used());
+    EXPECT_TRUE(nestedInArena(arena, "?").isLeft());
+    EXPECT_EQ(0u, arena.used());
+  }
+
+  TEST(EitherCoroutine, FullArenaFallsBackToTheHeap) {
+    alignas(std::max_align_t) unsigned char buffer[16];
+    CoroutineArena arena{buffer};
+    EXPECT_EQ(1u, countAllocations([&arena] {
+      Result r = inArena(arena, "2", "3");
+      escape(&r);
+    }));
+    EXPECT_EQ(0u, arena.used());
+  }
+
+#endif
+
+}
@@ -0,0 +1,214 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/EitherFuture.hh"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  typedef Either<int, std::string> Result;
+
+  TEST(EitherFuture, SetThenGet) {
+    EitherPromise<int, std::string> p;
+    EitherFuture<int, std::string> f = p.getFuture();
+    EXPECT_TRUE(f.valid());
+    EXPECT_FALSE(f.isReady());
+    p.set(Result{std::string{"done"}});
+    EXPECT_TRUE(f.isReady());
+    EXPECT_EQ(Result{std::string{"done"}}, f.get());
+    EXPECT_FALSE(f.valid());
+  }
+
+  TEST(EitherFuture, Emplace) {
+    EitherPromise<int, std::string> left, right;
+    EitherFuture<int, std::string> l = left.getFuture(), r = right.getFuture();
+    left.emplaceLeft(3);
+    right.emplaceRight(2, 'z');
+    EXPECT_EQ(Result{3}, l.get());
+    EXPECT_EQ(Result{std::string{"zz"}}, r.get());
+  }
+
+  TEST(EitherFuture, MoveOnlyPayload) {
+    typedef Either<int, std::unique_ptr<int>> Owned;
+    EitherPromise<int, std::unique_ptr<int>> p;
+    EitherFuture<int, std::unique_ptr<int>> f = p.getFuture();
+    p.set(Owned{EmplaceRight, new int(5)});
+    Owned v = f.get();
+    EXPECT_EQ(5, *v.right());
+  }
+
+  TEST(EitherFuture, OneAllocationPerPair) {
+    ExpectAllocations one{1, "a promise, its future and a trivial value"};
+    EitherPromise<int, double> p;
+    EitherFuture<int, double> f = p.getFuture();
+    p.emplaceRight(1.5);
+    EXPECT_EQ(1.5, f.get().right());
+  }
+
+  TEST(EitherFuture, UnretrievedPromiseIsFreed) {
+    AllocationScope scope;
+    {
+      EitherPromise<int, double> p;
+    }
+    EXPECT_EQ(scope.allocations(), scope.deallocations());
+  }
+
+  // a second set() mustn't touch the first value, which the future may
+  // already be reading.
+#if FUNKY_CHECK_LEVEL >= FUNKY_CHECK_CHEAP
+  TEST(EitherFuture, SettingTwiceDies) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    EitherPromise<int, std::string> p;
+    EitherFuture<int, std::string> f = p.getFuture();
+    p.emplaceLeft(1);
+    EXPECT_DEATH(p.emplaceLeft(2), "EitherPromise set twice");
+    EXPECT_EQ(Result{1}, f.get());
+  }
+#else
+  TEST(EitherFuture, SettingTwiceKeepsTheFirstValue) {
+    AllocationScope scope;
+    {
+      EitherPromise<int, std::string> p;
+      EitherFuture<int, std::string> f = p.getFuture();
+      p.emplaceRight(100, 'x');
+      p.emplaceRight(100, 'y');
+      EXPECT_EQ(Result{std::string(100, 'x')}, f.get());
+    }
+    EXPECT_EQ(scope.allocations(), scope.deallocations());
+  }
+#endif
+
+  struct CopyThrows {
+    explicit CopyThrows(int v) : value(v) {}
+    CopyThrows(CopyThrows const &) { throw 6; }
+    CopyThrows(CopyThrows &&o) noexcept : value(o.value) {}
+    int value;
+  };
+
+  // a set() that throws leaves the promise unset, so it can still be set,
+  // and the future doesn't wait forever.
+  TEST(EitherFuture, ThrowingSetCanBeRetried) {
+    typedef Either<int, CopyThrows> Fragile;
+    EitherPromise<int, CopyThrows> p;
+    EitherFuture<int, CopyThrows> f = p.getFuture();
+    Fragile v{CopyThrows{1}};
+    EXPECT_THROW(p.set(v), int);
+    EXPECT_FALSE(f.isReady());
+    p.set(std::move(v));
+    EXPECT_EQ(1, f.get().right().value);
+  }
+
+  TEST(EitherFuture, ThenRunsInlineWhenReady) {
+    EitherFuture<int, std::size_t> f = makeReadyFuture(Result{std::string{"four"}})
+      .then([](Result &&r) -> Either<int, std::size_t> {
+        if (r.isLeft()) return r.left();
+        return r.right().size();
+      });
+    EXPECT_TRUE(f.isReady());
+    EXPECT_EQ(4u, f.get().right());
+  }
+
+  void setIntoThrowingContinuation() {
+    EitherPromise<int, std::string> p;
+    EitherFuture<int, std::size_t> f = p.getFuture().then([](Result &&) -> Either<int, std::size_t> {
+      throw 7;
+    });
+    p.emplaceLeft(1);
+  }
+
+  // a throwing continuation would leave its future never ready.
+  TEST(EitherFuture, ThrowingContinuationTerminates) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    EXPECT_DEATH(setIntoThrowingContinuation(), "");
+  }
+
+  TEST(EitherFuture, ThenRunsInSettingThread) {
+    EitherPromise<int, std::string> p;
+    std::thread::id ranOn;
+    EitherFuture<int, bool> f = p.getFuture().then([&ranOn](Result &&r) {
+      ranOn = std::this_thread::get_id();
+      return Either<int, bool>{r.isRight()};
+    });
+    EXPECT_FALSE(f.isReady());
+
+    std::thread setter{[&p] { p.emplaceLeft(9); }};
+    std::thread::id const setterId = setter.get_id();
+    setter.join();
+
+    EXPECT_EQ(setterId, ranOn);
+    EXPECT_FALSE(f.get().right());
+  }
+
+  TEST(EitherFuture, ThenChains) {
+    typedef Either<std::string, int> Checked;
+    EitherPromise<int, long> p;
+    EitherFuture<std::string, int> f = p.getFuture()
+      .then([](Either<int, long> &&e) { return Either<int, long>{EmplaceRight, e.right() * 2}; })
+      .then([](Either<int, long> &&e) { return Either<int, long>{EmplaceRight, e.right() + 1}; })
+      .then([](Either<int, long> &&e) -> Checked {
+        if (e.right() > 10) return std::string{"too big"};
+        return static_cast<int>(e.right());
+      });
+    p.emplaceRight(4);
+    EXPECT_EQ(Checked{9}, f.get());
+  }
+
+  TEST(EitherFuture, WaitBlocksUntilSet) {
+    EitherPromise<int, std::string> p;
+    EitherFuture<int, std::string> f = p.getFuture();
+    std::thread setter{[&p] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      p.emplaceRight("late");
+    }};
+    f.wait();
+    EXPECT_TRUE(f.isReady());
+    EXPECT_EQ("late", f.get().right());
+    setter.join();
+  }
+
+  TEST(EitherFuture, Stress) {
+    int const Count = 2000;
+    std::vector<EitherPromise<int, long>> promises(Count);
+    std::vector<EitherFuture<int, long>> futures;
+    for (EitherPromise<int, long> &p : promises) {
+      futures.push_back(p.getFuture());
+    }
+
+    std::atomic<long> sum{0};
+    std::vector<EitherFuture<int, long>> chained;
+    for (int i = 0; i < Count; i += 2) {
+      chained.push_back(std::move(futures[i]).then([&sum](Either<int, long> &&e) {
+        sum.fetch_add(e.right());
+        return std::move(e);
+      }));
+    }
+
+    std::thread setter{[&promises] {
+      for (int i = 0; i < Count; ++i) {
+        promises[i].emplaceRight(long(i));
+      }
+    }};
+
+    long waited = 0;
+    for (int i = 1; i < Count; i += 2) {
+      waited += futures[i].get().right();
+    }
+    long fromChain = 0;
+    for (EitherFuture<int, long> &f : chained) {
+      fromChain += f.get().right();
+    }
+    setter.join();
+
+    EXPECT_EQ(long(Count) * (Count - 1) / 2, waited + fromChain);
+    EXPECT_EQ(fromChain, sum.load());
+  }
+
+}
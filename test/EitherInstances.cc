@@ -0,0 +1,40 @@
+#include "gtest/gtest.h"
+#include "funky/EitherInstances.hh"
+
+#include <string>
+
+using namespace funky;
+
+namespace {
+
+  // These only use members that live in libfunky, so they fail to link if
+  // the explicit instantiations go missing.
+
+  static_assert(FUNKY_EITHER_INSTANCES_EXTERN, "the tests are built like libfunky, so should use its Eithers");
+
+  TEST(EitherInstances, IntString) {
+    Either<int, std::string> e{std::string("oops")};
+    Either<int, std::string> copy{e};
+
+    EXPECT_TRUE(copy.isRight());
+    EXPECT_EQ("oops", copy.right());
+    EXPECT_EQ(e, copy);
+
+    copy = 4;
+    EXPECT_TRUE(copy.isLeft());
+    EXPECT_EQ(4, copy.left());
+    EXPECT_NE(e, copy);
+  }
+
+  TEST(EitherInstances, StringBool) {
+    Either<std::string, bool> e{true};
+
+    e.set(std::string("no"));
+    EXPECT_TRUE(e.isLeft());
+    EXPECT_EQ("no", e.left());
+
+    Either<std::string, bool> moved{std::move(e)};
+    EXPECT_EQ("no", moved.left());
+  }
+
+}
@@ -0,0 +1,133 @@
+#define FUNKY_EITHER_TELEMETRY
+#include "gtest/gtest.h"
+#include "funky/Either.hh"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace funky;
+
+namespace {
+
+  // Types local to this file, so these Eithers can't be confused with
+  // instantiations from translation units built without telemetry.
+  struct Error {
+    int code;
+  };
+
+  typedef Either<Error, std::string> Result;
+
+  std::uint64_t countAt(unsigned line) {
+    for (telemetry::SiteCount const &c : telemetry::snapshot()) {
+      if (c.line == line && std::string(c.file).find("EitherTelemetry.cc") != std::string::npos) {
+        return c.lefts;
+      }
+    }
+    return 0;
+  }
+
+  unsigned const makeLeftsLine = __LINE__ + 3;
+  void makeLefts(int n) {
+    for (int i = 0; i < n; ++i) {
+      Result r{Error{i}};
+    }
+  }
+
+  TEST(EitherTelemetry, CountsLeftsBySite) {
+    telemetry::reset();
+
+    Error const e{1};
+    unsigned const copyLine = __LINE__; Result a{e};
+    Result b{Error{2}};
+    unsigned const moveLine = __LINE__; for (int i = 0; i < 3; ++i) { Result c{Error{i}}; }
+
+    EXPECT_EQ(1u, countAt(copyLine));
+    EXPECT_EQ(3u, countAt(moveLine));
+
+    // copies, moves, and rights aren't counted.
+    std::size_t const sites = telemetry::snapshot().size();
+    Result copied{a};
+    Result moved{std::move(b)};
+    Result right{std::string("fine")};
+    Result emplacedRight{EmplaceRight, "fine"};
+    EXPECT_EQ(sites, telemetry::snapshot().size());
+    EXPECT_EQ(1u, countAt(copyLine));
+  }
+
+  TEST(EitherTelemetry, Reset) {
+    unsigned const line = __LINE__; Result a{Error{1}};
+    EXPECT_EQ(1u, countAt(line));
+    telemetry::reset();
+    EXPECT_EQ(0u, countAt(line));
+    EXPECT_TRUE(telemetry::snapshot().empty());
+  }
+
+  TEST(EitherTelemetry, ThreadsAreAggregated) {
+    telemetry::reset();
+    int const Threads = 4, PerThread = 1000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; ++t) {
+      threads.emplace_back(makeLefts, PerThread);
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+
+    // the threads have exited, their counts must have been kept.
+    EXPECT_EQ(std::uint64_t(Threads * PerThread), countAt(makeLeftsLine));
+  }
+
+  std::uint64_t countInEitherHh() {
+    std::uint64_t n = 0;
+    for (telemetry::SiteCount const &c : telemetry::snapshot()) {
+      if (std::string(c.file).find("Either.hh") != std::string::npos) {
+        n += c.lefts;
+      }
+    }
+    return n;
+  }
+
+  // an Either reused for a new Left is counted too: at the caller for set(),
+  // and in Either.hh for what can't take the caller's site.
+  TEST(EitherTelemetry, CountsReusedLefts) {
+    telemetry::reset();
+    Result r{std::string("fine")};
+
+    Error const e{1};
+    unsigned const setLine = __LINE__; r.set(e);
+    unsigned const setAgainLine = __LINE__; r.set(Error{2});
+    EXPECT_EQ(1u, countAt(setLine));
+    EXPECT_EQ(1u, countAt(setAgainLine));
+
+    r = Error{3};
+    r = e;
+    r.emplaceLeft(Error{4});
+    r.emplace<Error>(Error{5});
+    r.emplaceLeftFrom([]() { return Error{6}; });
+    Result emplaced{EmplaceLeft, Error{7}};
+    Result invoked = Result::fromInvoke(EmplaceLeft, []() { return Error{8}; });
+    EXPECT_EQ(7u, countInEitherHh());
+
+    r.set(std::string("fine"));
+    r.emplaceRight("fine");
+    r.emplace<std::string>("fine");
+    EXPECT_EQ(7u, countInEitherHh());
+  }
+
+  // EmplaceLeft must pick the Left constructor even when the Right is a
+  // number, which could take the enum as one.
+  TEST(EitherTelemetry, EmplaceLeftWithArithmeticRight) {
+    telemetry::reset();
+    Either<Error, int> i{EmplaceLeft};
+    Either<Error, bool> b{EmplaceLeft};
+    Either<Error, double> d{EmplaceLeft, Error{3}};
+    EXPECT_TRUE(i.isLeft());
+    EXPECT_TRUE(b.isLeft());
+    ASSERT_TRUE(d.isLeft());
+    EXPECT_EQ(3, d.left().code);
+    EXPECT_EQ(3u, countInEitherHh());
+  }
+
+}
@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/Either.hh"
+#include "funky/ErrorContext.hh"
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  Either<ErrorContext, int> readPort(ErrorArena &arena, bool fail) {
+    if (fail) return ErrorContext{"permission denied", arena};
+    return 8080;
+  }
+
+  Either<ErrorContext, int> loadConfig(ErrorArena &arena, bool fail) {
+    return withContext(readPort(arena, fail), ErrorMessage::fromStatic("reading /etc/server.conf"), arena);
+  }
+
+  Either<ErrorContext, int> startServer(ErrorArena &arena, bool fail) {
+    return withContext(loadConfig(arena, fail), ErrorMessage::format("starting server %d", 3), arena);
+  }
+
+  TEST(ErrorContext, Chains) {
+    ErrorArena arena;
+    Either<ErrorContext, int> const e = startServer(arena, true);
+    ASSERT_TRUE(e.isLeft());
+    ErrorContext const &c = e.left();
+    EXPECT_EQ(3u, c.depth());
+    EXPECT_EQ("starting server 3", c.message().str());
+    EXPECT_EQ("reading /etc/server.conf", c.cause().message().str());
+    EXPECT_FALSE(c.cause().cause().hasCause());
+    EXPECT_EQ("permission denied", c.rootMessage().str());
+    EXPECT_EQ("starting server 3: reading /etc/server.conf: permission denied", c.str());
+  }
+
+  TEST(ErrorContext, RightsPassThrough) {
+    ErrorArena arena;
+    EXPECT_EQ(8080, startServer(arena, false).right());
+    EXPECT_EQ(0u, arena.bytesUsed());
+    EXPECT_EQ(0u, arena.bytesReserved());
+  }
+
+  TEST(ErrorContext, IsAPointer) {
+    EXPECT_EQ(sizeof(void*), sizeof(ErrorContext));
+    EXPECT_TRUE(std::is_trivially_copyable<ErrorContext>::value);
+  }
+
+  TEST(ErrorContext, ResetReusesMemory) {
+    ErrorArena arena;
+    void const *first = &startServer(arena, true).left().message();
+    std::size_t const used = arena.bytesUsed();
+    EXPECT_GT(used, 0u);
+    arena.reset();
+    EXPECT_EQ(0u, arena.bytesUsed());
+    {
+      ExpectNoAllocations none{"propagating an error after a reset"};
+      Either<ErrorContext, int> const e = startServer(arena, true);
+      EXPECT_EQ(first, &e.left().message());
+    }
+    EXPECT_EQ(used, arena.bytesUsed());
+  }
+
+  TEST(ErrorContext, ScopesRewind) {
+    ErrorArena arena;
+    ErrorContext const outer{"outer", arena};
+    std::size_t const used = arena.bytesUsed();
+    void const *inner;
+    {
+      ErrorArena::Scope scope{arena};
+      inner = &ErrorContext{"inner", outer, arena}.message();
+      {
+        ErrorArena::Scope nestedScope{arena};
+        ErrorContext const nested{"nested", arena};
+        EXPECT_EQ(3 * used, arena.bytesUsed());
+      }
+      EXPECT_EQ(2 * used, arena.bytesUsed());
+    }
+    EXPECT_EQ(used, arena.bytesUsed());
+    EXPECT_EQ("outer", outer.str());
+    EXPECT_EQ(inner, &ErrorContext(ErrorMessage{"again"}, arena).message());
+  }
+
+  TEST(ErrorContext, GrowsAndKeepsChunks) {
+    ErrorArena arena{256};
+    ErrorContext c{"root", arena};
+    for (int i = 0; i < 100; ++i) {
+      c = ErrorContext{"layer", c, arena};
+    }
+    EXPECT_EQ(101u, c.depth());
+    EXPECT_EQ("root", c.rootMessage().str());
+    std::size_t const reserved = arena.bytesReserved();
+    EXPECT_GT(reserved, 256u);
+
+    arena.reset();
+    ExpectNoAllocations none{"reusing chunks"};
+    c = ErrorContext{"root", arena};
+    for (int i = 0; i < 100; ++i) {
+      c = ErrorContext{"layer", c, arena};
+    }
+    EXPECT_EQ(reserved, arena.bytesReserved());
+  }
+
+  TEST(ErrorContext, OversizedAllocations) {
+    ErrorArena arena{64};
+    void *small = arena.allocate(8, 8);
+    void *big = arena.allocate(1000, 16);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(big) % 16);
+    EXPECT_NE(small, big);
+    EXPECT_GE(arena.bytesReserved(), 1064u);
+    arena.release();
+    EXPECT_EQ(0u, arena.bytesReserved());
+  }
+
+  // an oversized chunk is sized for its allocation, so its end needn't be
+  // aligned for what comes next.
+  TEST(ErrorContext, MixedAlignments) {
+    ErrorArena arena;
+    char *odd = static_cast<char*>(arena.allocate(4999, 1));
+    std::memset(odd, 0, 4999);
+    std::size_t const sizes[] = {8, 1, 16, 3, 4, 2, 7};
+    for (int i = 0; i < 1000; ++i) {
+      std::size_t const size = sizes[i % 7];
+      std::size_t const align = size & (size - 1) ? 1 : size;
+      void *p = arena.allocate(size, align);
+      EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(p) % align);
+      std::memset(p, 0, size);
+      ASSERT_LE(arena.bytesUsed(), arena.bytesReserved());
+    }
+  }
+
+  TEST(ErrorContext, ThreadLocalArenas) {
+    ErrorArena *mine = &ErrorArena::local();
+    ErrorArena *theirs = nullptr;
+    std::thread t([&] {
+      theirs = &ErrorArena::local();
+      ErrorArena::Scope scope;
+      EXPECT_EQ("in a thread", ErrorContext{"in a thread"}.str());
+    });
+    t.join();
+    EXPECT_NE(mine, theirs);
+  }
+
+}
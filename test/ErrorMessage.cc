@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/Either.hh"
+#include "funky/ErrorMessage.hh"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  TEST(ErrorMessage, Layout) {
+    EXPECT_EQ(24u, sizeof(ErrorMessage));
+    EXPECT_EQ(23u, ErrorMessage::capacity);
+    EXPECT_TRUE(std::is_trivially_copyable<ErrorMessage>::value);
+    EXPECT_EQ(32u, sizeof(Either<ErrorMessage, int>));
+  }
+
+  TEST(ErrorMessage, LiteralsAreNotCopied) {
+    static char const text[] = "a literal that is longer than the inline buffer";
+    ErrorMessage m = ErrorMessage::fromStatic(text);
+    EXPECT_TRUE(m.isStatic());
+    EXPECT_EQ(text, m.c_str());
+    EXPECT_EQ(std::strlen(text), m.size());
+
+    ErrorMessage copy = m;
+    EXPECT_EQ(text, copy.c_str());
+  }
+
+  // c_str() of a static message is the text it refers to, so that has to
+  // end where the message does.
+#if FUNKY_CHECK_LEVEL >= FUNKY_CHECK_CHEAP
+  TEST(ErrorMessage, StaticPrefixesDie) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    static char const text[] = "prefix and the rest";
+    static char const unterminated[] = {'n', 'o', ' ', 'n', 'u', 'l'};
+    EXPECT_DEATH(ErrorMessage::fromStatic(text, 6), "fromStatic text must be NUL-terminated");
+    EXPECT_DEATH(ErrorMessage::fromStatic(unterminated), "fromStatic text must be NUL-terminated");
+    EXPECT_EQ(text, ErrorMessage::fromStatic(text, std::strlen(text)).c_str());
+  }
+#endif
+
+  TEST(ErrorMessage, Empty) {
+    ErrorMessage m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_FALSE(m.isStatic());
+    EXPECT_STREQ("", m.c_str());
+  }
+
+  TEST(ErrorMessage, CopiesInline) {
+    std::string s = "short message";
+    ErrorMessage m = ErrorMessage::copy(s);
+    s[0] = 'x';
+    EXPECT_FALSE(m.isStatic());
+    EXPECT_EQ("short message", m.str());
+    EXPECT_STREQ("short message", m.c_str());
+
+    ErrorMessage full = ErrorMessage::copy(std::string(23, 'z'));
+    EXPECT_EQ(23u, full.size());
+    EXPECT_EQ(std::string(23, 'z'), full.c_str());
+  }
+
+  // a const array might be a local buffer, so it's copied, and only up to
+  // its NUL.
+  TEST(ErrorMessage, ConstArraysAreCopied) {
+    ErrorMessage m;
+    {
+      char const buffer[32] = "foo";
+      m = buffer;
+    }
+    EXPECT_FALSE(m.isStatic());
+    EXPECT_EQ(3u, m.size());
+    EXPECT_EQ(m, "foo");
+
+    ErrorMessage literal{"a literal"};
+    EXPECT_FALSE(literal.isStatic());
+    EXPECT_EQ("a literal", literal.str());
+  }
+
+  TEST(ErrorMessage, MutableArraysAreCopied) {
+    char buffer[32] = "from a buffer";
+    ErrorMessage m = buffer;
+    buffer[0] = 'X';
+    EXPECT_FALSE(m.isStatic());
+    EXPECT_EQ(m, "from a buffer");
+  }
+
+  TEST(ErrorMessage, Truncates) {
+    ErrorMessage m = ErrorMessage::copy("this message is much too long to fit");
+    EXPECT_EQ(23u, m.size());
+    EXPECT_EQ("this message is much...", m.str());
+  }
+
+  TEST(ErrorMessage, Format) {
+    ErrorMessage m = ErrorMessage::format("bad value %d in %s", 42, "age");
+    EXPECT_EQ("bad value 42 in age", m.str());
+
+    ErrorMessage t = ErrorMessage::format("field %d: %s", 7, "a long description of the problem");
+    EXPECT_EQ(23u, t.size());
+    EXPECT_EQ("field 7: a long desc...", t.str());
+  }
+
+  TEST(ErrorMessage, Compare) {
+    EXPECT_EQ(ErrorMessage{"same"}, ErrorMessage::copy("same"));
+    EXPECT_NE(ErrorMessage{"same"}, ErrorMessage::copy("different"));
+    EXPECT_TRUE(ErrorMessage{"abc"} == "abc");
+    EXPECT_TRUE(ErrorMessage{"abc"} != "abcd");
+  }
+
+  Either<ErrorMessage, int> parsePort(int v) {
+    if (v < 0) return ErrorMessage{"port can't be negative"};
+    if (v > 65535) return ErrorMessage::format("port %d is out of range", v);
+    return v;
+  }
+
+  TEST(ErrorMessage, AsTheLeftOfAnEither) {
+    ExpectNoAllocations none{"making and copying error messages"};
+    EXPECT_EQ(80, parsePort(80).right());
+    Either<ErrorMessage, int> const negative = parsePort(-1);
+    EXPECT_TRUE(negative.left() == "port can't be negative");
+    Either<ErrorMessage, int> big = parsePort(70000);
+    Either<ErrorMessage, int> copy = big;
+    EXPECT_TRUE(copy.left() == "port 70000 is out of...");
+  }
+
+}
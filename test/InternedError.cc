@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/Either.hh"
+#include "funky/InternedError.hh"
+
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  // destroyed after the registry, which the tests create later, would be if
+  // it were an ordinary static. `make test-asan` catches a freed registry.
+  struct InternsAtExit {
+    InternsAtExit() {}
+    ~InternsAtExit() {
+      if (InternedError::intern("at exit") != InternedError::intern(std::string("at exit")) ||
+          InternedError::intern("not found") != InternedError::notFound()) {
+        std::abort();
+      }
+    }
+  } internsAtExit;
+
+  Either<InternedError, int> lookup(int key) {
+    if (key < 0) return InternedError::invalidArgument();
+    if (key > 10) return InternedError::notFound();
+    return key * 2;
+  }
+
+  TEST(InternedError, Canonical) {
+    {
+      ExpectNoAllocations none{"failing with a canonical error"};
+      Either<InternedError, int> const e = lookup(11);
+      bool const notFound = e.isLeft() && e.left() == InternedError::notFound();
+      EXPECT_TRUE(notFound);
+    }
+    EXPECT_EQ("not found", lookup(11).left().str());
+    EXPECT_EQ("invalid argument", lookup(-1).left().message().str());
+    EXPECT_NE(InternedError::notFound(), InternedError::invalidArgument());
+    EXPECT_EQ(2u, InternedError::timedOut().id());
+    EXPECT_EQ(4, lookup(2).right());
+  }
+
+  TEST(InternedError, IsAPointer) {
+    EXPECT_EQ(sizeof(void*), sizeof(InternedError));
+    EXPECT_TRUE(std::is_trivially_copyable<InternedError>::value);
+    EXPECT_EQ(2 * sizeof(void*), (sizeof(Either<InternedError, int>)));
+  }
+
+  TEST(InternedError, InternFindsTheSameError) {
+    InternedError const diskFull = InternedError::intern("disk full");
+    EXPECT_EQ(diskFull, InternedError::intern(std::string("disk full")));
+    EXPECT_EQ(diskFull, InternedError::intern("disk full and more", 9));
+    EXPECT_EQ("disk full", diskFull.str());
+    EXPECT_GE(diskFull.id(), static_cast<unsigned>(detail::CanonicalErrorCount));
+    EXPECT_LT(diskFull.id(), InternedError::registered());
+
+    EXPECT_EQ(InternedError::timedOut(), InternedError::intern("timed out"));
+    EXPECT_NE(diskFull, InternedError::intern("disk ful"));
+  }
+
+  TEST(InternedError, InternFromThreads) {
+    std::vector<std::thread> threads;
+    std::vector<std::vector<InternedError>> seen(4);
+    for (std::size_t t = 0; t < seen.size(); ++t) {
+      threads.emplace_back([&seen, t] {
+        for (int i = 0; i < 50; ++i) {
+          seen[t].push_back(InternedError::intern("threaded " + std::to_string(i)));
+        }
+      });
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+    std::set<unsigned> ids;
+    for (std::size_t i = 0; i < 50; ++i) {
+      for (std::size_t t = 1; t < seen.size(); ++t) {
+        EXPECT_EQ(seen[0][i], seen[t][i]);
+      }
+      EXPECT_EQ("threaded " + std::to_string(i), seen[0][i].str());
+      ids.insert(seen[0][i].id());
+    }
+    EXPECT_EQ(50u, ids.size());
+  }
+
+}
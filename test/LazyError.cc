@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/Either.hh"
+#include "funky/LazyError.hh"
+
+#include <string>
+#include <type_traits>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  TEST(LazyError, Layout) {
+    EXPECT_EQ(40u, sizeof(LazyError));
+    EXPECT_TRUE(std::is_trivially_copyable<LazyError>::value);
+  }
+
+  TEST(LazyError, FormatsOnDemand) {
+    LazyError e{"field %d: value %ld is out of range (%s)", 7, 123456789l, "max 100"};
+    EXPECT_EQ("field 7: value 123456789 is out of range (max 100)", e.message());
+  }
+
+  TEST(LazyError, NoArguments) {
+    LazyError e{"100%% broken"};
+    EXPECT_EQ("100% broken", e.message());
+  }
+
+  TEST(LazyError, FormatIdentifiesTheError) {
+    static constexpr char tooBig[] = "too big: %d";
+    LazyError a{tooBig, 1}, b{tooBig, 2};
+    EXPECT_EQ(a.format(), b.format());
+    EXPECT_EQ(tooBig, a.format());
+  }
+
+  TEST(LazyError, Render) {
+    LazyError e{"%d-%d", 12, 34};
+    char buffer[4];
+    std::size_t size = sizeof(buffer);
+    escape(&size);
+    EXPECT_EQ(5u, e.render(buffer, size));
+    EXPECT_STREQ("12-", buffer);
+  }
+
+  TEST(LazyError, LongMessages) {
+    std::string const long1(300, 'x');
+    LazyError e{"%s and %s", long1.c_str(), "more"};
+    EXPECT_EQ(long1 + " and more", e.message());
+  }
+
+  TEST(LazyError, CopiesKeepTheArguments) {
+    int v = 5;
+    LazyError original{"v=%d", v};
+    v = 6;
+    LazyError copy = original;
+    EXPECT_EQ("v=5", copy.message());
+  }
+
+  Either<LazyError, int> checkAge(int age) {
+    if (age < 0 || age > 150) return LazyError{"age %d is out of range [0, %d]", age, 150};
+    return age;
+  }
+
+  TEST(LazyError, CreatingAndDroppingDoesNotAllocate) {
+    std::size_t n = 0;
+    {
+      ExpectNoAllocations none{"creating, copying and dropping lazy errors"};
+      for (int age = 140; age < 160; ++age) {
+        Either<LazyError, int> e = checkAge(age);
+        Either<LazyError, int> copy = e;
+        escape(&copy);
+      }
+      char buffer[64];
+      n = checkAge(200).left().render(buffer, sizeof(buffer));
+    }
+    EXPECT_EQ(32u, n);
+    EXPECT_EQ("age 200 is out of range [0, 150]", checkAge(200).left().message());
+  }
+
+  enum class Unit : short { Meters = 3 };
+
+  TEST(LazyError, EnumsArePassedAsTheirUnderlyingType) {
+    LazyError e{"unit %d, size %zu, %p", Unit::Meters, sizeof(int), static_cast<void*>(nullptr)};
+    EXPECT_EQ("unit 3, size 4, (nil)", e.message());
+  }
+
+  using detail::FormatArg;
+  using detail::formatMatches;
+
+  constexpr FormatArg intString[] = {FormatArg::Int, FormatArg::String};
+  constexpr FormatArg twoInts[] = {FormatArg::Int, FormatArg::Int};
+  constexpr FormatArg longs[] = {FormatArg::Double, FormatArg::Long, FormatArg::Long};
+  constexpr FormatArg starred[] = {FormatArg::Int, FormatArg::Int, FormatArg::String};
+  constexpr FormatArg pointers[] = {FormatArg::String, FormatArg::Pointer};
+
+  static_assert(formatMatches("plain", nullptr, 0), "");
+  static_assert(formatMatches("100%%", nullptr, 0), "");
+  static_assert(!formatMatches("%d", nullptr, 0), "");
+  static_assert(formatMatches("%d %s", intString, 2), "");
+  static_assert(!formatMatches("%d", twoInts, 2), "");
+  static_assert(!formatMatches("%s", twoInts, 1), "");
+  static_assert(!formatMatches("%d", longs + 1, 1), "");
+  static_assert(formatMatches("%-08.3lf %ld %zu", longs, 3), "");
+  static_assert(formatMatches("%*.*s", starred, 3), "");
+  static_assert(formatMatches("%p %p", pointers, 2), "");
+  static_assert(!formatMatches("%", twoInts, 1), "");
+
+  // long double is more aligned than the arguments' storage, so it's not
+  // taken, and neither is %Lf.
+  static_assert(detail::FormatArgOf<long double>::value == FormatArg::Other, "");
+  static_assert(!detail::AllFormattable<int, long double>::value, "");
+  static_assert(!formatMatches("%Lf", longs, 1), "");
+
+#if !defined(__cpp_consteval) && FUNKY_CHECK_LEVEL >= FUNKY_CHECK_CHEAP
+  // from C++20 on, these don't compile.
+  TEST(LazyError, MismatchedFormatsDieWhenRendered) {
+    LazyError tooFew{"%d and %d", 1};
+    EXPECT_DEATH(tooFew.message(), "funky check failed: formatMatches");
+    LazyError wrongKind{"%s", 1};
+    EXPECT_DEATH(wrongKind.message(), "funky check failed: formatMatches");
+  }
+#endif
+
+  TEST(LazyError, BiggerArgumentBuffers) {
+    BasicLazyError<48> e{"%d %d %d %d %d %d", 1, 2, 3, 4, 5, 6};
+    EXPECT_EQ("1 2 3 4 5 6", e.message());
+  }
+
+}
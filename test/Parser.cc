@@ -0,0 +1,198 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/Parser.hh"
+
+#include <cstring>
+#include <string>
+#include <tuple>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  bool isDigit(char c) { return c >= '0' && c <= '9'; }
+  bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+  std::string str(ParseInput v) { return std::string(v.data, v.size); }
+
+  template <class P>
+  ParseResult<typename P::Value> run(P const &p, char const *text) {
+    return parse(p, text, std::strlen(text));
+  }
+
+  TEST(Parser, Character) {
+    char const *text = "ab";
+    ParseResult<char> r = run(character('a'), text);
+    ASSERT_TRUE(r.isRight());
+    EXPECT_EQ('a', r.right().first);
+    EXPECT_EQ(text + 1, r.right().second.data);
+    EXPECT_EQ(1u, r.right().second.size);
+
+    ParseResult<char> e = run(character('b'), text);
+    ASSERT_TRUE(e.isLeft());
+    EXPECT_EQ((ParseError{text, "'b'"}), e.left());
+    EXPECT_TRUE(run(character('a'), "").isLeft());
+  }
+
+  TEST(Parser, SatisfyAndTakeWhile) {
+    EXPECT_EQ('7', run(satisfy(isDigit, "digit"), "7x").right().first);
+    EXPECT_STREQ("digit", run(satisfy(isDigit, "digit"), "x").left().expected);
+
+    char const *text = "abc123";
+    ParseResult<ParseInput> word = run(takeWhile(isAlpha), text);
+    ASSERT_TRUE(word.isRight());
+    EXPECT_EQ(text, word.right().first.data); // a view, not a copy
+    EXPECT_EQ("abc", str(word.right().first));
+    EXPECT_EQ("123", str(word.right().second));
+
+    EXPECT_EQ("", str(run(takeWhile(isAlpha), "123").right().first));
+    EXPECT_STREQ("letter", run(takeWhile1(isAlpha, "letter"), "123").left().expected);
+  }
+
+  TEST(Parser, Literal) {
+    EXPECT_EQ("let", str(run(literal("let"), "let x").right().first));
+    EXPECT_TRUE(run(literal("let"), "le").isLeft());
+    EXPECT_STREQ("let", run(literal("let"), "lex").left().expected);
+  }
+
+  TEST(Parser, Integer) {
+    EXPECT_EQ(1234, run(integer<int>(), "1234,").right().first);
+    EXPECT_EQ(-42, run(integer<int>(), "-42").right().first);
+    EXPECT_EQ(-128, run(integer<signed char>(), "-128").right().first);
+    EXPECT_EQ(255u, run(integer<unsigned char>(), "255").right().first);
+
+    char const *big = "256";
+    EXPECT_EQ((ParseError{big, "integer in range"}), run(integer<unsigned char>(), big).left());
+    EXPECT_TRUE(run(integer<signed char>(), "128").isLeft());
+    EXPECT_TRUE(run(integer<long>(), "99999999999999999999").isLeft());
+
+    // unsigned types don't take a sign.
+    EXPECT_STREQ("digit", run(integer<unsigned>(), "-1").left().expected);
+    char const *sign = "-x";
+    EXPECT_EQ((ParseError{sign + 1, "digit"}), run(integer<int>(), sign).left());
+  }
+
+  TEST(Parser, EndOfInput) {
+    EXPECT_TRUE(run(endOfInput(), "").isRight());
+    EXPECT_STREQ("end of input", run(endOfInput(), "x").left().expected);
+  }
+
+  TEST(Parser, Sequence) {
+    auto p = sequence(integer<int>(), character(':'), takeWhile(isAlpha));
+    ParseResult<std::tuple<int, char, ParseInput>> r = run(p, "12:ab;");
+    ASSERT_TRUE(r.isRight());
+    EXPECT_EQ(12, std::get<0>(r.right().first));
+    EXPECT_EQ("ab", str(std::get<2>(r.right().first)));
+    EXPECT_EQ(";", str(r.right().second));
+
+    char const *text = "12;ab";
+    EXPECT_EQ((ParseError{text + 2, "':'"}), run(p, text).left());
+  }
+
+  TEST(Parser, KeepFirstAndSecond) {
+    EXPECT_EQ(5, run(keepFirst(integer<int>(), character(';')), "5;").right().first);
+    EXPECT_EQ(5, run(keepSecond(character('#'), integer<int>()), "#5").right().first);
+    EXPECT_TRUE(run(keepFirst(integer<int>(), character(';')), "5").isLeft());
+  }
+
+  TEST(Parser, Alternative) {
+    auto p = alternative(literal("true"), literal("false"), literal("null"));
+    EXPECT_EQ("false", str(run(p, "false").right().first));
+    EXPECT_EQ("null", str(run(p, "null").right().first));
+
+    // every alternative fails at the start, so the first one's error wins.
+    char const *text = "nope";
+    EXPECT_EQ((ParseError{text, "true"}), run(p, text).left());
+
+    // the error from the alternative that got furthest.
+    auto q = alternative(sequence(character('a'), character('b')), sequence(character('x'), character('y')));
+    char const *partial = "xz";
+    EXPECT_EQ((ParseError{partial + 1, "'y'"}), run(q, partial).left());
+  }
+
+  TEST(Parser, Fmap) {
+    auto length = fmap(takeWhile(isAlpha), [](ParseInput v) { return v.size; });
+    EXPECT_EQ(3u, run(length, "abc1").right().first);
+  }
+
+  TEST(Parser, Option) {
+    auto p = option(integer<int>(), -1);
+    EXPECT_EQ(7, run(p, "7").right().first);
+    EXPECT_EQ(-1, run(p, "x").right().first);
+    // consumed the '-' before failing, so that's an error.
+    EXPECT_TRUE(run(p, "-x").isLeft());
+  }
+
+  struct Sum {
+    void operator()(int &acc, int v) const { acc += v; }
+  };
+
+  TEST(Parser, Many) {
+    auto digits = many(fmap(satisfy(isDigit, "digit"), [](char c) { return c - '0'; }), 0, Sum{});
+    ParseResult<int> r = run(digits, "123x");
+    ASSERT_TRUE(r.isRight());
+    EXPECT_EQ(6, r.right().first);
+    EXPECT_EQ("x", str(r.right().second));
+    EXPECT_EQ(0, run(digits, "x").right().first);
+
+    auto some = many1(keepFirst(integer<int>(), character(';')), 0, Sum{});
+    EXPECT_EQ(6, run(some, "1;2;3;").right().first);
+    EXPECT_STREQ("at least one item", run(some, "x").left().expected);
+    // an item that fails part way through is an error, not the end.
+    char const *text = "1;2?";
+    EXPECT_EQ((ParseError{text + 3, "';'"}), run(some, text).left());
+  }
+
+  TEST(Parser, ManyStopsOnEmptyMatches) {
+    auto p = many(takeWhile(isAlpha), 0, [](int &n, ParseInput) { ++n; });
+    EXPECT_EQ(1, run(p, "123").right().first);
+  }
+
+  TEST(Parser, SepBy) {
+    auto list = sepBy(integer<int>(), character(','), 0, Sum{});
+    EXPECT_EQ(6, run(list, "1,2,3").right().first);
+    EXPECT_EQ(0, run(list, "").right().first);
+
+    char const *trailing = "1,2,";
+    EXPECT_EQ((ParseError{trailing + 4, "digit"}), run(list, trailing).left());
+
+    EXPECT_TRUE(run(sepBy1(integer<int>(), character(','), 0, Sum{}), "").isLeft());
+  }
+
+  struct Totals {
+    int rows;
+    long score;
+    std::size_t nameBytes;
+  };
+
+  TEST(Parser, CsvWithoutAllocating) {
+    auto name = takeWhile([](char c) { return c != ',' && c != '\n'; });
+    auto row = keepFirst(sequence(integer<unsigned>(), keepSecond(character(','), name),
+                                  keepSecond(character(','), integer<long>())),
+                         character('\n'));
+    auto file = keepFirst(many(row, Totals{0, 0, 0}, [](Totals &t, std::tuple<unsigned, ParseInput, long> r) {
+      ++t.rows;
+      t.score += std::get<2>(r);
+      t.nameBytes += std::get<1>(r).size;
+    }), endOfInput());
+
+    std::string const text = "1,ada,90\n2,grace,-5\n3,,7\n";
+    ParseResult<Totals> r{ParseError{nullptr, ""}};
+    {
+      ExpectNoAllocations none{"parsing"};
+      r = parse(file, text.data(), text.size());
+    }
+    ASSERT_TRUE(r.isRight());
+    EXPECT_EQ(3, r.right().first.rows);
+    EXPECT_EQ(92, r.right().first.score);
+    EXPECT_EQ(8u, r.right().first.nameBytes);
+
+    std::string const bad = "1,ada,90\n2,grace,x\n";
+    ParseResult<Totals> e = parse(file, bad.data(), bad.size());
+    ASSERT_TRUE(e.isLeft());
+    EXPECT_EQ(bad.data() + bad.find('x'), e.left().position);
+    EXPECT_STREQ("digit", e.left().expected);
+  }
+
+}
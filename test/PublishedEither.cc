@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "funky/PublishedEither.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace funky;
+
+namespace {
+
+  enum class RouteError : std::uint8_t { Loading = 1, Stale = 2 };
+
+  struct RoutingTable {
+    std::uint32_t generation;
+    std::uint32_t nextHop[255];
+
+    bool consistent() const {
+      for (std::uint32_t h : nextHop) {
+        if (h != generation) return false;
+      }
+      return true;
+    }
+  };
+
+  RoutingTable tableOf(std::uint32_t generation) {
+    RoutingTable t;
+    t.generation = generation;
+    for (std::uint32_t &h : t.nextHop) {
+      h = generation;
+    }
+    return t;
+  }
+
+  typedef PublishedEither<RouteError, RoutingTable> Routes;
+
+  TEST(PublishedEither, SetAndUpdate) {
+    Routes routes{RouteError::Loading};
+    EXPECT_EQ(RouteError::Loading, routes.load().left());
+
+    routes.set(tableOf(3));
+    Either<RouteError, RoutingTable> e = routes.load();
+    ASSERT_TRUE(e.isRight());
+    EXPECT_EQ(3u, e.right().generation);
+    EXPECT_TRUE(e.right().consistent());
+
+    routes.update([](Either<RouteError, RoutingTable> &current) {
+      current.right().nextHop[7] = 42;
+    });
+    e = routes.load();
+    EXPECT_EQ(42u, e.right().nextHop[7]);
+    EXPECT_EQ(3u, e.right().nextHop[8]);
+
+    routes.set(RouteError::Stale);
+    EXPECT_EQ(RouteError::Stale, routes.load().left());
+  }
+
+  TEST(PublishedEither, VoidRight) {
+    PublishedEither<RouteError, void> ready{RouteError::Loading};
+    EXPECT_TRUE(ready.load().isLeft());
+    ready.update([](Either<RouteError, void> &e) { e.emplaceRight(); });
+    EXPECT_TRUE(ready.load().isRight());
+  }
+
+  // a writer rewrites the whole table in place, one entry at a time, while
+  // readers check that they only ever see whole generations.
+  TEST(PublishedEither, ReadersSeeWholeUpdates) {
+    Routes routes{tableOf(0)};
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::thread writer([&] {
+      for (std::uint32_t g = 1; g <= 3001; ++g) {
+        if (g % 10 == 0) {
+          routes.set(RouteError::Stale);
+          continue;
+        }
+        routes.update([g](Either<RouteError, RoutingTable> &current) {
+          if (current.isLeft()) current.emplaceRight(tableOf(0));
+          RoutingTable &t = current.right();
+          t.generation = g;
+          for (std::uint32_t &h : t.nextHop) {
+            h = g;
+          }
+        });
+      }
+      done = true;
+    });
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+      readers.emplace_back([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+          Either<RouteError, RoutingTable> const e = routes.load();
+          if (e.isRight() ? !e.right().consistent() : e.left() != RouteError::Stale) {
+            torn.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+    writer.join();
+    for (std::thread &t : readers) {
+      t.join();
+    }
+    EXPECT_EQ(0, torn.load());
+    EXPECT_EQ(3001u, routes.load().right().generation);
+  }
+
+}
@@ -0,0 +1,342 @@
+#include "gtest/gtest.h"
+#include "funky/Either.hh"
+#include "funky/Queue.hh"
+
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace funky;
+
+namespace {
+
+  typedef Either<int, std::string> Result;
+  typedef Either<int, std::unique_ptr<long>> Owned;
+
+  // counts live instances, to check queues destroy what they still hold.
+  struct Tracked {
+    static int live;
+    explicit Tracked(int v) : value(v) { ++live; }
+    Tracked(Tracked &&o) noexcept : value(o.value) { ++live; }
+    Tracked &operator=(Tracked &&o) { value = o.value; return *this; }
+    ~Tracked() { --live; }
+    int value;
+  };
+  int Tracked::live = 0;
+
+  // Left for every seventh item, so both sides cross the queue.
+  Owned make(long i) {
+    if (i % 7 == 0) {
+      return Owned{static_cast<int>(i)};
+    }
+    return Owned{EmplaceRight, new long(i)};
+  }
+
+  long valueOf(Owned const &o) {
+    return o.isLeft() ? o.left() : *o.right();
+  }
+
+  TEST(Queue, CapacityIsAPowerOfTwo) {
+    EXPECT_EQ(8u, SpscQueue<int>(5).capacity());
+    EXPECT_EQ(8u, MpmcQueue<int>(8).capacity());
+    EXPECT_EQ(2u, MpmcQueue<int>(0).capacity());
+  }
+
+  TEST(Queue, SpscSlotsDontStraddleCacheLines) {
+    static_assert(sizeof(detail::PackedSlot<Either<int, float>>) == 8, "");
+    static_assert(sizeof(detail::PackedSlot<Either<int, double>>) == 16, "");
+    struct Big { char bytes[100]; };
+    static_assert(alignof(detail::PackedSlot<Either<int, Big>>) == detail::CacheLine, "");
+    static_assert(sizeof(detail::PackedSlot<Either<int, Big>>) == 2 * detail::CacheLine, "");
+  }
+
+  template <class Queue>
+  void checkFifo() {
+    Queue q{4};
+    Result out{0};
+    EXPECT_FALSE(q.tryConsume([](Result &&) { ADD_FAILURE() << "consumed from an empty queue"; }));
+
+    Result two{std::string{"two"}};
+    EXPECT_TRUE(q.tryEmplace(1));
+    EXPECT_TRUE(q.tryPush(std::move(two)));
+    EXPECT_TRUE(q.tryEmplace(EmplaceRight, 3, 'x'));
+    EXPECT_TRUE(q.tryEmplace(4));
+    EXPECT_FALSE(q.tryEmplace(5));
+    EXPECT_EQ(4u, q.sizeApprox());
+
+    ASSERT_TRUE(q.tryPop(out));
+    EXPECT_EQ(Result{1}, out);
+    ASSERT_TRUE(q.tryPop(out));
+    EXPECT_EQ(Result{std::string{"two"}}, out);
+    EXPECT_TRUE(q.tryConsume([](Result &&r) { EXPECT_EQ("xxx", r.right()); }));
+    ASSERT_TRUE(q.tryPop(out));
+    EXPECT_EQ(Result{4}, out);
+    EXPECT_FALSE(q.tryPop(out));
+  }
+
+  TEST(Queue, SpscFifo) { checkFifo<SpscQueue<Result>>(); }
+  TEST(Queue, MpmcFifo) { checkFifo<MpmcQueue<Result>>(); }
+
+  template <class Queue>
+  void checkBatches() {
+    Queue q{8};
+    std::vector<Owned> in;
+    for (long i = 0; i < 10; ++i) {
+      in.push_back(make(i));
+    }
+
+    EXPECT_EQ(8u, q.tryPushBatch(in.data(), in.size()));
+    EXPECT_EQ(0u, q.tryPushBatch(in.data() + 8, 2));
+    // moved-from, not copied.
+    EXPECT_TRUE(in[1].right() == nullptr);
+    EXPECT_TRUE(in[8].right() != nullptr);
+
+    std::vector<Owned> out;
+    EXPECT_EQ(3u, q.tryPopBatch(std::back_inserter(out), 3));
+    EXPECT_EQ(2u, q.tryPushBatch(in.data() + 8, 2));
+    EXPECT_EQ(7u, q.tryPopBatch(std::back_inserter(out), 100));
+    EXPECT_EQ(0u, q.tryPopBatch(std::back_inserter(out), 100));
+
+    ASSERT_EQ(10u, out.size());
+    for (long i = 0; i < 10; ++i) {
+      EXPECT_EQ(i, valueOf(out[i]));
+    }
+  }
+
+  TEST(Queue, SpscBatches) { checkBatches<SpscQueue<Owned>>(); }
+  TEST(Queue, MpmcBatches) { checkBatches<MpmcQueue<Owned>>(); }
+
+  template <class Queue>
+  void checkDestroysRemaining() {
+    Tracked::live = 0;
+    {
+      Queue q{8};
+      for (int i = 0; i < 5; ++i) {
+        q.tryEmplace(i);
+      }
+      q.tryConsume([](Tracked &&) {});
+      EXPECT_EQ(4, Tracked::live);
+    }
+    EXPECT_EQ(0, Tracked::live);
+  }
+
+  TEST(Queue, SpscDestroysRemaining) { checkDestroysRemaining<SpscQueue<Tracked>>(); }
+  TEST(Queue, MpmcDestroysRemaining) { checkDestroysRemaining<MpmcQueue<Tracked>>(); }
+
+  struct ThrowsFromInt {
+    explicit ThrowsFromInt(std::string s) : value(std::move(s)) {}
+    explicit ThrowsFromInt(int) : value() { throw 1; }
+    std::string value;
+  };
+
+  // throws on every other write, like a full buffer behind it.
+  struct FlakyOutput {
+    std::vector<std::string> *to;
+    int *writes;
+
+    FlakyOutput &operator*() { return *this; }
+    FlakyOutput &operator++() { return *this; }
+    FlakyOutput &operator=(ThrowsFromInt &&v) {
+      if (++*writes % 2 == 0) {
+        throw 2;
+      }
+      to->push_back(std::move(v.value));
+      return *this;
+    }
+  };
+
+  // a throw while an MpmcQueue cell is claimed would leave it claimed, and
+  // every thread that got to it after stuck.
+  TEST(Queue, MpmcThrowsWithoutLosingCells) {
+    MpmcQueue<ThrowsFromInt> q{2};
+    for (int round = 0; round < 4; ++round) {
+      EXPECT_THROW(q.tryEmplace(round), int);
+      ASSERT_TRUE(q.tryEmplace(std::string("a")));
+      EXPECT_THROW(q.tryConsume([](ThrowsFromInt &&v) { EXPECT_EQ("a", v.value); throw 3; }), int);
+
+      ASSERT_TRUE(q.tryEmplace(std::string("b")));
+      ASSERT_TRUE(q.tryEmplace(std::string("c")));
+      std::vector<std::string> out;
+      int writes = 0;
+      EXPECT_THROW(q.tryPopBatch(FlakyOutput{&out, &writes}, 2), int);
+      EXPECT_EQ(std::vector<std::string>{"b"}, out);
+      EXPECT_EQ(0u, q.sizeApprox());
+    }
+  }
+
+  // counts live instances, and throws when moved from if negative.
+  struct Fragile {
+    static int live;
+    explicit Fragile(int v) : value(v) { ++live; }
+    Fragile(Fragile &&o) : value(o.value) {
+      if (value < 0) throw 4;
+      ++live;
+    }
+    ~Fragile() { --live; }
+    int value;
+  };
+  int Fragile::live = 0;
+
+  // throws on the second write.
+  struct SecondWriteThrows {
+    std::vector<int> *to;
+
+    SecondWriteThrows &operator*() { return *this; }
+    SecondWriteThrows &operator++() { return *this; }
+    SecondWriteThrows &operator=(Fragile &&v) {
+      if (!to->empty()) {
+        throw 5;
+      }
+      to->push_back(v.value);
+      return *this;
+    }
+  };
+
+  // a throw partway through a batch must still publish the values it got
+  // through, or they're leaked (push) or destroyed twice (pop).
+  TEST(Queue, SpscBatchesThrowWithoutLosingSlots) {
+    Fragile::live = 0;
+    {
+      Fragile items[] = {Fragile{1}, Fragile{2}, Fragile{-3}, Fragile{4}};
+      {
+        SpscQueue<Fragile> q{8};
+        EXPECT_THROW(q.tryPushBatch(items, 4), int);
+        EXPECT_EQ(6, Fragile::live);
+
+        std::vector<int> out;
+        EXPECT_THROW(q.tryPopBatch(SecondWriteThrows{&out}, 2), int);
+        EXPECT_EQ(std::vector<int>{1}, out);
+        EXPECT_EQ(5, Fragile::live);
+
+        EXPECT_TRUE(q.tryConsume([](Fragile &&v) { EXPECT_EQ(2, v.value); }));
+        EXPECT_FALSE(q.tryConsume([](Fragile &&) {}));
+        EXPECT_EQ(4, Fragile::live);
+
+        EXPECT_TRUE(q.tryPush(Fragile{5}));
+      }
+      EXPECT_EQ(4, Fragile::live);
+    }
+    EXPECT_EQ(0, Fragile::live);
+  }
+
+  long const StressItems = 200000;
+
+  TEST(Queue, SpscStress) {
+    SpscQueue<Owned> q{64};
+    std::thread producer{[&q] {
+      Owned batch[5] = { make(0), make(0), make(0), make(0), make(0) };
+      long i = 0;
+      while (i < StressItems) {
+        // alternate single pushes and batches.
+        if (i % 2 == 0) {
+          Owned o = make(i);
+          while (!q.tryPush(std::move(o))) {
+            std::this_thread::yield();
+          }
+          ++i;
+        } else {
+          std::size_t const n = StressItems - i < 5 ? StressItems - i : 5;
+          for (std::size_t j = 0; j < n; ++j) {
+            batch[j] = make(i + j);
+          }
+          std::size_t done = 0;
+          while (done < n) {
+            done += q.tryPushBatch(batch + done, n - done);
+            std::this_thread::yield();
+          }
+          i += n;
+        }
+      }
+    }};
+
+    long expected = 0;
+    bool inOrder = true;
+    std::vector<Owned> got;
+    while (expected < StressItems) {
+      got.clear();
+      if (q.tryPopBatch(std::back_inserter(got), 3) == 0) {
+        std::this_thread::yield();
+      }
+      for (Owned const &o : got) {
+        inOrder = inOrder && valueOf(o) == expected && o.isLeft() == (expected % 7 == 0);
+        ++expected;
+      }
+    }
+    producer.join();
+    EXPECT_TRUE(inOrder);
+    EXPECT_EQ(0u, q.sizeApprox());
+  }
+
+  TEST(Queue, MpmcStress) {
+    int const Producers = 4, Consumers = 4;
+    long const PerProducer = StressItems / Producers;
+    MpmcQueue<Owned> q{128};
+    std::atomic<long> consumed{0};
+    std::vector<std::atomic<int>> seen(Producers * PerProducer);
+    std::vector<long> lastFrom(Consumers * Producers, -1);
+    std::atomic<bool> ordered{true};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < Producers; ++p) {
+      threads.emplace_back([&q, p, PerProducer] {
+        for (long i = p * PerProducer; i < (p + 1) * PerProducer; ) {
+          if (i % 3 == 0) {
+            Owned batch[4] = { make(i), make(i + 1), make(i + 2), make(i + 3) };
+            std::size_t const n = (p + 1) * PerProducer - i < 4 ? (p + 1) * PerProducer - i : 4;
+            std::size_t done = 0;
+            while (done < n) {
+              done += q.tryPushBatch(batch + done, n - done);
+              std::this_thread::yield();
+            }
+            i += n;
+          } else {
+            while (!q.tryEmplace(make(i))) {
+              std::this_thread::yield();
+            }
+            ++i;
+          }
+        }
+      });
+    }
+    for (int c = 0; c < Consumers; ++c) {
+      threads.emplace_back([&, c] {
+        std::vector<Owned> got;
+        while (consumed.load(std::memory_order_relaxed) < Producers * PerProducer) {
+          got.clear();
+          if (q.tryPopBatch(std::back_inserter(got), c + 1) == 0) {
+            std::this_thread::yield();
+            continue;
+          }
+          for (Owned const &o : got) {
+            long const v = valueOf(o);
+            seen[v].fetch_add(1, std::memory_order_relaxed);
+            // each producer's items must reach any one consumer in order.
+            long &last = lastFrom[c * Producers + v / PerProducer];
+            if (v <= last) {
+              ordered.store(false);
+            }
+            last = v;
+          }
+          consumed.fetch_add(got.size(), std::memory_order_relaxed);
+        }
+      });
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+
+    EXPECT_TRUE(ordered.load());
+    int missing = 0, duplicated = 0;
+    for (std::atomic<int> const &s : seen) {
+      missing += s.load() == 0;
+      duplicated += s.load() > 1;
+    }
+    EXPECT_EQ(0, missing);
+    EXPECT_EQ(0, duplicated);
+    EXPECT_EQ(0u, q.sizeApprox());
+  }
+
+}
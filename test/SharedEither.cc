@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/SharedEither.hh"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  typedef std::vector<std::string> Snapshot;
+
+  Snapshot makeSnapshot() {
+    return Snapshot{"alpha", "beta", "gamma"};
+  }
+
+  TEST(SharedEither, CopiesShare) {
+    SharedEither<int, Snapshot> const a{EmplaceRight, makeSnapshot()};
+    EXPECT_TRUE(a.unique());
+    {
+      SharedEither<int, Snapshot> c{7};
+      ExpectNoAllocations none{"copying a SharedEither"};
+      SharedEither<int, Snapshot> const b = a;
+      c = b;
+      EXPECT_EQ(3u, a.useCount());
+      EXPECT_EQ(&a.right(), &c.right());
+      EXPECT_TRUE(a == c);
+    }
+    EXPECT_TRUE(a.unique());
+  }
+
+  TEST(SharedEither, MutateClones) {
+    SharedEither<int, Snapshot> a{EmplaceRight, makeSnapshot()};
+    SharedEither<int, Snapshot> b = a;
+    b.mutate().right().push_back("delta");
+    EXPECT_EQ(3u, a.right().size());
+    EXPECT_EQ(4u, b.right().size());
+    EXPECT_TRUE(a.unique());
+    EXPECT_TRUE(b.unique());
+    EXPECT_FALSE(a == b);
+
+    Snapshot const *before = &b.right();
+    {
+      ExpectNoAllocations none{"mutating a unique SharedEither"};
+      b.mutate().right().pop_back();
+    }
+    EXPECT_EQ(before, &b.right());
+    EXPECT_TRUE(a == b);
+  }
+
+  TEST(SharedEither, Set) {
+    SharedEither<int, Snapshot> a{EmplaceRight, makeSnapshot()};
+    SharedEither<int, Snapshot> b = a;
+    b.set(404);
+    EXPECT_TRUE(a.isRight());
+    ASSERT_TRUE(b.isLeft());
+    EXPECT_EQ(404, b.left());
+
+    Either<int, Snapshot> const *before = &b.get();
+    Either<int, Snapshot> replacement{EmplaceRight, makeSnapshot()};
+    replacement.right().clear();
+    b.set(replacement);
+    EXPECT_EQ(before, &b.get());
+    EXPECT_TRUE(b->right().empty());
+  }
+
+  TEST(SharedEither, Moves) {
+    LocalSharedEither<std::string, int> a{EmplaceLeft, "error"};
+    LocalSharedEither<std::string, int> b = std::move(a);
+    EXPECT_EQ("error", b.left());
+    EXPECT_TRUE(b.unique());
+    a = b;
+    EXPECT_EQ(2u, b.useCount());
+    a = std::move(b);
+    EXPECT_TRUE(a.unique());
+    b.set(3);
+    EXPECT_EQ(3, b.right());
+    swap(a, b);
+    EXPECT_EQ(3, a.right());
+    EXPECT_EQ("error", b.left());
+  }
+
+#if FUNKY_CHECK_LEVEL >= FUNKY_CHECK_CHEAP
+  TEST(SharedEither, CopyingMovedFromDies) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    typedef LocalSharedEither<std::string, int> Shared;
+    Shared a{EmplaceLeft, "error"};
+    Shared b = std::move(a);
+    EXPECT_DEATH(Shared{a}, "funky check failed: o.block_");
+    EXPECT_DEATH(b = a, "funky check failed: o.block_");
+    EXPECT_DEATH(a.get(), "funky check failed: block_");
+  }
+#endif
+
+  TEST(SharedEither, CopiesAcrossThreads) {
+    SharedEither<int, Snapshot> const shared{EmplaceRight, makeSnapshot()};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&shared, t] {
+        for (int i = 0; i < 2000; ++i) {
+          SharedEither<int, Snapshot> mine = shared;
+          if (i % 100 == t) {
+            mine.mutate().right().push_back("local");
+            EXPECT_EQ(4u, mine.right().size());
+          } else {
+            EXPECT_EQ("beta", mine.right()[1]);
+          }
+        }
+      });
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+    EXPECT_TRUE(shared.unique());
+    EXPECT_EQ(3u, shared.right().size());
+  }
+
+}
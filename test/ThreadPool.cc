@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+#include "funky/ThreadPool.hh"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace funky;
+
+namespace {
+
+  typedef Either<std::string, int> Result;
+
+  TEST(ThreadPool, SubmitAndWait) {
+    ThreadPool pool{2};
+    EXPECT_EQ(2u, pool.size());
+    EitherFuture<std::string, int> right = pool.submit([] { return Result{42}; });
+    EitherFuture<std::string, int> left = pool.submit([] { return Result{std::string{"nope"}}; });
+    EXPECT_EQ(Result{42}, right.get());
+    EXPECT_EQ(Result{std::string{"nope"}}, left.get());
+  }
+
+  TEST(ThreadPool, ZeroThreadsMeansOne) {
+    ThreadPool pool{0};
+    EXPECT_EQ(1u, pool.size());
+    EXPECT_EQ(Result{1}, pool.submit([] { return Result{1}; }).get());
+  }
+
+  TEST(ThreadPool, HelpingGetRunsTasksFromOutside) {
+    ThreadPool pool{1};
+    std::vector<EitherFuture<std::string, int>> fs;
+    for (int i = 0; i < 100; ++i) {
+      fs.push_back(pool.submit([i] { return Result{i}; }));
+    }
+    for (int i = 0; i < 100; ++i) {
+      EXPECT_EQ(Result{i}, pool.get(std::move(fs[i])));
+    }
+  }
+
+  // recursive fibonacci, with every call above the cutoff a task of its own.
+  int fib(ThreadPool &pool, int n) {
+    if (n < 10) {
+      return n < 2 ? n : fib(pool, n - 1) + fib(pool, n - 2);
+    }
+    EitherFuture<std::string, int> a = pool.submit([&pool, n] { return Result{fib(pool, n - 1)}; });
+    int const b = fib(pool, n - 2);
+    return pool.get(std::move(a)).right() + b;
+  }
+
+  TEST(ThreadPool, NestedTasks) {
+    ThreadPool pool{4};
+    EXPECT_EQ(6765, pool.submit([&pool] { return Result{fib(pool, 20)}; }).get().right());
+  }
+
+  TEST(ThreadPool, WhenAll) {
+    ThreadPool pool{3};
+    std::vector<EitherFuture<std::string, int>> fs;
+    for (int i = 0; i < 50; ++i) {
+      fs.push_back(pool.submit([i] { return Result{i * i}; }));
+    }
+    Either<std::string, std::vector<int>> all = whenAll(std::move(fs)).get();
+    ASSERT_TRUE(all.isRight());
+    ASSERT_EQ(50u, all.right().size());
+    for (int i = 0; i < 50; ++i) {
+      EXPECT_EQ(i * i, all.right()[i]);
+    }
+  }
+
+  TEST(ThreadPool, WhenAllShortCircuits) {
+    EitherPromise<std::string, int> slow;
+    std::vector<EitherFuture<std::string, int>> fs;
+    fs.push_back(slow.getFuture());
+    fs.push_back(makeReadyFuture(Result{std::string{"failed"}}));
+    fs.push_back(makeReadyFuture(Result{std::string{"also failed"}}));
+    EitherFuture<std::string, std::vector<int>> all = whenAll(std::move(fs));
+    // settled by the first Left while `slow` is still pending.
+    ASSERT_TRUE(all.isReady());
+    EXPECT_EQ("failed", all.get().left());
+    slow.emplaceRight(1);
+  }
+
+  TEST(ThreadPool, WhenAllEmpty) {
+    EitherFuture<std::string, std::vector<int>> all = whenAll(std::vector<EitherFuture<std::string, int>>{});
+    ASSERT_TRUE(all.isReady());
+    EXPECT_TRUE(all.get().right().empty());
+  }
+
+  TEST(ThreadPool, DestructorRunsPendingTasks) {
+    std::atomic<int> ran{0};
+    {
+      ThreadPool pool{2};
+      for (int i = 0; i < 1000; ++i) {
+        pool.submit([&ran] {
+          ran.fetch_add(1, std::memory_order_relaxed);
+          return Result{0};
+        });
+      }
+    }
+    EXPECT_EQ(1000, ran.load());
+  }
+
+  TEST(ThreadPool, Stress) {
+    ThreadPool pool{4};
+    std::vector<EitherFuture<std::string, std::vector<int>>> groups;
+    for (int g = 0; g < 20; ++g) {
+      groups.push_back(pool.submit([&pool, g] {
+        std::vector<EitherFuture<std::string, int>> fs;
+        for (int i = 0; i < 200; ++i) {
+          fs.push_back(pool.submit([g, i] { return Result{g * 1000 + i}; }));
+        }
+        return pool.get(whenAll(std::move(fs)));
+      }));
+    }
+    for (int g = 0; g < 20; ++g) {
+      Either<std::string, std::vector<int>> r = groups[g].get();
+      ASSERT_TRUE(r.isRight());
+      ASSERT_EQ(200u, r.right().size());
+      EXPECT_EQ(g * 1000 + 199, r.right().back());
+    }
+  }
+
+}
@@ -0,0 +1,202 @@
+#include "gtest/gtest.h"
+#include "AllocationCounter.hh"
+#include "funky/Validation.hh"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace funky;
+using namespace funkytest;
+
+namespace {
+
+  struct FieldError {
+    bool operator==(FieldError const &o) const { return field == o.field && what == o.what; }
+    int field;
+    char const *what;
+  };
+
+  typedef Validation<FieldError, int> Checked;
+
+  Checked positive(int field, int v) {
+    if (v <= 0) return Checked{EmplaceLeft, FieldError{field, "must be positive"}};
+    return v;
+  }
+
+  struct Point {
+    int x, y, z;
+  };
+
+  Point makePoint(int x, int y, int z) { return Point{x, y, z}; }
+
+  TEST(Validation, SmallVectorStaysInlineUpToN) {
+    SmallVector<std::string, 2> v;
+    EXPECT_TRUE(v.isInline());
+    EXPECT_EQ(2u, v.capacity());
+    v.push_back("a");
+    v.emplace_back(3, 'b');
+    EXPECT_TRUE(v.isInline());
+    v.push_back("c");
+    EXPECT_FALSE(v.isInline());
+    ASSERT_EQ(3u, v.size());
+    EXPECT_EQ("a", v.front());
+    EXPECT_EQ("bbb", v[1]);
+    EXPECT_EQ("c", v.back());
+
+    SmallVector<std::string, 2> copy{v};
+    EXPECT_EQ(v, copy);
+    std::string const *heap = &v[0];
+    SmallVector<std::string, 2> moved{std::move(v)};
+    EXPECT_EQ(heap, &moved[0]); // took the buffer
+    EXPECT_TRUE(v.empty());
+    EXPECT_TRUE(v.isInline());
+  }
+
+  // growing mustn't move the element being copied before it's copied.
+  TEST(Validation, SmallVectorPushesItsOwnElements) {
+    SmallVector<std::string, 2> v;
+    v.push_back(std::string(40, 'a'));
+    v.push_back(std::string(40, 'b'));
+    v.emplace_back(v[0]);
+    EXPECT_FALSE(v.isInline());
+    v.push_back(v.back());
+    v.push_back(v[1]);
+    ASSERT_EQ(5u, v.size());
+    EXPECT_EQ(std::string(40, 'a'), v[2]);
+    EXPECT_EQ(std::string(40, 'a'), v[3]);
+    EXPECT_EQ(std::string(40, 'b'), v[4]);
+  }
+
+  TEST(Validation, SmallVectorAppend) {
+    SmallVector<std::unique_ptr<int>, 2> a, b;
+    a.emplace_back(new int(1));
+    b.emplace_back(new int(2));
+    b.emplace_back(new int(3));
+    a.append(std::move(b));
+    ASSERT_EQ(3u, a.size());
+    EXPECT_EQ(3, *a[2]);
+    EXPECT_TRUE(b.empty());
+
+    SmallVector<std::unique_ptr<int>, 2> c;
+    int *first = a[0].get();
+    c.append(std::move(a));
+    EXPECT_EQ(first, c[0].get());
+    EXPECT_EQ(3u, c.size());
+  }
+
+  TEST(Validation, CombineValid) {
+    Validation<FieldError, Point> p = combine(makePoint, positive(0, 1), positive(1, 2), positive(2, 3));
+    ASSERT_TRUE(p.isValid());
+    EXPECT_EQ(2, p.value().y);
+  }
+
+  TEST(Validation, CombineCollectsEveryError) {
+    Validation<FieldError, Point> p = combine(makePoint, positive(0, -1), positive(1, 2), positive(2, 0));
+    ASSERT_TRUE(p.isInvalid());
+    ASSERT_EQ(2u, p.errors().size());
+    EXPECT_EQ(0, p.errors()[0].field);
+    EXPECT_EQ(2, p.errors()[1].field);
+  }
+
+  TEST(Validation, CombineMovesErrors) {
+    typedef Validation<std::unique_ptr<int>, int, 1> Owning;
+    Owning a{EmplaceLeft, new int(1)}, b{3}, c{EmplaceLeft, new int(2)};
+    Owning::Errors more;
+    more.emplace_back(new int(3));
+    more.emplace_back(new int(4));
+    Owning d{std::move(more)};
+    Validation<std::unique_ptr<int>, int, 1> r =
+      combine([](int, int, int, int) { return 0; }, std::move(a), std::move(b), std::move(c), std::move(d));
+    ASSERT_TRUE(r.isInvalid());
+    ASSERT_EQ(4u, r.errors().size());
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(i + 1, *r.errors()[i]);
+    }
+  }
+
+  TEST(Validation, Map) {
+    Checked v{4};
+    EXPECT_EQ("4", v.map([](int i) { return std::to_string(i); }).value());
+    Validation<FieldError, std::string> e = positive(7, -1).map([](int i) { return std::to_string(i); });
+    EXPECT_EQ(7, e.errors()[0].field);
+  }
+
+  TEST(Validation, FromAndToEither) {
+    Checked fromRight{Either<FieldError, int>{5}};
+    EXPECT_EQ(Checked{5}, fromRight);
+    Checked fromLeft{Either<FieldError, int>{FieldError{3, "bad"}}};
+    ASSERT_EQ(1u, fromLeft.errors().size());
+    EXPECT_EQ(3, fromLeft.errors()[0].field);
+
+    Either<Checked::Errors, int> e = std::move(fromLeft).toEither();
+    ASSERT_TRUE(e.isLeft());
+    EXPECT_EQ(3, e.left()[0].field);
+  }
+
+  // the error and value types may be the same.
+  typedef Validation<std::string, std::string> Name;
+
+  Name nonEmpty(std::string n) {
+    if (n.empty()) return Name{EmplaceLeft, "empty name"};
+    return n;
+  }
+
+  TEST(Validation, SameErrorAndValueType) {
+    EXPECT_EQ("thom", nonEmpty("thom").value());
+    Name e = nonEmpty("");
+    ASSERT_TRUE(e.isInvalid());
+    EXPECT_EQ("empty name", e.errors()[0]);
+
+    Name both = combine([](std::string a, std::string b) { return a + " " + b; }, nonEmpty(""), nonEmpty(""));
+    EXPECT_EQ(2u, both.errors().size());
+    EXPECT_EQ("a b", combine([](std::string a, std::string b) { return a + " " + b; },
+                             nonEmpty("a"), nonEmpty("b")).value());
+  }
+
+  // a record of 20 fields, as in the benchmark.
+  struct Record {
+    int f[20];
+  };
+
+  Record makeRecord(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j,
+                    int k, int l, int m, int n, int o, int p, int q, int r, int s, int t) {
+    return Record{{a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, q, r, s, t}};
+  }
+
+  Validation<FieldError, Record> validate(int const (&in)[20]) {
+    return combine(makeRecord,
+                   positive(0, in[0]), positive(1, in[1]), positive(2, in[2]), positive(3, in[3]),
+                   positive(4, in[4]), positive(5, in[5]), positive(6, in[6]), positive(7, in[7]),
+                   positive(8, in[8]), positive(9, in[9]), positive(10, in[10]), positive(11, in[11]),
+                   positive(12, in[12]), positive(13, in[13]), positive(14, in[14]), positive(15, in[15]),
+                   positive(16, in[16]), positive(17, in[17]), positive(18, in[18]), positive(19, in[19]));
+  }
+
+  TEST(Validation, TwentyFieldsWithoutAllocating) {
+    int in[20];
+    for (int i = 0; i < 20; ++i) {
+      in[i] = i + 1;
+    }
+    {
+      ExpectNoAllocations none{"validating a good record"};
+      Validation<FieldError, Record> r = validate(in);
+      EXPECT_TRUE(r.isValid());
+      escape(&r);
+    }
+    in[3] = in[11] = in[19] = 0;
+    {
+      ExpectNoAllocations none{"validating a record with as many errors as fit inline"};
+      Validation<FieldError, Record> r = validate(in);
+      EXPECT_EQ(3u, r.errors().size());
+      escape(&r);
+    }
+    in[0] = in[1] = 0;
+    EXPECT_EQ(1u, countAllocations([&in] {
+      Validation<FieldError, Record> r = validate(in);
+      EXPECT_EQ(5u, r.errors().size());
+      escape(&r);
+    }));
+  }
+
+}